@@ -40,6 +40,7 @@
 
 #cmakedefine VECTORIZATION_SSE
 #cmakedefine VECTORIZATION_SSE2
+#cmakedefine VECTORIZATION_AVX2
 
 #cmakedefine HAVE_ENDIAN_H
 
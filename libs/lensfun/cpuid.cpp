@@ -7,8 +7,17 @@
 #include "lensfun.h"
 #include "lensfunprv.h"
 
+// See _lf_mask_cpu_features
+static guint cpuflags_mask = ~0u;
+
+void _lf_mask_cpu_features (guint mask)
+{
+    cpuflags_mask = mask;
+}
+
 #if defined (_MSC_VER) && !defined(_M_ARM64)
 #include <intrin.h>
+#include <immintrin.h>
 guint _lf_detect_cpu_features ()
 {
     static guint cpuflags = -1;
@@ -48,6 +57,23 @@ guint _lf_detect_cpu_features ()
                 cpuflags |= LF_CPU_FLAG_SSE4_1;
             if (CPUInfo [2] & 0x100000)
                 cpuflags |= LF_CPU_FLAG_SSE4_2;
+            if (CPUInfo [2] & 0x1000)
+                cpuflags |= LF_CPU_FLAG_FMA;
+
+            /* AVX also needs the OS to save the YMM registers (OSXSAVE+XCR0) */
+            if ((CPUInfo [2] & 0x18000000) == 0x18000000 &&
+                (_xgetbv (0) & 0x6) == 0x6)
+            {
+                cpuflags |= LF_CPU_FLAG_AVX;
+
+                __cpuid (CPUInfo, 0);
+                if (CPUInfo [0] >= 7)
+                {
+                    __cpuidex (CPUInfo, 7, 0);
+                    if (CPUInfo [1] & 0x20)
+                        cpuflags |= LF_CPU_FLAG_AVX2;
+                }
+            }
 
             /* Are there extensions? */
             __cpuid (CPUInfo, 0x80000000);
@@ -70,7 +96,7 @@ guint _lf_detect_cpu_features ()
     g_static_mutex_unlock (&lock);
 #endif
 
-    return cpuflags;
+    return cpuflags & cpuflags_mask;
 };
 #else
 #if defined (__i386__) || defined (__x86_64__)
@@ -80,11 +106,13 @@ guint _lf_detect_cpu_features ()
 #  define R_BX	"rbx"
 #  define R_CX	"rcx"
 #  define R_DX	"rdx"
+#  define R_SI	"rsi"
 #else
 #  define R_AX	"eax"
 #  define R_BX	"ebx"
 #  define R_CX	"ecx"
 #  define R_DX	"edx"
+#  define R_SI	"esi"
 #endif
 
 // Borrowed from RawStudio
@@ -97,12 +125,21 @@ guint _lf_detect_cpu_features ()
         "pop %%" R_BX "\n" \
        : "=a" (ax), "=c" (cx),  "=d" (dx) \
        : "0" (cmd))
+// Same as above, but with a sub-leaf in ecx and ebx saved via esi
+#define cpuid_count(cmd, sub) \
+    __asm volatile ( \
+        "mov %%" R_BX ", %%" R_SI "\n" \
+        "cpuid\n" \
+        "xchg %%" R_BX ", %%" R_SI "\n" \
+       : "=a" (ax), "=S" (bx), "=c" (cx),  "=d" (dx) \
+       : "0" (cmd), "2" (sub))
 
 #ifdef __x86_64__
-    guint64 ax, cx, dx, tmp;
+    guint64 ax, bx, cx, dx, tmp;
 #else
-    guint32 ax, cx, dx, tmp;
+    guint32 ax, bx, cx, dx, tmp;
 #endif
+    guint32 xcr0, xcr0_hi;
 
     static guint cpuflags = -1;
 #if defined(GLIB_CHECK_VERSION) && GLIB_CHECK_VERSION(2,32,0)
@@ -137,6 +174,7 @@ guint _lf_detect_cpu_features ()
         {
             /* Get the standard level */
             cpuid (0x00000000);
+            const guint32 max_level = ax;
 
             if (ax)
             {
@@ -160,6 +198,32 @@ guint _lf_detect_cpu_features ()
                     cpuflags |= LF_CPU_FLAG_SSE4_1;
                 if (cx & 0x00080000)
                     cpuflags |= LF_CPU_FLAG_SSE4_2;
+                if (cx & 0x00001000)
+                    cpuflags |= LF_CPU_FLAG_FMA;
+
+                /* AVX also needs the OS to save the YMM registers */
+                if ((cx & 0x18000000) == 0x18000000)
+                {
+                    /* xgetbv with ecx = 0 reads XCR0 */
+                    __asm volatile (
+                        ".byte 0x0f, 0x01, 0xd0\n"
+                        : "=a" (xcr0), "=d" (xcr0_hi)
+                        : "c" (0));
+
+                    if ((xcr0 & 0x6) == 0x6)
+                    {
+                        cpuflags |= LF_CPU_FLAG_AVX;
+
+                        if (max_level >= 7)
+                        {
+                            /* Request for structured extended features */
+                            cpuid_count (0x00000007, 0);
+
+                            if (bx & 0x00000020)
+                                cpuflags |= LF_CPU_FLAG_AVX2;
+                        }
+                    }
+                }
             }
 
             /* Are there extensions? */
@@ -185,9 +249,10 @@ guint _lf_detect_cpu_features ()
     g_static_mutex_unlock (&lock);
 #endif
 
-    return cpuflags;
+    return cpuflags & cpuflags_mask;
 
 #undef cpuid
+#undef cpuid_count
 }
 
 #endif /* __i386__ || __x86_64__ */
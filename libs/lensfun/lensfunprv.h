@@ -9,6 +9,10 @@
 #include <glib.h>
 #include <string.h>
 #include <vector>
+#include <memory>
+#include <atomic>
+#include <new>
+#include <cstddef>
 #include "lensfun.h"
 
 #define MEMBER_OFFSET(s,f)   ((unsigned int)(char *)&((s *)0)->f)
@@ -20,6 +24,13 @@
 // adjusted for the lens calibration data/camera crop factors.
 #define NEWTON_EPS 0.00001
 
+// Limit for the special cases of the stereographic and equisolid projections
+#define EPSLN   1.0e-10
+
+// Parameters of the Thoby fisheye projection
+#define THOBY_K1_PARM 1.47F
+#define THOBY_K2_PARM 0.713F
+
 /**
  * @brief Return the absolute value of a number.
  * @param x
@@ -193,7 +204,10 @@ enum
     LF_CPU_FLAG_SSE3            = 0x00000080,
     LF_CPU_FLAG_SSSE3           = 0x00000100,
     LF_CPU_FLAG_SSE4_1          = 0x00000200,
-    LF_CPU_FLAG_SSE4_2          = 0x00000400
+    LF_CPU_FLAG_SSE4_2          = 0x00000400,
+    LF_CPU_FLAG_AVX             = 0x00000800,
+    LF_CPU_FLAG_AVX2            = 0x00001000,
+    LF_CPU_FLAG_FMA             = 0x00002000
 };
 
 /**
@@ -202,6 +216,25 @@ enum
  */
 LF_EXPORT guint _lf_detect_cpu_features ();
 
+/**
+ * @brief Hide CPU features from _lf_detect_cpu_features, so that the plain
+ * code paths can be tested on any machine.  Only modifiers set up and
+ * applied while the mask is in effect are affected.
+ * @param mask
+ *     The features which may be reported, ~0 for all of them.
+ */
+LF_EXPORT void _lf_mask_cpu_features (guint mask);
+
+/**
+ * @brief Check whether the AVX2 code paths may be used.  They are compiled
+ * with FMA enabled, so both extensions must be present.
+ */
+static inline bool _lf_cpu_has_avx2_fma ()
+{
+    const guint flags = LF_CPU_FLAG_AVX2 | LF_CPU_FLAG_FMA;
+    return (_lf_detect_cpu_features () & flags) == flags;
+}
+
 /**
  * @brief Google-in-your-pocket: a fuzzy string comparator.
  *
@@ -281,4 +314,112 @@ typedef std::vector<dvector> matrix;
 
 LF_EXPORT dvector svd (matrix M);
 
+/**
+ * @brief Callbacks of one kind, ordered by priority.
+ *
+ * This behaves like a std::multiset of pointers to the callbacks, but the
+ * callbacks are copied into an arena of @a ArenaSize bytes inside the chain,
+ * and the first eight pointers are kept inline, too.  So the chains of a
+ * typical modifier need a single allocation for all of them, and iterating
+ * over them stays within one block of memory.  Only callbacks beyond that
+ * go to the heap.  Callbacks never move once they are added.
+ */
+template <typename Base, size_t ArenaSize> class lfCallbackChain
+{
+public:
+    lfCallbackChain () : items (inline_items), count (0), used (0) {}
+
+    ~lfCallbackChain ()
+    {
+        for (size_t i = 0; i < count; i++)
+            if (!spilled_owns (items [i]))
+                items [i]->~Base ();
+    }
+
+    // The pointers refer to the arena of this very chain
+    lfCallbackChain (const lfCallbackChain &) = delete;
+    lfCallbackChain &operator = (const lfCallbackChain &) = delete;
+
+    /// Add a copy of @a cb after the callbacks with the same priority
+    template <typename T> T *insert (const T &cb)
+    {
+        const size_t offset = (used + alignof (T) - 1) / alignof (T) * alignof (T);
+        T *item;
+        if (offset + sizeof (T) <= ArenaSize)
+        {
+            item = new (arena + offset) T (cb);
+            used = offset + sizeof (T);
+        }
+        else
+        {
+            item = new T (cb);
+            spilled.emplace_back (item);
+        }
+
+        if (count == inline_capacity && items == inline_items)
+        {
+            spilled_items.assign (inline_items, inline_items + count);
+            items = spilled_items.data ();
+        }
+        if (items != inline_items)
+        {
+            spilled_items.push_back (NULL);
+            items = spilled_items.data ();
+        }
+
+        size_t i = count++;
+        for (; i > 0 && items [i - 1]->priority > item->priority; i--)
+            items [i] = items [i - 1];
+        items [i] = item;
+        return item;
+    }
+
+    Base *const *begin () const { return items; }
+    Base *const *end () const { return items + count; }
+    size_t size () const { return count; }
+
+private:
+    static const size_t inline_capacity = 8;
+
+    bool spilled_owns (const Base *cb) const
+    {
+        for (auto &owned : spilled)
+            if (owned.get () == cb)
+                return true;
+        return false;
+    }
+
+    alignas (std::max_align_t) unsigned char arena [ArenaSize];
+    Base *inline_items [inline_capacity];
+    /// The ordered pointers, either inline_items or spilled_items
+    Base **items;
+    size_t count, used;
+    std::vector<Base*> spilled_items;
+    std::vector<std::unique_ptr<Base>> spilled;
+};
+
+/// The callback chains of an lfModifier, allocated together
+struct lfModifier::lfCallbackChains
+{
+    /// A set of subpixel coordinate modifier callbacks.
+    lfCallbackChain<lfSubpixelCallback, 128> Subpixel;
+    /// A set of pixel color modifier callbacks.
+    lfCallbackChain<lfColorCallback, 128> Color;
+    /// A set of pixel coordinate modifier callbacks; room for a fitted
+    /// inverse distortion, two projections, perspective, and scaling.
+    lfCallbackChain<lfCoordCallback, 384> Coord;
+    /// Non-zero once the radial table of the coordinate kernel is built,
+    /// see lfModifier::PrepareCoordKernel
+    gsize radial_ready = 0;
+    /// Points where the inverse of the "acm" model did not converge, see
+    /// lfModifier::GetUnconvergedCount
+    std::atomic<unsigned long> unconverged { 0 };
+};
+
+template <typename T> void lfModifier::AddCoordCallback (const T &cd)
+{
+    Callbacks->Coord.insert (cd);
+    PlanCoordCallbacks ();
+}
+
 #endif /* __LENSFUNPRV_H__ */
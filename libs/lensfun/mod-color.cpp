@@ -153,21 +153,21 @@ int lfModifier::EnableVignettingCorrection (float aperture, float distance)
 
 void lfModifier::AddColorVignCallback (const lfLensCalibVignetting& lcv, lfModifyColorFunc func, int priority)
 {
-    lfColorVignCallbackData* cd = new lfColorVignCallbackData;
+    lfColorVignCallbackData cd;
 
-    cd->callback = func;
-    cd->priority = priority;
+    cd.callback = func;
+    cd.priority = priority;
 
-    cd->norm_scale = NormScale;
-    memcpy(cd->terms, lcv.Terms, sizeof(lcv.Terms));
+    cd.norm_scale = NormScale;
+    memcpy(cd.terms, lcv.Terms, sizeof(lcv.Terms));
 
-    ColorCallbacks.insert(cd);
+    Callbacks->Color.insert(cd);
 }
 
 bool lfModifier::ApplyColorModification (
     void *pixels, float x, float y, int width, int height, int comp_role, int row_stride) const
 {
-    if (ColorCallbacks.size() <= 0 || height <= 0)
+    if (Callbacks->Color.size() <= 0 || height <= 0)
         return false; // nothing to do
 
     x = x * NormScale - CenterX;
@@ -175,7 +175,7 @@ bool lfModifier::ApplyColorModification (
 
     for (; height; y += NormScale, height--)
     {
-        for (auto cb : ColorCallbacks)
+        for (auto cb : Callbacks->Color)
             cb->callback (cb, x, y, pixels, comp_role, width);
         pixels = ((char *)pixels) + row_stride;
     }
@@ -0,0 +1,1609 @@
+/*
+    Image modifier implementation: AVX2/FMA (un)distortion functions
+
+    These are 8-lane versions of the callbacks in mod-coord.cpp.  They are
+    only registered if the CPU reports both AVX2 and FMA, see
+    _lf_cpu_has_avx2_fma().  Unaligned buffers are handled directly with
+    unaligned loads/stores, the remaining count % 8 pixels are handed over to
+    the plain code.
+
+    The math of every callback lives in a "stage" functor which transforms
+    eight points held in registers.  The callbacks apply a stage to a buffer,
+    ModifyCoordRow_AVX2 applies it, or a chain of them, to a generated pixel
+    grid and converts the result back to pixel coordinates in the same pass.
+*/
+
+#include "config.h"
+
+#ifdef VECTORIZATION_AVX2
+
+#include "lensfun.h"
+#include "lensfunprv.h"
+#include <immintrin.h>
+#include <math.h>
+#include "windows/mathconstants.h"
+#include <limits>
+#include <algorithm>
+#include <string.h>
+
+/*
+ * Load 8 interleaved (x, y) pairs and split them into x and y vectors.
+ * Note that the lanes end up in the order 0 1 4 5 2 3 6 7; since
+ * store_xy() reverses exactly this permutation, lane-wise arithmetic
+ * does not have to care.
+ */
+static inline void load_xy (const float *iocoord, __m256 &x, __m256 &y)
+{
+    __m256 c0 = _mm256_loadu_ps (iocoord);
+    __m256 c1 = _mm256_loadu_ps (iocoord + 8);
+    x = _mm256_shuffle_ps (c0, c1, _MM_SHUFFLE (2, 0, 2, 0));
+    y = _mm256_shuffle_ps (c0, c1, _MM_SHUFFLE (3, 1, 3, 1));
+}
+
+static inline void store_xy (float *iocoord, __m256 x, __m256 y)
+{
+    _mm256_storeu_ps (iocoord, _mm256_unpacklo_ps (x, y));
+    _mm256_storeu_ps (iocoord + 8, _mm256_unpackhi_ps (x, y));
+}
+
+static inline __m256 abs_ps (__m256 x)
+{
+    return _mm256_andnot_ps (_mm256_set1_ps (-0.0f), x);
+}
+
+/*
+ * Cube root for v >= 1, good to float precision: the exponent is divided by
+ * three in the integer domain for a starting value within 4 %, two Halley
+ * steps then give a relative error below 1e-7.
+ */
+static inline __m256 cbrt_ps (__m256 v)
+{
+    const __m256 two = _mm256_set1_ps (2.0f);
+    __m256i bits = _mm256_castps_si256 (v);
+    bits = _mm256_cvttps_epi32 (_mm256_mul_ps (_mm256_cvtepi32_ps (bits),
+                                               _mm256_set1_ps (1.0f / 3.0f)));
+    __m256 a = _mm256_castsi256_ps (
+        _mm256_add_epi32 (bits, _mm256_set1_epi32 (709958130)));
+    for (int i = 0; i < 2; i++)
+    {
+        // a = a * (a^3 + 2 v) / (2 a^3 + v)
+        __m256 a3 = _mm256_mul_ps (_mm256_mul_ps (a, a), a);
+        a = _mm256_mul_ps (a, _mm256_div_ps (_mm256_fmadd_ps (two, v, a3),
+                                             _mm256_fmadd_ps (two, a3, v)));
+    }
+    return a;
+}
+
+/*
+ * asin (s) for 0 <= s <= 1.  This is the single precision Cephes polynomial,
+ * with arguments above 0.5 reduced via asin (s) = pi/2 - 2 asin (sqrt ((1 - s) / 2)).
+ * Maximum relative error is about 2.5e-7.
+ */
+static inline __m256 asin_ps (__m256 s)
+{
+    const __m256 half = _mm256_set1_ps (0.5f);
+    __m256 large = _mm256_cmp_ps (s, half, _CMP_GT_OQ);
+    __m256 z = _mm256_blendv_ps (_mm256_mul_ps (s, s),
+                                 _mm256_mul_ps (half, _mm256_sub_ps (_mm256_set1_ps (1.0f), s)),
+                                 large);
+    __m256 x = _mm256_blendv_ps (s, _mm256_sqrt_ps (z), large);
+
+    __m256 p = _mm256_fmadd_ps (_mm256_set1_ps (4.2163199048E-2f), z, _mm256_set1_ps (2.4181311049E-2f));
+    p = _mm256_fmadd_ps (p, z, _mm256_set1_ps (4.5470025998E-2f));
+    p = _mm256_fmadd_ps (p, z, _mm256_set1_ps (7.4953002686E-2f));
+    p = _mm256_fmadd_ps (p, z, _mm256_set1_ps (1.6666752422E-1f));
+    p = _mm256_fmadd_ps (_mm256_mul_ps (p, z), x, x);
+
+    return _mm256_blendv_ps (p, _mm256_fnmadd_ps (_mm256_set1_ps (2.0f), p,
+                                                  _mm256_set1_ps (M_PI / 2)), large);
+}
+
+static inline __m256 copysign_ps (__m256 magnitude, __m256 sign)
+{
+    const __m256 mask = _mm256_set1_ps (-0.0f);
+    return _mm256_or_ps (_mm256_andnot_ps (mask, magnitude), _mm256_and_ps (mask, sign));
+}
+
+/*
+ * sin and cos.  The argument is reduced to [-pi/4, pi/4] by subtracting a
+ * multiple of pi/2 in three parts, where the Cephes polynomials are used.
+ * For |x| <= 1000 the absolute error is below 1.2e-7, which covers the
+ * angles of the projections with plenty of margin.
+ */
+static inline void sincos_ps (__m256 x, __m256 &s, __m256 &c)
+{
+    const __m256 j = _mm256_round_ps (_mm256_mul_ps (x, _mm256_set1_ps (2.0 / M_PI)),
+                                      _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_fnmadd_ps (j, _mm256_set1_ps (1.57079637050628662109375f), x);
+    r = _mm256_fnmadd_ps (j, _mm256_set1_ps (-4.37113900018624283e-8f), r);
+    r = _mm256_fnmadd_ps (j, _mm256_set1_ps (-1.71512451947025e-15f), r);
+    // For huge arguments (like the 1.6e16 of the projections) the reduction
+    // fails; the results still have to stay finite like those of the C library.
+    // NaN is passed through.
+    r = _mm256_min_ps (_mm256_set1_ps (1.0f), _mm256_max_ps (_mm256_set1_ps (-1.0f), r));
+    const __m256 z = _mm256_mul_ps (r, r);
+
+    __m256 ps = _mm256_fmadd_ps (_mm256_set1_ps (-1.9515295891E-4f), z, _mm256_set1_ps (8.3321608736E-3f));
+    ps = _mm256_fmadd_ps (ps, z, _mm256_set1_ps (-1.6666654611E-1f));
+    ps = _mm256_fmadd_ps (_mm256_mul_ps (ps, z), r, r);
+
+    __m256 pc = _mm256_fmadd_ps (_mm256_set1_ps (2.443315711809948E-5f), z, _mm256_set1_ps (-1.388731625493765E-3f));
+    pc = _mm256_fmadd_ps (pc, z, _mm256_set1_ps (4.166664568298827E-2f));
+    pc = _mm256_fmadd_ps (_mm256_mul_ps (pc, z), z, _mm256_fnmadd_ps (_mm256_set1_ps (0.5f), z,
+                                                                      _mm256_set1_ps (1.0f)));
+
+    // Odd quadrants swap sin and cos, quadrants 2 and 3 negate sin, 1 and 2
+    // negate cos
+    const __m256i q = _mm256_cvtps_epi32 (j);
+    const __m256 swap = _mm256_castsi256_ps (_mm256_slli_epi32 (q, 31));
+    const __m256 sign_s = _mm256_castsi256_ps (_mm256_slli_epi32 (q, 30));
+    const __m256 sign_c = _mm256_castsi256_ps (
+        _mm256_slli_epi32 (_mm256_add_epi32 (q, _mm256_set1_epi32 (1)), 30));
+    const __m256 sign = _mm256_set1_ps (-0.0f);
+    s = _mm256_xor_ps (_mm256_blendv_ps (ps, pc, swap), _mm256_and_ps (sign_s, sign));
+    c = _mm256_xor_ps (_mm256_blendv_ps (pc, ps, swap), _mm256_and_ps (sign_c, sign));
+}
+
+/*
+ * atan, with the Cephes reduction to |x| <= tan (pi/8) and polynomial.
+ * The absolute error is below 1.5e-7.
+ */
+static inline __m256 atan_ps (__m256 x)
+{
+    const __m256 one = _mm256_set1_ps (1.0f);
+    const __m256 a = abs_ps (x);
+    const __m256 big = _mm256_cmp_ps (a, _mm256_set1_ps (2.414213562373095f), _CMP_GT_OQ);
+    const __m256 mid = _mm256_cmp_ps (a, _mm256_set1_ps (0.4142135623730950f), _CMP_GT_OQ);
+
+    __m256 y0 = _mm256_and_ps (mid, _mm256_set1_ps (M_PI / 4));
+    y0 = _mm256_blendv_ps (y0, _mm256_set1_ps (M_PI / 2), big);
+    __m256 t = _mm256_blendv_ps (a, _mm256_div_ps (_mm256_sub_ps (a, one), _mm256_add_ps (a, one)), mid);
+    t = _mm256_blendv_ps (t, _mm256_div_ps (_mm256_set1_ps (-1.0f), a), big);
+
+    const __m256 z = _mm256_mul_ps (t, t);
+    __m256 p = _mm256_fmadd_ps (_mm256_set1_ps (8.05374449538e-2f), z, _mm256_set1_ps (-1.38776856032E-1f));
+    p = _mm256_fmadd_ps (p, z, _mm256_set1_ps (1.99777106478E-1f));
+    p = _mm256_fmadd_ps (p, z, _mm256_set1_ps (-3.33329491539E-1f));
+    p = _mm256_fmadd_ps (_mm256_mul_ps (p, z), t, t);
+
+    return copysign_ps (_mm256_add_ps (y0, p), x);
+}
+
+/*
+ * atan2, built on atan of the smaller over the larger magnitude.  The
+ * absolute error is below 2.5e-7.  Like the C library, atan2 (0, 0) is 0.
+ */
+static inline __m256 atan2_ps (__m256 y, __m256 x)
+{
+    const __m256 ax = abs_ps (x), ay = abs_ps (y);
+    const __m256 swap = _mm256_cmp_ps (ay, ax, _CMP_GT_OQ);
+    const __m256 num = _mm256_blendv_ps (ay, ax, swap);
+    const __m256 den = _mm256_blendv_ps (ax, ay, swap);
+    const __m256 zero = _mm256_cmp_ps (den, _mm256_setzero_ps (), _CMP_EQ_OQ);
+    __m256 r = atan_ps (_mm256_andnot_ps (zero, _mm256_div_ps (num, den)));
+
+    r = _mm256_blendv_ps (r, _mm256_sub_ps (_mm256_set1_ps (M_PI / 2), r), swap);
+    r = _mm256_blendv_ps (r, _mm256_sub_ps (_mm256_set1_ps (M_PI), r), x);
+    r = copysign_ps (r, y);
+    return _mm256_blendv_ps (r, _mm256_add_ps (x, y), _mm256_cmp_ps (x, y, _CMP_UNORD_Q));
+}
+
+//------------------------------------------------------------------------//
+
+/*
+ * Forward distortion models, see the plain code in mod-coord.cpp and the
+ * "Note about PT-based distortion models" at its top.
+ */
+
+struct Dist_Poly3_AVX2
+{
+    // Rd = Ru * (1 + k1_ * Ru^2)
+    __m256 k1_, one;
+
+    Dist_Poly3_AVX2 (const float *terms)
+        : k1_ (_mm256_set1_ps (terms [0])), one (_mm256_set1_ps (1.0f)) {}
+
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        __m256 ru2 = _mm256_fmadd_ps (x, x, _mm256_mul_ps (y, y));
+        __m256 poly2 = _mm256_fmadd_ps (k1_, ru2, one);
+        x = _mm256_mul_ps (x, poly2);
+        y = _mm256_mul_ps (y, poly2);
+    }
+};
+
+struct Dist_Poly5_AVX2
+{
+    // Rd = Ru * (1 + k1 * Ru^2 + k2 * Ru^4)
+    __m256 k1, k2, one;
+
+    Dist_Poly5_AVX2 (const float *terms)
+        : k1 (_mm256_set1_ps (terms [0])), k2 (_mm256_set1_ps (terms [1])),
+          one (_mm256_set1_ps (1.0f)) {}
+
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        __m256 ru2 = _mm256_fmadd_ps (x, x, _mm256_mul_ps (y, y));
+        __m256 poly4 = _mm256_fmadd_ps (_mm256_fmadd_ps (k2, ru2, k1), ru2, one);
+        x = _mm256_mul_ps (x, poly4);
+        y = _mm256_mul_ps (y, poly4);
+    }
+};
+
+struct Dist_PTLens_AVX2
+{
+    // Rd = Ru * (a_ * Ru^3 + b_ * Ru^2 + c_ * Ru + 1)
+    __m256 a_, b_, c_, one;
+
+    Dist_PTLens_AVX2 (const float *terms)
+        : a_ (_mm256_set1_ps (terms [0])), b_ (_mm256_set1_ps (terms [1])),
+          c_ (_mm256_set1_ps (terms [2])), one (_mm256_set1_ps (1.0f)) {}
+
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        __m256 ru = _mm256_sqrt_ps (_mm256_fmadd_ps (x, x, _mm256_mul_ps (y, y)));
+        __m256 poly3 = _mm256_fmadd_ps (a_, ru, b_);
+        poly3 = _mm256_fmadd_ps (poly3, ru, c_);
+        poly3 = _mm256_fmadd_ps (poly3, ru, one);
+        x = _mm256_mul_ps (x, poly3);
+        y = _mm256_mul_ps (y, poly3);
+    }
+};
+
+struct Dist_ACM_AVX2
+{
+    __m256 k1, k2, k3, k4, k5, k4_2, k5_2, one;
+
+    Dist_ACM_AVX2 (const float *terms)
+        : k1 (_mm256_set1_ps (terms [0])), k2 (_mm256_set1_ps (terms [1])),
+          k3 (_mm256_set1_ps (terms [2])), k4 (_mm256_set1_ps (terms [3])),
+          k5 (_mm256_set1_ps (terms [4])), k4_2 (_mm256_set1_ps (2 * terms [3])),
+          k5_2 (_mm256_set1_ps (2 * terms [4])), one (_mm256_set1_ps (1.0f)) {}
+
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        __m256 ru2 = _mm256_fmadd_ps (x, x, _mm256_mul_ps (y, y));
+        // 1 + k1 * ru2 + k2 * ru4 + k3 * ru6 + 2 * (k4 * y + k5 * x)
+        __m256 common_term = _mm256_fmadd_ps (_mm256_fmadd_ps (k3, ru2, k2), ru2, k1);
+        common_term = _mm256_fmadd_ps (common_term, ru2, one);
+        common_term = _mm256_fmadd_ps (k4_2, y, common_term);
+        common_term = _mm256_fmadd_ps (k5_2, x, common_term);
+
+        __m256 xd = _mm256_fmadd_ps (x, common_term, _mm256_mul_ps (k5, ru2));
+        y = _mm256_fmadd_ps (y, common_term, _mm256_mul_ps (k4, ru2));
+        x = xd;
+    }
+};
+
+/*
+ * Inverse distortion models
+ */
+
+struct UnDist_Poly3_AVX2
+{
+    // Closed-form solution, see ModifyCoord_UnDist_Poly3 for the derivation.
+    // Every lane costs the same, regardless of where the point lies.
+    bool barrel;
+    __m256 rd0, inv_rd0, one, zero, nan;
+
+    UnDist_Poly3_AVX2 (const float *terms)
+    {
+        const float rd0_ = 2.0 / 3.0 * sqrt (1.0 / (3.0 * absolute (terms [0])));
+        barrel = terms [0] < 0;
+        rd0 = _mm256_set1_ps (rd0_);
+        inv_rd0 = _mm256_set1_ps (1.0f / rd0_);
+        one = _mm256_set1_ps (1.0f);
+        zero = _mm256_setzero_ps ();
+        nan = _mm256_set1_ps (std::numeric_limits<float>::quiet_NaN ());
+    }
+
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        __m256 rd = _mm256_sqrt_ps (_mm256_fmadd_ps (x, x, _mm256_mul_ps (y, y)));
+        __m256 s = _mm256_mul_ps (rd, inv_rd0);
+        __m256 g;
+        if (barrel)
+        {
+            // g = 3 * sin (t) with t = asin (s) / 3 in [0, pi/6]; the Taylor
+            // series up to t^7 is exact to 1e-8 there.
+            __m256 t = _mm256_mul_ps (asin_ps (_mm256_min_ps (s, one)),
+                                      _mm256_set1_ps (1.0f / 3.0f));
+            __m256 t2 = _mm256_mul_ps (t, t);
+            __m256 p = _mm256_fmadd_ps (_mm256_set1_ps (-1.0f / 5040), t2,
+                                        _mm256_set1_ps (1.0f / 120));
+            p = _mm256_fmadd_ps (p, t2, _mm256_set1_ps (-1.0f / 6));
+            p = _mm256_fmadd_ps (_mm256_mul_ps (p, t2), t, t);
+            g = _mm256_mul_ps (_mm256_set1_ps (3.0f), p);
+            // No real solution in this area
+            g = _mm256_blendv_ps (nan, g, _mm256_cmp_ps (s, one, _CMP_LE_OQ));
+        }
+        else
+        {
+            __m256 q = _mm256_mul_ps (s, _mm256_set1_ps (27.0f / 8));
+            __m256 a = cbrt_ps (_mm256_add_ps (q, _mm256_sqrt_ps (
+                _mm256_fmadd_ps (q, q, _mm256_set1_ps (729.0f / 64)))));
+            __m256 a2 = _mm256_mul_ps (a, a);
+            __m256 denom = _mm256_add_ps (
+                _mm256_add_ps (a2, _mm256_set1_ps (9.0f / 4)),
+                _mm256_div_ps (_mm256_set1_ps (81.0f / 16), a2));
+            g = _mm256_div_ps (_mm256_add_ps (q, q), denom);
+        }
+
+        __m256 scale = _mm256_div_ps (_mm256_mul_ps (g, rd0), rd);
+        scale = _mm256_blendv_ps (scale, one, _mm256_cmp_ps (rd, zero, _CMP_EQ_OQ));
+        x = _mm256_mul_ps (x, scale);
+        y = _mm256_mul_ps (y, scale);
+    }
+};
+
+/*
+ * The inverse Poly5 and PTLens models use Newton's method just like the plain
+ * code.  All lanes iterate in lockstep until every lane has converged or the
+ * step limit of the plain code is reached.  A lane is considered converged as
+ * soon as |f(ru)| < NEWTON_EPS, the correction computed in that step is
+ * applied nevertheless, which only makes the result more precise.
+ *
+ * Points at rd == 0, points that did not converge and points with
+ * negative ru (no real solution in this area) stay untouched.
+ */
+
+template<typename Model> static inline void undist_radial_newton (
+    const Model &model, __m256 &x, __m256 &y)
+{
+    const __m256 one = _mm256_set1_ps (1.0f);
+    const __m256 zero = _mm256_setzero_ps ();
+    const __m256 eps = _mm256_set1_ps (NEWTON_EPS);
+
+    __m256 rd = _mm256_sqrt_ps (_mm256_fmadd_ps (x, x, _mm256_mul_ps (y, y)));
+    __m256 ru = rd;
+    __m256 converged = zero;
+    for (int step = 0; step <= 6; step++)
+    {
+        __m256 fru, dfru;
+        model.eval (ru, fru, dfru);
+        fru = _mm256_sub_ps (fru, rd);
+        converged = _mm256_or_ps (converged,
+            _mm256_cmp_ps (abs_ps (fru), eps, _CMP_LT_OQ));
+        ru = _mm256_sub_ps (ru, _mm256_div_ps (fru, dfru));
+        if (_mm256_movemask_ps (converged) == 0xff)
+            break;
+    }
+
+    // Points without a (positive) solution stay untouched
+    __m256 valid = _mm256_and_ps (converged, _mm256_cmp_ps (ru, zero, _CMP_GE_OQ));
+    valid = _mm256_andnot_ps (_mm256_cmp_ps (rd, zero, _CMP_EQ_OQ), valid);
+    __m256 scale = _mm256_blendv_ps (one, _mm256_div_ps (ru, rd), valid);
+    x = _mm256_mul_ps (x, scale);
+    y = _mm256_mul_ps (y, scale);
+}
+
+struct UnDist_Poly5_AVX2
+{
+    // Rd = Ru * (1 + k1 * Ru^2 + k2 * Ru^4)
+    __m256 k1, k2, k1_3, k2_5, one;
+
+    UnDist_Poly5_AVX2 (const float *terms)
+        : k1 (_mm256_set1_ps (terms [0])), k2 (_mm256_set1_ps (terms [1])),
+          k1_3 (_mm256_set1_ps (3 * terms [0])), k2_5 (_mm256_set1_ps (5 * terms [1])),
+          one (_mm256_set1_ps (1.0f)) {}
+
+    inline void eval (__m256 ru, __m256 &rd, __m256 &drd) const
+    {
+        __m256 ru2 = _mm256_mul_ps (ru, ru);
+        rd = _mm256_mul_ps (_mm256_fmadd_ps (_mm256_fmadd_ps (k2, ru2, k1), ru2, one), ru);
+        drd = _mm256_fmadd_ps (_mm256_fmadd_ps (k2_5, ru2, k1_3), ru2, one);
+    }
+
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        undist_radial_newton (*this, x, y);
+    }
+};
+
+struct UnDist_PTLens_AVX2
+{
+    // Rd = Ru * (a_ * Ru^3 + b_ * Ru^2 + c_ * Ru + 1)
+    __m256 a_, b_, c_, a_4, b_3, c_2, one;
+
+    UnDist_PTLens_AVX2 (const float *terms)
+        : a_ (_mm256_set1_ps (terms [0])), b_ (_mm256_set1_ps (terms [1])),
+          c_ (_mm256_set1_ps (terms [2])), a_4 (_mm256_set1_ps (4 * terms [0])),
+          b_3 (_mm256_set1_ps (3 * terms [1])), c_2 (_mm256_set1_ps (2 * terms [2])),
+          one (_mm256_set1_ps (1.0f)) {}
+
+    inline void eval (__m256 ru, __m256 &rd, __m256 &drd) const
+    {
+        __m256 poly3 = _mm256_fmadd_ps (_mm256_fmadd_ps (a_, ru, b_), ru, c_);
+        rd = _mm256_mul_ps (_mm256_fmadd_ps (poly3, ru, one), ru);
+        drd = _mm256_fmadd_ps (_mm256_fmadd_ps (_mm256_fmadd_ps (a_4, ru, b_3), ru, c_2),
+                               ru, one);
+    }
+
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        undist_radial_newton (*this, x, y);
+    }
+};
+
+struct UnDist_ACM_AVX2
+{
+    // Two-dimensional Newton's method, see ModifyCoord_UnDist_ACM.  Lanes
+    // stop moving as soon as they have converged; the others are counted.
+    std::atomic<unsigned long> *unconverged;
+    __m256 k1, k2, k3, k4, k5, k2_2, k3_3, k4_2, k5_2, one, two, eps;
+
+    UnDist_ACM_AVX2 (const float *terms, std::atomic<unsigned long> *unconverged)
+        : unconverged (unconverged), k1 (_mm256_set1_ps (terms [0])), k2 (_mm256_set1_ps (terms [1])),
+          k3 (_mm256_set1_ps (terms [2])), k4 (_mm256_set1_ps (terms [3])),
+          k5 (_mm256_set1_ps (terms [4])), k2_2 (_mm256_set1_ps (2 * terms [1])),
+          k3_3 (_mm256_set1_ps (3 * terms [2])), k4_2 (_mm256_set1_ps (2 * terms [3])),
+          k5_2 (_mm256_set1_ps (2 * terms [4])), one (_mm256_set1_ps (1.0f)),
+          two (_mm256_set1_ps (2.0f)), eps (_mm256_set1_ps (NEWTON_EPS)) {}
+
+    inline void operator () (__m256 &xd, __m256 &yd) const
+    {
+        __m256 x = xd, y = yd;
+        __m256 converged = _mm256_setzero_ps ();
+        for (int step = 0; ; step++)
+        {
+            __m256 ru2 = _mm256_fmadd_ps (x, x, _mm256_mul_ps (y, y));
+            __m256 radial = _mm256_fmadd_ps (_mm256_fmadd_ps (k3, ru2, k2), ru2, k1);
+            radial = _mm256_fmadd_ps (radial, ru2, one);
+            __m256 common_term = _mm256_fmadd_ps (k4_2, y, _mm256_fmadd_ps (k5_2, x, radial));
+            __m256 fx = _mm256_sub_ps (_mm256_fmadd_ps (x, common_term, _mm256_mul_ps (k5, ru2)), xd);
+            __m256 fy = _mm256_sub_ps (_mm256_fmadd_ps (y, common_term, _mm256_mul_ps (k4, ru2)), yd);
+
+            __m256 now = _mm256_and_ps (_mm256_cmp_ps (abs_ps (fx), eps, _CMP_LT_OQ),
+                                        _mm256_cmp_ps (abs_ps (fy), eps, _CMP_LT_OQ));
+            converged = _mm256_or_ps (converged, now);
+            if (_mm256_movemask_ps (converged) == 0xff || step > 5)
+                break;
+
+            // Jacobian of the forward function
+            __m256 dradial = _mm256_mul_ps (two, _mm256_fmadd_ps (
+                _mm256_fmadd_ps (k3_3, ru2, k2_2), ru2, k1));
+            __m256 dct_dx = _mm256_fmadd_ps (dradial, x, k5_2);
+            __m256 dct_dy = _mm256_fmadd_ps (dradial, y, k4_2);
+            __m256 j11 = _mm256_fmadd_ps (x, dct_dx, _mm256_fmadd_ps (k5_2, x, common_term));
+            __m256 j12 = _mm256_fmadd_ps (x, dct_dy, _mm256_mul_ps (k5_2, y));
+            __m256 j21 = _mm256_fmadd_ps (y, dct_dx, _mm256_mul_ps (k4_2, x));
+            __m256 j22 = _mm256_fmadd_ps (y, dct_dy, _mm256_fmadd_ps (k4_2, y, common_term));
+            __m256 inv_det = _mm256_div_ps (one, _mm256_fmsub_ps (j11, j22, _mm256_mul_ps (j12, j21)));
+
+            __m256 dx = _mm256_mul_ps (_mm256_fmsub_ps (j22, fx, _mm256_mul_ps (j12, fy)), inv_det);
+            __m256 dy = _mm256_mul_ps (_mm256_fmsub_ps (j11, fy, _mm256_mul_ps (j21, fx)), inv_det);
+            x = _mm256_blendv_ps (_mm256_sub_ps (x, dx), x, converged);
+            y = _mm256_blendv_ps (_mm256_sub_ps (y, dy), y, converged);
+        }
+
+        // Points which did not converge stay untouched
+        xd = _mm256_blendv_ps (xd, x, converged);
+        yd = _mm256_blendv_ps (yd, y, converged);
+        int failed = ~_mm256_movemask_ps (converged) & 0xff;
+        if (failed)
+        {
+            unsigned long count = 0;
+            for (; failed; failed &= failed - 1)
+                count++;
+            unconverged->fetch_add (count, std::memory_order_relaxed);
+        }
+    }
+};
+
+struct UnDist_Fit_AVX2
+{
+    // See ModifyCoord_UnDist_Fit; blocks with points beyond the fitted range
+    // are left to the plain code.
+    void *data;
+    void (*fallback) (void *data, float *iocoord, int count);
+    const float *coeffs;
+    int coeff_count;
+    __m256 max_rd, t_scale, one;
+
+    UnDist_Fit_AVX2 (void *data, void (*fallback) (void *, float *, int),
+                     float max_rd_, const float *coeffs, int coeff_count)
+        : data (data), fallback (fallback), coeffs (coeffs), coeff_count (coeff_count),
+          max_rd (_mm256_set1_ps (max_rd_)), t_scale (_mm256_set1_ps (2.0f / max_rd_)),
+          one (_mm256_set1_ps (1.0f)) {}
+
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        __m256 rd = _mm256_sqrt_ps (_mm256_fmadd_ps (x, x, _mm256_mul_ps (y, y)));
+        if (_mm256_movemask_ps (_mm256_cmp_ps (rd, max_rd, _CMP_LE_OQ)) != 0xff)
+        {
+            float block [16];
+            store_xy (block, x, y);
+            fallback (data, block, 8);
+            load_xy (block, x, y);
+            return;
+        }
+
+        // Clenshaw's recurrence
+        __m256 t = _mm256_fmsub_ps (rd, t_scale, one);
+        __m256 t2 = _mm256_add_ps (t, t);
+        __m256 b1 = _mm256_setzero_ps (), b2 = _mm256_setzero_ps ();
+        for (int j = coeff_count - 1; j > 0; j--)
+        {
+            __m256 b0 = _mm256_fmadd_ps (t2, b1, _mm256_sub_ps (_mm256_set1_ps (coeffs [j]), b2));
+            b2 = b1;
+            b1 = b0;
+        }
+        __m256 ru = _mm256_fmadd_ps (t, b1, _mm256_sub_ps (_mm256_set1_ps (coeffs [0]), b2));
+        x = _mm256_mul_ps (x, ru);
+        y = _mm256_mul_ps (y, ru);
+    }
+};
+
+/*
+ * Projection changes, see the plain code in mod-coord.cpp.  The vector code
+ * avoids most of the trigonometry of the plain code by exact identities, e.g.
+ * cos (atan (x)) = 1 / sqrt (1 + x^2).  The remaining sin, cos, atan, atan2
+ * and asin are the approximations above, so the results are within a few
+ * 1e-7 (relative) of the plain code.  The special cases and the 1.6e16
+ * "infinity" of the plain code are kept.
+ */
+
+/// asin (s) for -1 <= s <= 1
+static inline __m256 asin_signed_ps (__m256 s)
+{
+    return copysign_ps (asin_ps (_mm256_min_ps (abs_ps (s), _mm256_set1_ps (1.0f))), s);
+}
+
+/*
+ * The point on the unit sphere for equirectangular coordinates, with the
+ * same axes as the plain code (y' -> vx, z' -> vy, x' -> w).  The flips of
+ * theta = pi/2 - y there amount to this for any y.  The sines and cosines are
+ * derived from those of a = (x + y) / 2 and b = (x - y) / 2, which also give
+ * w1 = 1 + w = cos^2 (a) + cos^2 (b) without cancellation near the antipode
+ * of the optical axis.
+ */
+static inline void erect_to_sphere (__m256 x, __m256 y, __m256 &vx, __m256 &vy, __m256 &w,
+                                    __m256 &w1)
+{
+    const __m256 half = _mm256_set1_ps (0.5f);
+    __m256 sa, ca, sb, cb;
+    sincos_ps (_mm256_mul_ps (_mm256_add_ps (x, y), half), sa, ca);
+    sincos_ps (_mm256_mul_ps (_mm256_sub_ps (x, y), half), sb, cb);
+    const __m256 sacb = _mm256_mul_ps (sa, cb), casb = _mm256_mul_ps (ca, sb);
+    const __m256 cacb = _mm256_mul_ps (ca, cb), sasb = _mm256_mul_ps (sa, sb);
+    const __m256 cos_y = _mm256_add_ps (cacb, sasb);
+    vx = _mm256_mul_ps (cos_y, _mm256_add_ps (sacb, casb));
+    vy = _mm256_sub_ps (sacb, casb);
+    w = _mm256_mul_ps (cos_y, _mm256_sub_ps (cacb, sasb));
+    w1 = _mm256_fmadd_ps (ca, ca, _mm256_mul_ps (cb, cb));
+}
+
+static inline void erect_to_sphere (__m256 x, __m256 y, __m256 &vx, __m256 &vy, __m256 &w)
+{
+    __m256 w1;
+    erect_to_sphere (x, y, vx, vy, w, w1);
+}
+
+/*
+ * The inverse of erect_to_sphere () for points given by their distance k * r
+ * from the optical axis in the direction (x, y) / r and the cosine vz of
+ * their angle to it.
+ */
+static inline void sphere_to_erect (__m256 k, __m256 vz, __m256 &x, __m256 &y)
+{
+    const __m256 kx = _mm256_mul_ps (k, x);
+    const __m256 ky = _mm256_mul_ps (k, y);
+    x = atan2_ps (kx, vz);
+    y = atan_ps (_mm256_div_ps (ky, _mm256_sqrt_ps (_mm256_fmadd_ps (kx, kx, _mm256_mul_ps (vz, vz)))));
+}
+
+static inline __m256 radius_ps (__m256 x, __m256 y)
+{
+    return _mm256_sqrt_ps (_mm256_fmadd_ps (x, x, _mm256_mul_ps (y, y)));
+}
+
+struct Geom_FishEye_Rect_AVX2
+{
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        const __m256 r = radius_ps (x, y);
+        __m256 s, c;
+        sincos_ps (r, s, c);
+        __m256 rho = _mm256_div_ps (s, _mm256_mul_ps (c, r));
+        rho = _mm256_blendv_ps (rho, _mm256_set1_ps (1.0f),
+                                _mm256_cmp_ps (r, _mm256_setzero_ps (), _CMP_EQ_OQ));
+        rho = _mm256_blendv_ps (rho, _mm256_set1_ps (1.6e16F),
+                                _mm256_cmp_ps (r, _mm256_set1_ps (M_PI / 2.0), _CMP_GE_OQ));
+        x = _mm256_mul_ps (rho, x);
+        y = _mm256_mul_ps (rho, y);
+    }
+};
+
+struct Geom_Rect_FishEye_AVX2
+{
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        const __m256 r = radius_ps (x, y);
+        __m256 theta = _mm256_div_ps (atan_ps (r), r);
+        theta = _mm256_blendv_ps (theta, _mm256_set1_ps (1.0f),
+                                  _mm256_cmp_ps (r, _mm256_setzero_ps (), _CMP_EQ_OQ));
+        x = _mm256_mul_ps (theta, x);
+        y = _mm256_mul_ps (theta, y);
+    }
+};
+
+struct Geom_Panoramic_Rect_AVX2
+{
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        __m256 s, c;
+        sincos_ps (x, s, c);
+        x = _mm256_div_ps (s, c);
+        y = _mm256_div_ps (y, c);
+    }
+};
+
+struct Geom_Rect_Panoramic_AVX2
+{
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        y = _mm256_div_ps (y, _mm256_sqrt_ps (_mm256_fmadd_ps (x, x, _mm256_set1_ps (1.0f))));
+        x = atan_ps (x);
+    }
+};
+
+struct Geom_FishEye_Panoramic_AVX2
+{
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        const __m256 r = radius_ps (x, y);
+        __m256 s, vx;
+        sincos_ps (r, s, vx);
+        s = _mm256_div_ps (s, r);
+        s = _mm256_blendv_ps (s, _mm256_set1_ps (1.0f),
+                              _mm256_cmp_ps (r, _mm256_setzero_ps (), _CMP_EQ_OQ));
+        const __m256 vy = _mm256_mul_ps (s, x);
+        x = atan2_ps (vy, vx);
+        y = _mm256_div_ps (_mm256_mul_ps (s, y), radius_ps (vx, vy));
+    }
+};
+
+struct Geom_Panoramic_FishEye_AVX2
+{
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        __m256 s, c;
+        sincos_ps (x, s, c);
+        const __m256 r = radius_ps (s, y);
+        __m256 theta = _mm256_div_ps (atan2_ps (r, c), r);
+        theta = _mm256_andnot_ps (_mm256_cmp_ps (r, _mm256_setzero_ps (), _CMP_EQ_OQ), theta);
+        x = _mm256_mul_ps (theta, s);
+        y = _mm256_mul_ps (theta, y);
+    }
+};
+
+struct Geom_ERect_Rect_AVX2
+{
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        __m256 vx, vy, w;
+        erect_to_sphere (x, y, vx, vy, w);
+        x = _mm256_div_ps (vx, w);
+        y = _mm256_div_ps (vy, w);
+    }
+};
+
+struct Geom_Rect_ERect_AVX2
+{
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        y = atan_ps (_mm256_div_ps (y, _mm256_sqrt_ps (_mm256_fmadd_ps (x, x, _mm256_set1_ps (1.0f)))));
+        x = atan_ps (x);
+    }
+};
+
+struct Geom_ERect_FishEye_AVX2
+{
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        __m256 vx, vy, w;
+        erect_to_sphere (x, y, vx, vy, w);
+        const __m256 r = radius_ps (vx, vy);
+        __m256 k = _mm256_div_ps (atan2_ps (r, w), r);
+        k = _mm256_blendv_ps (k, _mm256_set1_ps (1.0f),
+                              _mm256_cmp_ps (r, _mm256_setzero_ps (), _CMP_EQ_OQ));
+        x = _mm256_mul_ps (k, vx);
+        y = _mm256_mul_ps (k, vy);
+    }
+};
+
+struct Geom_FishEye_ERect_AVX2
+{
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        const __m256 r = radius_ps (x, y);
+        __m256 s, vx;
+        sincos_ps (r, s, vx);
+        s = _mm256_div_ps (s, r);
+        s = _mm256_blendv_ps (s, _mm256_set1_ps (1.0f),
+                              _mm256_cmp_ps (r, _mm256_setzero_ps (), _CMP_EQ_OQ));
+        sphere_to_erect (s, vx, x, y);
+    }
+};
+
+struct Geom_ERect_Panoramic_AVX2
+{
+    inline void operator () (__m256 &, __m256 &y) const
+    {
+        __m256 s, c;
+        sincos_ps (y, s, c);
+        y = _mm256_div_ps (s, c);
+    }
+};
+
+struct Geom_Panoramic_ERect_AVX2
+{
+    inline void operator () (__m256 &, __m256 &y) const
+    {
+        y = atan_ps (y);
+    }
+};
+
+struct Geom_Orthographic_ERect_AVX2
+{
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        // sin (theta) = min (r, 1)
+        const __m256 one = _mm256_set1_ps (1.0f);
+        const __m256 r = radius_ps (x, y);
+        const __m256 m = _mm256_min_ps (r, one);
+        const __m256 vz = _mm256_sqrt_ps (_mm256_mul_ps (_mm256_sub_ps (one, m),
+                                                         _mm256_add_ps (one, m)));
+        const __m256 k = _mm256_blendv_ps (_mm256_div_ps (one, r), one,
+                                           _mm256_cmp_ps (r, one, _CMP_LT_OQ));
+        sphere_to_erect (k, vz, x, y);
+    }
+};
+
+struct Geom_ERect_Orthographic_AVX2
+{
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        // rho = sin (theta) is just the distance from the optical axis
+        __m256 vx, vy, w;
+        erect_to_sphere (x, y, vx, vy, w);
+        x = vx;
+        y = vy;
+    }
+};
+
+struct Geom_Stereographic_ERect_AVX2
+{
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        // With c = 2 atan (rh / 2): sin (c) = rh / (1 + rh^2 / 4),
+        // cos (c) = (1 - rh^2 / 4) / (1 + rh^2 / 4)
+        const __m256 eps = _mm256_set1_ps (EPSLN);
+        const __m256 inf = _mm256_set1_ps (1.6e16F);
+        const __m256 rh = radius_ps (x, y);
+        const __m256 q = _mm256_mul_ps (_mm256_mul_ps (rh, rh), _mm256_set1_ps (0.25f));
+        const __m256 cos_num = _mm256_sub_ps (_mm256_set1_ps (1.0f), q);
+
+        __m256 lat = asin_signed_ps (_mm256_div_ps (y, _mm256_add_ps (_mm256_set1_ps (1.0f), q)));
+        __m256 lon = atan2_ps (x, cos_num);
+        lon = _mm256_blendv_ps (inf, lon, _mm256_or_ps (
+            _mm256_cmp_ps (abs_ps (cos_num), eps, _CMP_GE_OQ),
+            _mm256_cmp_ps (abs_ps (x), eps, _CMP_GE_OQ)));
+
+        const __m256 centre = _mm256_cmp_ps (rh, eps, _CMP_LE_OQ);
+        x = _mm256_andnot_ps (centre, lon);
+        y = _mm256_blendv_ps (lat, inf, centre);
+    }
+};
+
+struct Geom_ERect_Stereographic_AVX2
+{
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        __m256 vx, vy, w, w1;
+        erect_to_sphere (x, y, vx, vy, w, w1);
+        const __m256 ksp = _mm256_div_ps (_mm256_set1_ps (2.0f), w1);
+        x = _mm256_mul_ps (ksp, vx);
+        y = _mm256_mul_ps (ksp, vy);
+    }
+};
+
+struct Geom_Equisolid_ERect_AVX2
+{
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        // With theta = 2 asin (r / 2): sin (theta) = r sqrt (1 - r^2 / 4),
+        // cos (theta) = 1 - r^2 / 2
+        const __m256 one = _mm256_set1_ps (1.0f);
+        const __m256 r = radius_ps (x, y);
+        const __m256 r2 = _mm256_mul_ps (r, r);
+        const __m256 inside = _mm256_cmp_ps (r, _mm256_set1_ps (2.0f), _CMP_LT_OQ);
+        const __m256 k = _mm256_blendv_ps (
+            _mm256_div_ps (one, r),
+            _mm256_sqrt_ps (_mm256_fnmadd_ps (r2, _mm256_set1_ps (0.25f), one)), inside);
+        const __m256 vz = _mm256_and_ps (inside, _mm256_fnmadd_ps (r2, _mm256_set1_ps (0.5f), one));
+        sphere_to_erect (k, vz, x, y);
+    }
+};
+
+struct Geom_ERect_Equisolid_AVX2
+{
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        __m256 vx, vy, w, d;
+        erect_to_sphere (x, y, vx, vy, w, d);
+        const __m256 k1 = _mm256_sqrt_ps (_mm256_div_ps (_mm256_set1_ps (2.0f), d));
+        const __m256 pole = _mm256_cmp_ps (abs_ps (d), _mm256_set1_ps (EPSLN), _CMP_LE_OQ);
+        x = _mm256_blendv_ps (_mm256_mul_ps (k1, vx), _mm256_set1_ps (1.6e16F), pole);
+        y = _mm256_blendv_ps (_mm256_mul_ps (k1, vy), _mm256_set1_ps (1.6e16F), pole);
+    }
+};
+
+struct Geom_Thoby_ERect_AVX2
+{
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        const __m256 rho = radius_ps (x, y);
+        const __m256 theta = _mm256_mul_ps (
+            asin_ps (_mm256_min_ps (_mm256_mul_ps (rho, _mm256_set1_ps (1.0f / THOBY_K1_PARM)),
+                                    _mm256_set1_ps (1.0f))),
+            _mm256_set1_ps (1.0f / THOBY_K2_PARM));
+        __m256 s, vz;
+        sincos_ps (theta, s, vz);
+        __m256 k = _mm256_div_ps (s, rho);
+        k = _mm256_andnot_ps (_mm256_cmp_ps (rho, _mm256_setzero_ps (), _CMP_EQ_OQ), k);
+        const __m256 outside = _mm256_cmp_ps (rho, _mm256_set1_ps (THOBY_K1_PARM), _CMP_GT_OQ);
+        sphere_to_erect (k, vz, x, y);
+        x = _mm256_blendv_ps (x, _mm256_set1_ps (1.6e16F), outside);
+        y = _mm256_blendv_ps (y, _mm256_set1_ps (1.6e16F), outside);
+    }
+};
+
+struct Geom_ERect_Thoby_AVX2
+{
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        __m256 vx, vy, w;
+        erect_to_sphere (x, y, vx, vy, w);
+        const __m256 r = radius_ps (vx, vy);
+        __m256 s, c;
+        sincos_ps (_mm256_mul_ps (atan2_ps (r, w), _mm256_set1_ps (THOBY_K2_PARM)), s, c);
+        const __m256 rho = _mm256_mul_ps (s, _mm256_set1_ps (THOBY_K1_PARM));
+        // On the optical axis, the plain code takes the direction as (1, 0)
+        const __m256 axis = _mm256_cmp_ps (r, _mm256_setzero_ps (), _CMP_EQ_OQ);
+        const __m256 k = _mm256_div_ps (rho, r);
+        x = _mm256_blendv_ps (_mm256_mul_ps (k, vx), rho, axis);
+        y = _mm256_andnot_ps (axis, _mm256_mul_ps (k, vy));
+    }
+};
+
+/*
+ * Direct conversions between the rectilinear and the fisheye-like
+ * projections, see ModifyCoord_Geom_Rect_Orthographic and following.  All
+ * of them scale the point by a factor k depending on r^2 only.
+ */
+
+template<typename Radial> struct Geom_Radial_AVX2
+{
+    Radial radial;
+
+    inline void operator () (__m256 &x, __m256 &y) const
+    {
+        const __m256 k = radial (_mm256_fmadd_ps (x, x, _mm256_mul_ps (y, y)));
+        x = _mm256_mul_ps (k, x);
+        y = _mm256_mul_ps (k, y);
+    }
+};
+
+/// cos (theta) for a rectilinear radius
+static inline __m256 rect_cos_ps (__m256 r2)
+{
+    return _mm256_div_ps (_mm256_set1_ps (1.0f), _mm256_sqrt_ps (_mm256_add_ps (_mm256_set1_ps (1.0f), r2)));
+}
+
+/// k for r2 < limit, "infinity" beyond
+static inline __m256 limit_ps (__m256 k, __m256 r2, float limit)
+{
+    return _mm256_blendv_ps (_mm256_set1_ps (1.6e16F), k,
+                             _mm256_cmp_ps (r2, _mm256_set1_ps (limit), _CMP_LT_OQ));
+}
+
+struct Rect_Orthographic_Radial
+{
+    inline __m256 operator () (__m256 r2) const
+    {
+        return rect_cos_ps (r2);
+    }
+};
+
+struct Orthographic_Rect_Radial
+{
+    inline __m256 operator () (__m256 r2) const
+    {
+        const __m256 k = _mm256_div_ps (_mm256_set1_ps (1.0f),
+                                        _mm256_sqrt_ps (_mm256_sub_ps (_mm256_set1_ps (1.0f), r2)));
+        return limit_ps (k, r2, 1.0f);
+    }
+};
+
+struct Rect_Stereographic_Radial
+{
+    inline __m256 operator () (__m256 r2) const
+    {
+        const __m256 c = rect_cos_ps (r2);
+        return _mm256_div_ps (_mm256_add_ps (c, c), _mm256_add_ps (_mm256_set1_ps (1.0f), c));
+    }
+};
+
+struct Stereographic_Rect_Radial
+{
+    inline __m256 operator () (__m256 r2) const
+    {
+        const __m256 k = _mm256_div_ps (_mm256_set1_ps (1.0f),
+                                        _mm256_fnmadd_ps (r2, _mm256_set1_ps (0.25f), _mm256_set1_ps (1.0f)));
+        return limit_ps (k, r2, 4.0f);
+    }
+};
+
+struct Rect_Equisolid_Radial
+{
+    inline __m256 operator () (__m256 r2) const
+    {
+        const __m256 c = rect_cos_ps (r2);
+        return _mm256_mul_ps (c, _mm256_sqrt_ps (_mm256_div_ps (
+            _mm256_set1_ps (2.0f), _mm256_add_ps (_mm256_set1_ps (1.0f), c))));
+    }
+};
+
+struct Equisolid_Rect_Radial
+{
+    inline __m256 operator () (__m256 r2) const
+    {
+        const __m256 one = _mm256_set1_ps (1.0f);
+        const __m256 k = _mm256_div_ps (
+            _mm256_sqrt_ps (_mm256_fnmadd_ps (r2, _mm256_set1_ps (0.25f), one)),
+            _mm256_fnmadd_ps (r2, _mm256_set1_ps (0.5f), one));
+        return limit_ps (k, r2, 2.0f);
+    }
+};
+
+struct Rect_Thoby_Radial
+{
+    inline __m256 operator () (__m256 r2) const
+    {
+        const __m256 r = _mm256_sqrt_ps (r2);
+        __m256 s, c;
+        sincos_ps (_mm256_mul_ps (atan_ps (r), _mm256_set1_ps (THOBY_K2_PARM)), s, c);
+        const __m256 k = _mm256_div_ps (_mm256_mul_ps (s, _mm256_set1_ps (THOBY_K1_PARM)), r);
+        return _mm256_blendv_ps (k, _mm256_set1_ps (THOBY_K1_PARM * THOBY_K2_PARM),
+                                 _mm256_cmp_ps (r, _mm256_setzero_ps (), _CMP_EQ_OQ));
+    }
+};
+
+struct Thoby_Rect_Radial
+{
+    inline __m256 operator () (__m256 r2) const
+    {
+        const __m256 r = _mm256_sqrt_ps (r2);
+        const __m256 theta = _mm256_mul_ps (
+            asin_ps (_mm256_min_ps (_mm256_mul_ps (r, _mm256_set1_ps (1.0f / THOBY_K1_PARM)),
+                                    _mm256_set1_ps (1.0f))),
+            _mm256_set1_ps (1.0f / THOBY_K2_PARM));
+        __m256 s, c;
+        sincos_ps (theta, s, c);
+        __m256 k = _mm256_div_ps (s, _mm256_mul_ps (c, r));
+        k = _mm256_blendv_ps (k, _mm256_set1_ps (1.6e16F), _mm256_or_ps (
+            _mm256_cmp_ps (r, _mm256_set1_ps (THOBY_K1_PARM), _CMP_GT_OQ),
+            _mm256_cmp_ps (theta, _mm256_set1_ps (M_PI / 2.0), _CMP_GE_OQ)));
+        return _mm256_blendv_ps (k, _mm256_set1_ps (1.0f / (THOBY_K1_PARM * THOBY_K2_PARM)),
+                                 _mm256_cmp_ps (r, _mm256_setzero_ps (), _CMP_EQ_OQ));
+    }
+};
+
+typedef Geom_Radial_AVX2<Rect_Orthographic_Radial> Geom_Rect_Orthographic_AVX2;
+typedef Geom_Radial_AVX2<Orthographic_Rect_Radial> Geom_Orthographic_Rect_AVX2;
+typedef Geom_Radial_AVX2<Rect_Stereographic_Radial> Geom_Rect_Stereographic_AVX2;
+typedef Geom_Radial_AVX2<Stereographic_Rect_Radial> Geom_Stereographic_Rect_AVX2;
+typedef Geom_Radial_AVX2<Rect_Equisolid_Radial> Geom_Rect_Equisolid_AVX2;
+typedef Geom_Radial_AVX2<Equisolid_Rect_Radial> Geom_Equisolid_Rect_AVX2;
+typedef Geom_Radial_AVX2<Rect_Thoby_Radial> Geom_Rect_Thoby_AVX2;
+typedef Geom_Radial_AVX2<Thoby_Rect_Radial> Geom_Thoby_Rect_AVX2;
+
+/*
+ * Apply a stage to all complete blocks of 8 points in the buffer.  Returns
+ * the position of the count % 8 remaining points.
+ */
+template<typename Stage> static inline float *apply_stage (
+    const Stage &stage, float *iocoord, int count)
+{
+    for (float *end = iocoord + (count & ~7) * 2; iocoord < end; iocoord += 16)
+    {
+        __m256 x, y;
+        load_xy (iocoord, x, y);
+        stage (x, y);
+        store_xy (iocoord, x, y);
+    }
+    return iocoord;
+}
+
+//------------------------------------------------------------------------//
+
+void lfModifier::ModifyCoord_Dist_Poly3_AVX2 (void *data, float *iocoord, int count)
+{
+    lfCoordDistCallbackData* cddata = (lfCoordDistCallbackData*) data;
+    iocoord = apply_stage (Dist_Poly3_AVX2 (cddata->terms), iocoord, count);
+    if (count % 8)
+        ModifyCoord_Dist_Poly3 (data, iocoord, count % 8);
+}
+
+void lfModifier::ModifyCoord_Dist_Poly5_AVX2 (void *data, float *iocoord, int count)
+{
+    lfCoordDistCallbackData* cddata = (lfCoordDistCallbackData*) data;
+    iocoord = apply_stage (Dist_Poly5_AVX2 (cddata->terms), iocoord, count);
+    if (count % 8)
+        ModifyCoord_Dist_Poly5 (data, iocoord, count % 8);
+}
+
+void lfModifier::ModifyCoord_Dist_PTLens_AVX2 (void *data, float *iocoord, int count)
+{
+    lfCoordDistCallbackData* cddata = (lfCoordDistCallbackData*) data;
+    iocoord = apply_stage (Dist_PTLens_AVX2 (cddata->terms), iocoord, count);
+    if (count % 8)
+        ModifyCoord_Dist_PTLens (data, iocoord, count % 8);
+}
+
+void lfModifier::ModifyCoord_Dist_ACM_AVX2 (void *data, float *iocoord, int count)
+{
+    lfCoordDistCallbackData* cddata = (lfCoordDistCallbackData*) data;
+    iocoord = apply_stage (Dist_ACM_AVX2 (cddata->terms), iocoord, count);
+    if (count % 8)
+        ModifyCoord_Dist_ACM (data, iocoord, count % 8);
+}
+
+void lfModifier::ModifyCoord_UnDist_Poly3_AVX2 (void *data, float *iocoord, int count)
+{
+    lfCoordDistCallbackData* cddata = (lfCoordDistCallbackData*) data;
+    iocoord = apply_stage (UnDist_Poly3_AVX2 (cddata->terms), iocoord, count);
+    if (count % 8)
+        ModifyCoord_UnDist_Poly3 (data, iocoord, count % 8);
+}
+
+void lfModifier::ModifyCoord_UnDist_Poly5_AVX2 (void *data, float *iocoord, int count)
+{
+    lfCoordDistCallbackData* cddata = (lfCoordDistCallbackData*) data;
+    iocoord = apply_stage (UnDist_Poly5_AVX2 (cddata->terms), iocoord, count);
+    if (count % 8)
+        ModifyCoord_UnDist_Poly5 (data, iocoord, count % 8);
+}
+
+void lfModifier::ModifyCoord_UnDist_PTLens_AVX2 (void *data, float *iocoord, int count)
+{
+    lfCoordDistCallbackData* cddata = (lfCoordDistCallbackData*) data;
+    iocoord = apply_stage (UnDist_PTLens_AVX2 (cddata->terms), iocoord, count);
+    if (count % 8)
+        ModifyCoord_UnDist_PTLens (data, iocoord, count % 8);
+}
+
+void lfModifier::ModifyCoord_UnDist_ACM_AVX2 (void *data, float *iocoord, int count)
+{
+    lfCoordACMCallbackData* cddata = (lfCoordACMCallbackData*) data;
+    iocoord = apply_stage (UnDist_ACM_AVX2 (cddata->terms, &cddata->chains->unconverged),
+                           iocoord, count);
+    if (count % 8)
+        ModifyCoord_UnDist_ACM (data, iocoord, count % 8);
+}
+
+void lfModifier::ModifyCoord_UnDist_Fit_AVX2 (void *data, float *iocoord, int count)
+{
+    lfCoordDistFitCallbackData* cddata = (lfCoordDistFitCallbackData*) data;
+    iocoord = apply_stage (UnDist_Fit_AVX2 (data, ModifyCoord_UnDist_Fit, cddata->max_rd,
+                                            cddata->coeffs, cddata->coeff_count),
+                           iocoord, count);
+    if (count % 8)
+        ModifyCoord_UnDist_Fit (data, iocoord, count % 8);
+}
+
+#define GEOM_CALLBACK_AVX2(name)                                                \
+void lfModifier::ModifyCoord_Geom_##name##_AVX2 (void *data, float *iocoord, int count) \
+{                                                                               \
+    iocoord = apply_stage (Geom_##name##_AVX2 (), iocoord, count);              \
+    if (count % 8)                                                              \
+        ModifyCoord_Geom_##name (data, iocoord, count % 8);                     \
+}
+
+GEOM_CALLBACK_AVX2 (FishEye_Rect)
+GEOM_CALLBACK_AVX2 (Rect_FishEye)
+GEOM_CALLBACK_AVX2 (Panoramic_Rect)
+GEOM_CALLBACK_AVX2 (Rect_Panoramic)
+GEOM_CALLBACK_AVX2 (FishEye_Panoramic)
+GEOM_CALLBACK_AVX2 (Panoramic_FishEye)
+GEOM_CALLBACK_AVX2 (ERect_Rect)
+GEOM_CALLBACK_AVX2 (Rect_ERect)
+GEOM_CALLBACK_AVX2 (ERect_FishEye)
+GEOM_CALLBACK_AVX2 (FishEye_ERect)
+GEOM_CALLBACK_AVX2 (ERect_Panoramic)
+GEOM_CALLBACK_AVX2 (Panoramic_ERect)
+GEOM_CALLBACK_AVX2 (Orthographic_ERect)
+GEOM_CALLBACK_AVX2 (ERect_Orthographic)
+GEOM_CALLBACK_AVX2 (Stereographic_ERect)
+GEOM_CALLBACK_AVX2 (ERect_Stereographic)
+GEOM_CALLBACK_AVX2 (Equisolid_ERect)
+GEOM_CALLBACK_AVX2 (ERect_Equisolid)
+GEOM_CALLBACK_AVX2 (Thoby_ERect)
+GEOM_CALLBACK_AVX2 (ERect_Thoby)
+GEOM_CALLBACK_AVX2 (Orthographic_Rect)
+GEOM_CALLBACK_AVX2 (Rect_Orthographic)
+GEOM_CALLBACK_AVX2 (Stereographic_Rect)
+GEOM_CALLBACK_AVX2 (Rect_Stereographic)
+GEOM_CALLBACK_AVX2 (Equisolid_Rect)
+GEOM_CALLBACK_AVX2 (Rect_Equisolid)
+GEOM_CALLBACK_AVX2 (Thoby_Rect)
+GEOM_CALLBACK_AVX2 (Rect_Thoby)
+
+#undef GEOM_CALLBACK_AVX2
+
+lfModifier::lfModifyCoordFunc lfModifier::GetGeomCallback_AVX2 (lfModifyCoordFunc func)
+{
+    static const lfModifyCoordFunc callbacks [][2] =
+    {
+        { ModifyCoord_Geom_FishEye_Rect, ModifyCoord_Geom_FishEye_Rect_AVX2 },
+        { ModifyCoord_Geom_Rect_FishEye, ModifyCoord_Geom_Rect_FishEye_AVX2 },
+        { ModifyCoord_Geom_Panoramic_Rect, ModifyCoord_Geom_Panoramic_Rect_AVX2 },
+        { ModifyCoord_Geom_Rect_Panoramic, ModifyCoord_Geom_Rect_Panoramic_AVX2 },
+        { ModifyCoord_Geom_FishEye_Panoramic, ModifyCoord_Geom_FishEye_Panoramic_AVX2 },
+        { ModifyCoord_Geom_Panoramic_FishEye, ModifyCoord_Geom_Panoramic_FishEye_AVX2 },
+        { ModifyCoord_Geom_ERect_Rect, ModifyCoord_Geom_ERect_Rect_AVX2 },
+        { ModifyCoord_Geom_Rect_ERect, ModifyCoord_Geom_Rect_ERect_AVX2 },
+        { ModifyCoord_Geom_ERect_FishEye, ModifyCoord_Geom_ERect_FishEye_AVX2 },
+        { ModifyCoord_Geom_FishEye_ERect, ModifyCoord_Geom_FishEye_ERect_AVX2 },
+        { ModifyCoord_Geom_ERect_Panoramic, ModifyCoord_Geom_ERect_Panoramic_AVX2 },
+        { ModifyCoord_Geom_Panoramic_ERect, ModifyCoord_Geom_Panoramic_ERect_AVX2 },
+        { ModifyCoord_Geom_Orthographic_ERect, ModifyCoord_Geom_Orthographic_ERect_AVX2 },
+        { ModifyCoord_Geom_ERect_Orthographic, ModifyCoord_Geom_ERect_Orthographic_AVX2 },
+        { ModifyCoord_Geom_Stereographic_ERect, ModifyCoord_Geom_Stereographic_ERect_AVX2 },
+        { ModifyCoord_Geom_ERect_Stereographic, ModifyCoord_Geom_ERect_Stereographic_AVX2 },
+        { ModifyCoord_Geom_Equisolid_ERect, ModifyCoord_Geom_Equisolid_ERect_AVX2 },
+        { ModifyCoord_Geom_ERect_Equisolid, ModifyCoord_Geom_ERect_Equisolid_AVX2 },
+        { ModifyCoord_Geom_Thoby_ERect, ModifyCoord_Geom_Thoby_ERect_AVX2 },
+        { ModifyCoord_Geom_ERect_Thoby, ModifyCoord_Geom_ERect_Thoby_AVX2 },
+        { ModifyCoord_Geom_Orthographic_Rect, ModifyCoord_Geom_Orthographic_Rect_AVX2 },
+        { ModifyCoord_Geom_Rect_Orthographic, ModifyCoord_Geom_Rect_Orthographic_AVX2 },
+        { ModifyCoord_Geom_Stereographic_Rect, ModifyCoord_Geom_Stereographic_Rect_AVX2 },
+        { ModifyCoord_Geom_Rect_Stereographic, ModifyCoord_Geom_Rect_Stereographic_AVX2 },
+        { ModifyCoord_Geom_Equisolid_Rect, ModifyCoord_Geom_Equisolid_Rect_AVX2 },
+        { ModifyCoord_Geom_Rect_Equisolid, ModifyCoord_Geom_Rect_Equisolid_AVX2 },
+        { ModifyCoord_Geom_Thoby_Rect, ModifyCoord_Geom_Thoby_Rect_AVX2 },
+        { ModifyCoord_Geom_Rect_Thoby, ModifyCoord_Geom_Rect_Thoby_AVX2 }
+    };
+    for (auto &cb : callbacks)
+        if (cb [0] == func)
+            return cb [1];
+    return func;
+}
+
+//------------------------------------------------------------------------//
+
+/*
+ * Pixel offsets of the lanes for generated rows.  Interleaved output uses the
+ * lane order of load_xy() / store_xy(), planes the natural order, so that
+ * neither needs any shuffles beyond those of store_xy().
+ */
+static inline __m256 row_lanes (int stride)
+{
+    return stride == 1 ? _mm256_setr_ps (0, 1, 2, 3, 4, 5, 6, 7) :
+                         _mm256_setr_ps (0, 1, 4, 5, 2, 3, 6, 7);
+}
+
+/// Store n <= 8 pixels of a generated row, see lfModifyCoordRowFunc
+static inline void store_row (float *res_x, float *res_y, int stride, int n,
+                              __m256 x, __m256 y)
+{
+    if (stride == 1)
+    {
+        if (n >= 8)
+        {
+            _mm256_storeu_ps (res_x, x);
+            _mm256_storeu_ps (res_y, y);
+        }
+        else
+        {
+            float block [16];
+            _mm256_storeu_ps (block, x);
+            _mm256_storeu_ps (block + 8, y);
+            memcpy (res_x, block, n * sizeof (float));
+            memcpy (res_y, block + 8, n * sizeof (float));
+        }
+    }
+    else if (n >= 8)
+        store_xy (res_x, x, y);
+    else
+    {
+        float block [16];
+        store_xy (block, x, y);
+        memcpy (res_x, block, n * 2 * sizeof (float));
+    }
+}
+
+/*
+ * The grid points of a block of a generated row, with the lanes beyond the
+ * end of the row at the centre.  Every stage is well-defined there, so
+ * that the padding never counts as a failure, see GetUnconvergedCount.
+ */
+static inline void row_block (__m256 lane, int i, int width, __m256 x0, __m256 y0,
+                              __m256 dx, __m256 &x, __m256 &y)
+{
+    const __m256 index = _mm256_add_ps (_mm256_set1_ps (float (i)), lane);
+    x = _mm256_fmadd_ps (index, dx, x0);
+    y = y0;
+    if (width - i < 8)
+    {
+        const __m256 pad = _mm256_cmp_ps (index, _mm256_set1_ps (float (width)), _CMP_GE_OQ);
+        x = _mm256_andnot_ps (pad, x);
+        y = _mm256_andnot_ps (pad, y);
+    }
+}
+
+/// Scaling only; the scale factors are folded into the grid anyway
+struct Identity_AVX2
+{
+    inline void operator () (__m256 &, __m256 &) const {}
+};
+
+/*
+ * One row of the fused coordinate kernel: the pixel grid is generated in
+ * registers, transformed by the stage and converted back to pixel
+ * coordinates before it is written out.  x is computed from the pixel index
+ * rather than accumulated, so that long rows don't drift.
+ */
+template<typename Stage> static void fused_row (
+    const Stage &stage, float x, float y, float dx, float out_scale,
+    float out_x, float out_y, int width, float *res_x, float *res_y, int stride)
+{
+    const __m256 lane = row_lanes (stride);
+    const __m256 vx0 = _mm256_set1_ps (x);
+    const __m256 vy0 = _mm256_set1_ps (y);
+    const __m256 vdx = _mm256_set1_ps (dx);
+    const __m256 vscale = _mm256_set1_ps (out_scale);
+    const __m256 vout_x = _mm256_set1_ps (out_x);
+    const __m256 vout_y = _mm256_set1_ps (out_y);
+
+    for (int i = 0; i < width; i += 8)
+    {
+        __m256 vx, vy;
+        row_block (lane, i, width, vx0, vy0, vdx, vx, vy);
+        stage (vx, vy);
+        vx = _mm256_fmadd_ps (vx, vscale, vout_x);
+        vy = _mm256_fmadd_ps (vy, vscale, vout_y);
+        store_row (res_x + i * stride, res_y + i * stride, stride, width - i, vx, vy);
+    }
+}
+
+/*
+ * A row of a chain of stages, see ModifyCoordRow_AVX2.  The pixel grid is
+ * generated in blocks of 64 points, which stay in L1 while every stage in
+ * turn is applied to them.  with_stage (i, f) passes the functor of stage i
+ * to f, so that the loop over a block is compiled for every functor.
+ */
+template<typename WithStage> static void chain_row (
+    WithStage with_stage, int length, const float *scales, float x, float y,
+    float dx, float out_scale, float out_x, float out_y, int width,
+    float *res_x, float *res_y, int stride)
+{
+    const int block = 8;
+    const __m256 lane = row_lanes (stride);
+    const __m256 vx0 = _mm256_set1_ps (x);
+    const __m256 vy0 = _mm256_set1_ps (y);
+    const __m256 vdx = _mm256_set1_ps (dx);
+    const __m256 vscale = _mm256_set1_ps (out_scale);
+    const __m256 vout_x = _mm256_set1_ps (out_x);
+    const __m256 vout_y = _mm256_set1_ps (out_y);
+    __m256 bx [block], by [block];
+
+    for (int i = 0; i < width; i += block * 8)
+    {
+        const int n = std::min (block, (width - i + 7) / 8);
+        for (int k = 0; k < n; k++)
+            row_block (lane, i + k * 8, width, vx0, vy0, vdx, bx [k], by [k]);
+
+        for (int s = 0; s < length; s++)
+            with_stage (s, [&] (const auto &stage)
+            {
+                const __m256 scale = _mm256_set1_ps (s ? scales [s - 1] : 1.0f);
+                for (int k = 0; k < n; k++)
+                {
+                    if (s)
+                    {
+                        bx [k] = _mm256_mul_ps (bx [k], scale);
+                        by [k] = _mm256_mul_ps (by [k], scale);
+                    }
+                    stage (bx [k], by [k]);
+                }
+            });
+
+        for (int k = 0; k < n; k++)
+        {
+            const int j = i + k * 8;
+            store_row (res_x + j * stride, res_y + j * stride, stride, width - j,
+                       _mm256_fmadd_ps (bx [k], vscale, vout_x),
+                       _mm256_fmadd_ps (by [k], vscale, vout_y));
+        }
+    }
+}
+
+int lfModifier::GetFusedStage_AVX2 (lfModifyCoordFunc func)
+{
+    static const lfModifyCoordFunc stages [] =
+    {
+        NULL,
+        ModifyCoord_Dist_Poly3_AVX2,
+        ModifyCoord_Dist_Poly5_AVX2,
+        ModifyCoord_Dist_PTLens_AVX2,
+        ModifyCoord_Dist_ACM_AVX2,
+        ModifyCoord_UnDist_Poly3_AVX2,
+        ModifyCoord_UnDist_Poly5_AVX2,
+        ModifyCoord_UnDist_PTLens_AVX2,
+        ModifyCoord_UnDist_ACM_AVX2,
+        ModifyCoord_UnDist_Fit_AVX2,
+        ModifyCoord_Geom_FishEye_Rect_AVX2,
+        ModifyCoord_Geom_Rect_FishEye_AVX2,
+        ModifyCoord_Geom_Panoramic_Rect_AVX2,
+        ModifyCoord_Geom_Rect_Panoramic_AVX2,
+        ModifyCoord_Geom_FishEye_Panoramic_AVX2,
+        ModifyCoord_Geom_Panoramic_FishEye_AVX2,
+        ModifyCoord_Geom_ERect_Rect_AVX2,
+        ModifyCoord_Geom_Rect_ERect_AVX2,
+        ModifyCoord_Geom_ERect_FishEye_AVX2,
+        ModifyCoord_Geom_FishEye_ERect_AVX2,
+        ModifyCoord_Geom_ERect_Panoramic_AVX2,
+        ModifyCoord_Geom_Panoramic_ERect_AVX2,
+        ModifyCoord_Geom_Orthographic_ERect_AVX2,
+        ModifyCoord_Geom_ERect_Orthographic_AVX2,
+        ModifyCoord_Geom_Stereographic_ERect_AVX2,
+        ModifyCoord_Geom_ERect_Stereographic_AVX2,
+        ModifyCoord_Geom_Equisolid_ERect_AVX2,
+        ModifyCoord_Geom_ERect_Equisolid_AVX2,
+        ModifyCoord_Geom_Thoby_ERect_AVX2,
+        ModifyCoord_Geom_ERect_Thoby_AVX2,
+        ModifyCoord_Geom_Orthographic_Rect_AVX2,
+        ModifyCoord_Geom_Rect_Orthographic_AVX2,
+        ModifyCoord_Geom_Stereographic_Rect_AVX2,
+        ModifyCoord_Geom_Rect_Stereographic_AVX2,
+        ModifyCoord_Geom_Equisolid_Rect_AVX2,
+        ModifyCoord_Geom_Rect_Equisolid_AVX2,
+        ModifyCoord_Geom_Thoby_Rect_AVX2,
+        ModifyCoord_Geom_Rect_Thoby_AVX2
+    };
+    for (int i = 0; i < int (sizeof (stages) / sizeof (stages [0])); i++)
+        if (stages [i] == func)
+            return i;
+    return -1;
+}
+
+void lfModifier::ModifyCoordRow_AVX2 (void *data, float x, float y, int width,
+                                      float *res_x, float *res_y, int stride)
+{
+    const lfCoordKernel *kernel = &((const lfModifier *) data)->CoordKernel;
+
+    // Pass the functor of a callback to f.  The ids are the indices of the
+    // table in GetFusedStage_AVX2.
+    auto with_stage = [] (lfCoordCallback *cb, int id, auto f)
+    {
+        const float *terms = cb ? ((lfCoordDistCallbackData *) cb)->terms : NULL;
+        switch (id)
+        {
+            case 0: f (Identity_AVX2 ()); break;
+            case 1: f (Dist_Poly3_AVX2 (terms)); break;
+            case 2: f (Dist_Poly5_AVX2 (terms)); break;
+            case 3: f (Dist_PTLens_AVX2 (terms)); break;
+            case 4: f (Dist_ACM_AVX2 (terms)); break;
+            case 5: f (UnDist_Poly3_AVX2 (terms)); break;
+            case 6: f (UnDist_Poly5_AVX2 (terms)); break;
+            case 7: f (UnDist_PTLens_AVX2 (terms)); break;
+            case 8:
+                f (UnDist_ACM_AVX2 (terms, &((lfCoordACMCallbackData *) cb)->chains->unconverged));
+                break;
+            case 9:
+            {
+                lfCoordDistFitCallbackData* cddata = (lfCoordDistFitCallbackData*) cb;
+                f (UnDist_Fit_AVX2 (cddata, ModifyCoord_UnDist_Fit, cddata->max_rd,
+                                    cddata->coeffs, cddata->coeff_count));
+                break;
+            }
+            case 10: f (Geom_FishEye_Rect_AVX2 ()); break;
+            case 11: f (Geom_Rect_FishEye_AVX2 ()); break;
+            case 12: f (Geom_Panoramic_Rect_AVX2 ()); break;
+            case 13: f (Geom_Rect_Panoramic_AVX2 ()); break;
+            case 14: f (Geom_FishEye_Panoramic_AVX2 ()); break;
+            case 15: f (Geom_Panoramic_FishEye_AVX2 ()); break;
+            case 16: f (Geom_ERect_Rect_AVX2 ()); break;
+            case 17: f (Geom_Rect_ERect_AVX2 ()); break;
+            case 18: f (Geom_ERect_FishEye_AVX2 ()); break;
+            case 19: f (Geom_FishEye_ERect_AVX2 ()); break;
+            case 20: f (Geom_ERect_Panoramic_AVX2 ()); break;
+            case 21: f (Geom_Panoramic_ERect_AVX2 ()); break;
+            case 22: f (Geom_Orthographic_ERect_AVX2 ()); break;
+            case 23: f (Geom_ERect_Orthographic_AVX2 ()); break;
+            case 24: f (Geom_Stereographic_ERect_AVX2 ()); break;
+            case 25: f (Geom_ERect_Stereographic_AVX2 ()); break;
+            case 26: f (Geom_Equisolid_ERect_AVX2 ()); break;
+            case 27: f (Geom_ERect_Equisolid_AVX2 ()); break;
+            case 28: f (Geom_Thoby_ERect_AVX2 ()); break;
+            case 29: f (Geom_ERect_Thoby_AVX2 ()); break;
+            case 30: f (Geom_Orthographic_Rect_AVX2 ()); break;
+            case 31: f (Geom_Rect_Orthographic_AVX2 ()); break;
+            case 32: f (Geom_Stereographic_Rect_AVX2 ()); break;
+            case 33: f (Geom_Rect_Stereographic_AVX2 ()); break;
+            case 34: f (Geom_Equisolid_Rect_AVX2 ()); break;
+            case 35: f (Geom_Rect_Equisolid_AVX2 ()); break;
+            case 36: f (Geom_Thoby_Rect_AVX2 ()); break;
+            case 37: f (Geom_Rect_Thoby_AVX2 ()); break;
+        }
+    };
+
+    if (!kernel->chain_length)
+        with_stage (kernel->stage, kernel->stage_id, [&] (const auto &stage)
+        {
+            fused_row (stage, x, y, kernel->dx, kernel->out_scale, kernel->out_x,
+                       kernel->out_y, width, res_x, res_y, stride);
+        });
+    else
+        chain_row ([&] (int i, auto f) { with_stage (kernel->chain [i], kernel->chain_id [i], f); },
+                   kernel->chain_length, kernel->chain_scale, x, y, kernel->dx,
+                   kernel->out_scale, kernel->out_x, kernel->out_y, width,
+                   res_x, res_y, stride);
+}
+
+/*
+ * Perspective stage of the fused kernel, see PerspectiveRow.  The numerators
+ * and the denominator are computed from the pixel index like the grid in
+ * fused_row, and the division uses the reciprocal estimate, refined by one
+ * Newton step.
+ */
+void lfModifier::ModifyCoordRow_Persp_AVX2 (void *data, float x, float y, int width,
+                                            float *res_x, float *res_y, int stride)
+{
+    lfPerspRow row;
+    PerspectiveRow (((const lfModifier *) data)->CoordKernel, x, y, row);
+
+    const __m256 lane = row_lanes (stride);
+    const __m256 x0 = _mm256_set1_ps (row.x0), dx = _mm256_set1_ps (row.dx);
+    const __m256 y0 = _mm256_set1_ps (row.y0), dy = _mm256_set1_ps (row.dy);
+    const __m256 z0 = _mm256_set1_ps (row.z0), dz = _mm256_set1_ps (row.dz);
+    const __m256 invalid_x = _mm256_set1_ps (row.invalid_x);
+    const __m256 invalid_y = _mm256_set1_ps (row.invalid_y);
+    const __m256 two = _mm256_set1_ps (2.0f);
+
+    for (int i = 0; i < width; i += 8)
+    {
+        const __m256 index = _mm256_add_ps (_mm256_set1_ps (float (i)), lane);
+        const __m256 z = _mm256_fmadd_ps (index, dz, z0);
+        __m256 r = _mm256_rcp_ps (z);
+        r = _mm256_mul_ps (r, _mm256_fnmadd_ps (z, r, two));
+        const __m256 valid = _mm256_cmp_ps (z, _mm256_setzero_ps (), _CMP_GT_OQ);
+
+        __m256 vx = _mm256_mul_ps (_mm256_fmadd_ps (index, dx, x0), r);
+        __m256 vy = _mm256_mul_ps (_mm256_fmadd_ps (index, dy, y0), r);
+        vx = _mm256_blendv_ps (invalid_x, vx, valid);
+        vy = _mm256_blendv_ps (invalid_y, vy, valid);
+        store_row (res_x + i * stride, res_y + i * stride, stride, width - i, vx, vy);
+    }
+}
+
+/*
+ * See the plain MirrorCoordRow.  Interleaved pairs keep their order, only
+ * the Y lanes are reflected.
+ */
+void lfModifier::MirrorCoordRow_AVX2 (const float *src_x, const float *src_y,
+                                      float *res_x, float *res_y, int count,
+                                      int stride, float flip)
+{
+    const __m256 vflip = _mm256_set1_ps (flip);
+    int i = 0;
+    if (stride == 2)
+        for (; i + 4 <= count; i += 4)
+        {
+            __m256 v = _mm256_loadu_ps (src_x + i * 2);
+            _mm256_storeu_ps (res_x + i * 2,
+                              _mm256_blend_ps (v, _mm256_sub_ps (vflip, v), 0xaa));
+        }
+    else if (stride == 1)
+        for (; i + 8 <= count; i += 8)
+        {
+            _mm256_storeu_ps (res_x + i, _mm256_loadu_ps (src_x + i));
+            _mm256_storeu_ps (res_y + i, _mm256_sub_ps (vflip, _mm256_loadu_ps (src_y + i)));
+        }
+    MirrorCoordRow (src_x + i * stride, src_y + i * stride, res_x + i * stride,
+                    res_y + i * stride, count - i, stride, flip);
+}
+
+/*
+ * See the plain ReflectCoordRow.  The source is read backwards, so the
+ * order of the pixels in a vector is reversed.
+ */
+void lfModifier::ReflectCoordRow_AVX2 (const float *src_x, const float *src_y,
+                                       float *res_x, float *res_y, int count,
+                                       int stride, float flip)
+{
+    const __m256 vflip = _mm256_set1_ps (flip);
+    int i = 0;
+    if (stride == 2)
+    {
+        const __m256i reverse = _mm256_setr_epi32 (6, 7, 4, 5, 2, 3, 0, 1);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m256 v = _mm256_permutevar8x32_ps (_mm256_loadu_ps (src_x - (i + 3) * 2), reverse);
+            _mm256_storeu_ps (res_x + i * 2,
+                              _mm256_blend_ps (v, _mm256_sub_ps (vflip, v), 0x55));
+        }
+    }
+    else if (stride == 1)
+    {
+        const __m256i reverse = _mm256_setr_epi32 (7, 6, 5, 4, 3, 2, 1, 0);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 vx = _mm256_permutevar8x32_ps (_mm256_loadu_ps (src_x - i - 7), reverse);
+            __m256 vy = _mm256_permutevar8x32_ps (_mm256_loadu_ps (src_y - i - 7), reverse);
+            _mm256_storeu_ps (res_x + i, _mm256_sub_ps (vflip, vx));
+            _mm256_storeu_ps (res_y + i, vy);
+        }
+    }
+    ReflectCoordRow (src_x - i * stride, src_y - i * stride, res_x + i * stride,
+                     res_y + i * stride, count - i, stride, flip);
+}
+
+/*
+ * Table lookup for purely radial chains, see BuildRadialTable and the plain
+ * ModifyCoordRow_Radial.  Blocks with points beyond the table are sent
+ * through the callbacks.
+ */
+void lfModifier::ModifyCoordRow_Radial_AVX2 (void *data, float x, float y, int width,
+                                             float *res_x, float *res_y, int stride)
+{
+    const lfModifier *modifier = (const lfModifier *) data;
+    const lfCoordKernel &kernel = modifier->CoordKernel;
+    const float *table = &kernel.radial [0];
+
+    const __m256 lane = row_lanes (stride);
+    const __m256 vx0 = _mm256_set1_ps (x);
+    const __m256 vy = _mm256_set1_ps (y);
+    const __m256 vy2 = _mm256_set1_ps (y * y);
+    const __m256 vdx = _mm256_set1_ps (kernel.dx);
+    const __m256 inv_step = _mm256_set1_ps (1.0f / kernel.radial_step);
+    const __m256 last = _mm256_set1_ps (float (kernel.radial.size () - 1));
+    const __m256 vscale = _mm256_set1_ps (kernel.out_scale);
+    const __m256 vout_x = _mm256_set1_ps (kernel.out_x);
+    const __m256 vout_y = _mm256_set1_ps (kernel.out_y);
+
+    for (int i = 0; i < width; i += 8)
+    {
+        __m256 vx = _mm256_fmadd_ps (_mm256_add_ps (_mm256_set1_ps (float (i)), lane),
+                                     vdx, vx0);
+        __m256 t = _mm256_mul_ps (_mm256_sqrt_ps (_mm256_fmadd_ps (vx, vx, vy2)), inv_step);
+        __m256 ox, oy;
+
+        if (_mm256_movemask_ps (_mm256_cmp_ps (t, last, _CMP_LT_OQ)) != 0xff)
+        {
+            // The callbacks work point by point, so the lane order of the
+            // block does not matter
+            float block [16];
+            store_xy (block, _mm256_fmadd_ps (vx, vscale, vout_x),
+                      _mm256_fmadd_ps (vy, vscale, vout_y));
+            modifier->ApplyCoordCallbacks (block, 8);
+            load_xy (block, ox, oy);
+        }
+        else
+        {
+            __m256i k = _mm256_cvttps_epi32 (t);
+            __m256 f = _mm256_sub_ps (t, _mm256_cvtepi32_ps (k));
+            __m256 r0 = _mm256_i32gather_ps (table, k, 4);
+            __m256 r1 = _mm256_i32gather_ps (table + 1, k, 4);
+            __m256 ratio = _mm256_mul_ps (_mm256_fmadd_ps (_mm256_sub_ps (r1, r0), f, r0), vscale);
+            ox = _mm256_fmadd_ps (vx, ratio, vout_x);
+            oy = _mm256_fmadd_ps (vy, ratio, vout_y);
+        }
+
+        store_row (res_x + i * stride, res_y + i * stride, stride, width - i, ox, oy);
+    }
+}
+
+#endif
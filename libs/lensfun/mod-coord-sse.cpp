@@ -197,4 +197,85 @@ void lfModifier::ModifyCoord_Dist_Poly3_SSE (void *data, float *iocoord, int cou
     ModifyCoord_Dist_Poly3 (data, &iocoord [loop_count * 2], remain);
 }
 
+void lfModifier::ValidMask_SSE (const float *coords, int count, float max_x, float max_y, lf_u32 *mask)
+{
+  __m128 zero = _mm_setzero_ps ();
+  __m128 max = _mm_setr_ps (max_x, max_y, max_x, max_y);
+
+  // Four pixels per step, 32 per mask word
+  int i;
+  for (i = 0; i + 32 <= count; i += 32, coords += 64)
+  {
+    lf_u32 word = 0;
+    for (int k = 0; k < 32; k += 4)
+    {
+      __m128 a = _mm_loadu_ps (coords + k * 2);
+      __m128 b = _mm_loadu_ps (coords + k * 2 + 4);
+      a = _mm_and_ps (_mm_cmpge_ps (a, zero), _mm_cmple_ps (a, max));
+      b = _mm_and_ps (_mm_cmpge_ps (b, zero), _mm_cmple_ps (b, max));
+      __m128 x = _mm_shuffle_ps (a, b, _MM_SHUFFLE (2, 0, 2, 0));
+      __m128 y = _mm_shuffle_ps (a, b, _MM_SHUFFLE (3, 1, 3, 1));
+      word |= lf_u32 (_mm_movemask_ps (_mm_and_ps (x, y))) << k;
+    }
+    mask [i / 32] = word;
+  }
+
+  if (i < count)
+    ValidMask (coords, count - i, max_x, max_y, mask + i / 32);
+}
+
+/*
+ * Perspective stage of the fused kernel, see PerspectiveRow.  The division
+ * uses the reciprocal estimate, refined by one Newton step to nearly full
+ * float precision.
+ */
+void lfModifier::ModifyCoordRow_Persp_SSE (void *data, float x, float y, int width,
+                                           float *res_x, float *res_y, int stride)
+{
+  lfPerspRow row;
+  PerspectiveRow (((const lfModifier *) data)->CoordKernel, x, y, row);
+
+  __m128 lane = _mm_setr_ps (0.0f, 1.0f, 2.0f, 3.0f);
+  __m128 x0 = _mm_set_ps1 (row.x0), dx = _mm_set_ps1 (row.dx);
+  __m128 y0 = _mm_set_ps1 (row.y0), dy = _mm_set_ps1 (row.dy);
+  __m128 z0 = _mm_set_ps1 (row.z0), dz = _mm_set_ps1 (row.dz);
+  __m128 invalid_x = _mm_set_ps1 (row.invalid_x), invalid_y = _mm_set_ps1 (row.invalid_y);
+  __m128 zero = _mm_setzero_ps ();
+  __m128 two = _mm_set_ps1 (2.0f);
+
+  int i;
+  for (i = 0; i + 4 <= width; i += 4)
+  {
+    __m128 index = _mm_add_ps (_mm_set_ps1 (float (i)), lane);
+    __m128 z = _mm_add_ps (z0, _mm_mul_ps (index, dz));
+    __m128 r = _mm_rcp_ps (z);
+    r = _mm_mul_ps (r, _mm_sub_ps (two, _mm_mul_ps (z, r)));
+    __m128 valid = _mm_cmpgt_ps (z, zero);
+
+    __m128 rx = _mm_mul_ps (_mm_add_ps (x0, _mm_mul_ps (index, dx)), r);
+    __m128 ry = _mm_mul_ps (_mm_add_ps (y0, _mm_mul_ps (index, dy)), r);
+    rx = _mm_or_ps (_mm_and_ps (valid, rx), _mm_andnot_ps (valid, invalid_x));
+    ry = _mm_or_ps (_mm_and_ps (valid, ry), _mm_andnot_ps (valid, invalid_y));
+
+    if (stride == 1)
+    {
+      _mm_storeu_ps (res_x + i, rx);
+      _mm_storeu_ps (res_y + i, ry);
+    }
+    else
+    {
+      _mm_storeu_ps (res_x + i * 2, _mm_unpacklo_ps (rx, ry));
+      _mm_storeu_ps (res_x + i * 2 + 4, _mm_unpackhi_ps (rx, ry));
+    }
+  }
+
+  for (; i < width; i++)
+  {
+    float z = row.z0 + i * row.dz;
+    bool valid = z > 0.0f;
+    res_x [i * stride] = valid ? (row.x0 + i * row.dx) / z : row.invalid_x;
+    res_y [i * stride] = valid ? (row.y0 + i * row.dy) / z : row.invalid_y;
+  }
+}
+
 #endif
@@ -0,0 +1,716 @@
+/*
+    Image modifier implementation: SSE2 projection changes
+
+    These are 4-lane versions of the projection callbacks in mod-coord.cpp,
+    for CPUs without AVX2 and FMA.  The math is that of mod-coord-avx2.cpp,
+    see there; only the blends and the argument reduction of sin and cos,
+    which have no SSE2 instructions of their own, are built differently.
+    The remaining count % 4 pixels are handed over to the plain code.
+*/
+
+#include "config.h"
+
+#ifdef VECTORIZATION_SSE2
+
+#include "lensfun.h"
+#include "lensfunprv.h"
+#include <emmintrin.h>
+#include <math.h>
+#include "windows/mathconstants.h"
+
+/// Load 4 interleaved (x, y) pairs and split them into x and y vectors
+static inline void load_xy (const float *iocoord, __m128 &x, __m128 &y)
+{
+    __m128 c0 = _mm_loadu_ps (iocoord);
+    __m128 c1 = _mm_loadu_ps (iocoord + 4);
+    x = _mm_shuffle_ps (c0, c1, _MM_SHUFFLE (2, 0, 2, 0));
+    y = _mm_shuffle_ps (c0, c1, _MM_SHUFFLE (3, 1, 3, 1));
+}
+
+static inline void store_xy (float *iocoord, __m128 x, __m128 y)
+{
+    _mm_storeu_ps (iocoord, _mm_unpacklo_ps (x, y));
+    _mm_storeu_ps (iocoord + 4, _mm_unpackhi_ps (x, y));
+}
+
+/// a * b + c, in two roundings
+static inline __m128 madd_ps (__m128 a, __m128 b, __m128 c)
+{
+    return _mm_add_ps (_mm_mul_ps (a, b), c);
+}
+
+/// c - a * b, in two roundings
+static inline __m128 nmadd_ps (__m128 a, __m128 b, __m128 c)
+{
+    return _mm_sub_ps (c, _mm_mul_ps (a, b));
+}
+
+/// b where all bits of mask are set, a where none are
+static inline __m128 blendv_ps (__m128 a, __m128 b, __m128 mask)
+{
+    return _mm_or_ps (_mm_andnot_ps (mask, a), _mm_and_ps (mask, b));
+}
+
+static inline __m128 abs_ps (__m128 x)
+{
+    return _mm_andnot_ps (_mm_set1_ps (-0.0f), x);
+}
+
+/// asin (s) for 0 <= s <= 1
+static inline __m128 asin_ps (__m128 s)
+{
+    const __m128 half = _mm_set1_ps (0.5f);
+    __m128 large = _mm_cmpgt_ps (s, half);
+    __m128 z = blendv_ps (_mm_mul_ps (s, s),
+                          _mm_mul_ps (half, _mm_sub_ps (_mm_set1_ps (1.0f), s)),
+                          large);
+    __m128 x = blendv_ps (s, _mm_sqrt_ps (z), large);
+
+    __m128 p = madd_ps (_mm_set1_ps (4.2163199048E-2f), z, _mm_set1_ps (2.4181311049E-2f));
+    p = madd_ps (p, z, _mm_set1_ps (4.5470025998E-2f));
+    p = madd_ps (p, z, _mm_set1_ps (7.4953002686E-2f));
+    p = madd_ps (p, z, _mm_set1_ps (1.6666752422E-1f));
+    p = madd_ps (_mm_mul_ps (p, z), x, x);
+
+    return blendv_ps (p, nmadd_ps (_mm_set1_ps (2.0f), p,
+                                   _mm_set1_ps (M_PI / 2)), large);
+}
+
+static inline __m128 copysign_ps (__m128 magnitude, __m128 sign)
+{
+    const __m128 mask = _mm_set1_ps (-0.0f);
+    return _mm_or_ps (_mm_andnot_ps (mask, magnitude), _mm_and_ps (mask, sign));
+}
+
+/*
+ * sin and cos.  Without FMA, the products with the first two parts of pi/2
+ * must be exact, so these are the shorter Cephes constants.
+ */
+static inline void sincos_ps (__m128 x, __m128 &s, __m128 &c)
+{
+    const __m128i q = _mm_cvtps_epi32 (_mm_mul_ps (x, _mm_set1_ps (2.0 / M_PI)));
+    const __m128 j = _mm_cvtepi32_ps (q);
+    __m128 r = nmadd_ps (j, _mm_set1_ps (1.5703125f), x);
+    r = nmadd_ps (j, _mm_set1_ps (4.837512969970703125e-4f), r);
+    r = nmadd_ps (j, _mm_set1_ps (7.54978995489188216e-8f), r);
+    // Stays finite for huge arguments, passes NaN through
+    r = _mm_min_ps (_mm_set1_ps (1.0f), _mm_max_ps (_mm_set1_ps (-1.0f), r));
+    const __m128 z = _mm_mul_ps (r, r);
+
+    __m128 ps = madd_ps (_mm_set1_ps (-1.9515295891E-4f), z, _mm_set1_ps (8.3321608736E-3f));
+    ps = madd_ps (ps, z, _mm_set1_ps (-1.6666654611E-1f));
+    ps = madd_ps (_mm_mul_ps (ps, z), r, r);
+
+    __m128 pc = madd_ps (_mm_set1_ps (2.443315711809948E-5f), z, _mm_set1_ps (-1.388731625493765E-3f));
+    pc = madd_ps (pc, z, _mm_set1_ps (4.166664568298827E-2f));
+    pc = madd_ps (_mm_mul_ps (pc, z), z, nmadd_ps (_mm_set1_ps (0.5f), z, _mm_set1_ps (1.0f)));
+
+    // Odd quadrants swap sin and cos, quadrants 2 and 3 negate sin, 1 and 2
+    // negate cos
+    const __m128i odd = _mm_and_si128 (q, _mm_set1_epi32 (1));
+    const __m128 swap = _mm_castsi128_ps (_mm_cmpeq_epi32 (odd, _mm_set1_epi32 (1)));
+    const __m128 sign_s = _mm_castsi128_ps (_mm_slli_epi32 (q, 30));
+    const __m128 sign_c = _mm_castsi128_ps (
+        _mm_slli_epi32 (_mm_add_epi32 (q, _mm_set1_epi32 (1)), 30));
+    const __m128 sign = _mm_set1_ps (-0.0f);
+    s = _mm_xor_ps (blendv_ps (ps, pc, swap), _mm_and_ps (sign_s, sign));
+    c = _mm_xor_ps (blendv_ps (pc, ps, swap), _mm_and_ps (sign_c, sign));
+}
+
+/// atan (x) for any x
+static inline __m128 atan_ps (__m128 x)
+{
+    const __m128 one = _mm_set1_ps (1.0f);
+    const __m128 a = abs_ps (x);
+    const __m128 big = _mm_cmpgt_ps (a, _mm_set1_ps (2.414213562373095f));
+    const __m128 mid = _mm_cmpgt_ps (a, _mm_set1_ps (0.4142135623730950f));
+
+    __m128 y0 = _mm_and_ps (mid, _mm_set1_ps (M_PI / 4));
+    y0 = blendv_ps (y0, _mm_set1_ps (M_PI / 2), big);
+    __m128 t = blendv_ps (a, _mm_div_ps (_mm_sub_ps (a, one), _mm_add_ps (a, one)), mid);
+    t = blendv_ps (t, _mm_div_ps (_mm_set1_ps (-1.0f), a), big);
+
+    const __m128 z = _mm_mul_ps (t, t);
+    __m128 p = madd_ps (_mm_set1_ps (8.05374449538e-2f), z, _mm_set1_ps (-1.38776856032E-1f));
+    p = madd_ps (p, z, _mm_set1_ps (1.99777106478E-1f));
+    p = madd_ps (p, z, _mm_set1_ps (-3.33329491539E-1f));
+    p = madd_ps (_mm_mul_ps (p, z), t, t);
+
+    return copysign_ps (_mm_add_ps (y0, p), x);
+}
+
+/// atan2, with atan2 (0, 0) = 0 like the C library
+static inline __m128 atan2_ps (__m128 y, __m128 x)
+{
+    const __m128 ax = abs_ps (x), ay = abs_ps (y);
+    const __m128 swap = _mm_cmpgt_ps (ay, ax);
+    const __m128 num = blendv_ps (ay, ax, swap);
+    const __m128 den = blendv_ps (ax, ay, swap);
+    const __m128 zero = _mm_cmpeq_ps (den, _mm_setzero_ps ());
+    __m128 r = atan_ps (_mm_andnot_ps (zero, _mm_div_ps (num, den)));
+
+    r = blendv_ps (r, _mm_sub_ps (_mm_set1_ps (M_PI / 2), r), swap);
+    r = blendv_ps (r, _mm_sub_ps (_mm_set1_ps (M_PI), r),
+                   _mm_castsi128_ps (_mm_srai_epi32 (_mm_castps_si128 (x), 31)));
+    r = copysign_ps (r, y);
+    return blendv_ps (r, _mm_add_ps (x, y), _mm_cmpunord_ps (x, y));
+}
+
+//------------------------------------------------------------------------//
+
+/*
+ * Projection changes.  Like the AVX2 versions, they agree with the plain code
+ * to within a few 1e-7 (relative) away from the singularities.
+ */
+
+/// asin (s) for -1 <= s <= 1
+static inline __m128 asin_signed_ps (__m128 s)
+{
+    return copysign_ps (asin_ps (_mm_min_ps (abs_ps (s), _mm_set1_ps (1.0f))), s);
+}
+
+/// The point on the unit sphere for equirectangular coordinates, and
+/// w1 = 1 + w
+static inline void erect_to_sphere (__m128 x, __m128 y, __m128 &vx, __m128 &vy, __m128 &w,
+                                    __m128 &w1)
+{
+    const __m128 half = _mm_set1_ps (0.5f);
+    __m128 sa, ca, sb, cb;
+    sincos_ps (_mm_mul_ps (_mm_add_ps (x, y), half), sa, ca);
+    sincos_ps (_mm_mul_ps (_mm_sub_ps (x, y), half), sb, cb);
+    const __m128 sacb = _mm_mul_ps (sa, cb), casb = _mm_mul_ps (ca, sb);
+    const __m128 cacb = _mm_mul_ps (ca, cb), sasb = _mm_mul_ps (sa, sb);
+    const __m128 cos_y = _mm_add_ps (cacb, sasb);
+    vx = _mm_mul_ps (cos_y, _mm_add_ps (sacb, casb));
+    vy = _mm_sub_ps (sacb, casb);
+    w = _mm_mul_ps (cos_y, _mm_sub_ps (cacb, sasb));
+    w1 = madd_ps (ca, ca, _mm_mul_ps (cb, cb));
+}
+
+static inline void erect_to_sphere (__m128 x, __m128 y, __m128 &vx, __m128 &vy, __m128 &w)
+{
+    __m128 w1;
+    erect_to_sphere (x, y, vx, vy, w, w1);
+}
+
+/// The inverse of erect_to_sphere ()
+static inline void sphere_to_erect (__m128 k, __m128 vz, __m128 &x, __m128 &y)
+{
+    const __m128 kx = _mm_mul_ps (k, x);
+    const __m128 ky = _mm_mul_ps (k, y);
+    x = atan2_ps (kx, vz);
+    y = atan_ps (_mm_div_ps (ky, _mm_sqrt_ps (madd_ps (kx, kx, _mm_mul_ps (vz, vz)))));
+}
+
+static inline __m128 radius_ps (__m128 x, __m128 y)
+{
+    return _mm_sqrt_ps (madd_ps (x, x, _mm_mul_ps (y, y)));
+}
+
+struct Geom_FishEye_Rect_SSE2
+{
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        const __m128 r = radius_ps (x, y);
+        __m128 s, c;
+        sincos_ps (r, s, c);
+        __m128 rho = _mm_div_ps (s, _mm_mul_ps (c, r));
+        rho = blendv_ps (rho, _mm_set1_ps (1.0f),
+                         _mm_cmpeq_ps (r, _mm_setzero_ps ()));
+        rho = blendv_ps (rho, _mm_set1_ps (1.6e16F),
+                         _mm_cmpge_ps (r, _mm_set1_ps (M_PI / 2.0)));
+        x = _mm_mul_ps (rho, x);
+        y = _mm_mul_ps (rho, y);
+    }
+};
+
+struct Geom_Rect_FishEye_SSE2
+{
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        const __m128 r = radius_ps (x, y);
+        __m128 theta = _mm_div_ps (atan_ps (r), r);
+        theta = blendv_ps (theta, _mm_set1_ps (1.0f),
+                           _mm_cmpeq_ps (r, _mm_setzero_ps ()));
+        x = _mm_mul_ps (theta, x);
+        y = _mm_mul_ps (theta, y);
+    }
+};
+
+struct Geom_Panoramic_Rect_SSE2
+{
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        __m128 s, c;
+        sincos_ps (x, s, c);
+        x = _mm_div_ps (s, c);
+        y = _mm_div_ps (y, c);
+    }
+};
+
+struct Geom_Rect_Panoramic_SSE2
+{
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        y = _mm_div_ps (y, _mm_sqrt_ps (madd_ps (x, x, _mm_set1_ps (1.0f))));
+        x = atan_ps (x);
+    }
+};
+
+struct Geom_FishEye_Panoramic_SSE2
+{
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        const __m128 r = radius_ps (x, y);
+        __m128 s, vx;
+        sincos_ps (r, s, vx);
+        s = _mm_div_ps (s, r);
+        s = blendv_ps (s, _mm_set1_ps (1.0f),
+                       _mm_cmpeq_ps (r, _mm_setzero_ps ()));
+        const __m128 vy = _mm_mul_ps (s, x);
+        x = atan2_ps (vy, vx);
+        y = _mm_div_ps (_mm_mul_ps (s, y), radius_ps (vx, vy));
+    }
+};
+
+struct Geom_Panoramic_FishEye_SSE2
+{
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        __m128 s, c;
+        sincos_ps (x, s, c);
+        const __m128 r = radius_ps (s, y);
+        __m128 theta = _mm_div_ps (atan2_ps (r, c), r);
+        theta = _mm_andnot_ps (_mm_cmpeq_ps (r, _mm_setzero_ps ()), theta);
+        x = _mm_mul_ps (theta, s);
+        y = _mm_mul_ps (theta, y);
+    }
+};
+
+struct Geom_ERect_Rect_SSE2
+{
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        __m128 vx, vy, w;
+        erect_to_sphere (x, y, vx, vy, w);
+        x = _mm_div_ps (vx, w);
+        y = _mm_div_ps (vy, w);
+    }
+};
+
+struct Geom_Rect_ERect_SSE2
+{
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        y = atan_ps (_mm_div_ps (y, _mm_sqrt_ps (madd_ps (x, x, _mm_set1_ps (1.0f)))));
+        x = atan_ps (x);
+    }
+};
+
+struct Geom_ERect_FishEye_SSE2
+{
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        __m128 vx, vy, w;
+        erect_to_sphere (x, y, vx, vy, w);
+        const __m128 r = radius_ps (vx, vy);
+        __m128 k = _mm_div_ps (atan2_ps (r, w), r);
+        k = blendv_ps (k, _mm_set1_ps (1.0f),
+                       _mm_cmpeq_ps (r, _mm_setzero_ps ()));
+        x = _mm_mul_ps (k, vx);
+        y = _mm_mul_ps (k, vy);
+    }
+};
+
+struct Geom_FishEye_ERect_SSE2
+{
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        const __m128 r = radius_ps (x, y);
+        __m128 s, vx;
+        sincos_ps (r, s, vx);
+        s = _mm_div_ps (s, r);
+        s = blendv_ps (s, _mm_set1_ps (1.0f),
+                       _mm_cmpeq_ps (r, _mm_setzero_ps ()));
+        sphere_to_erect (s, vx, x, y);
+    }
+};
+
+struct Geom_ERect_Panoramic_SSE2
+{
+    inline void operator () (__m128 &, __m128 &y) const
+    {
+        __m128 s, c;
+        sincos_ps (y, s, c);
+        y = _mm_div_ps (s, c);
+    }
+};
+
+struct Geom_Panoramic_ERect_SSE2
+{
+    inline void operator () (__m128 &, __m128 &y) const
+    {
+        y = atan_ps (y);
+    }
+};
+
+struct Geom_Orthographic_ERect_SSE2
+{
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        // sin (theta) = min (r, 1)
+        const __m128 one = _mm_set1_ps (1.0f);
+        const __m128 r = radius_ps (x, y);
+        const __m128 m = _mm_min_ps (r, one);
+        const __m128 vz = _mm_sqrt_ps (_mm_mul_ps (_mm_sub_ps (one, m),
+                                                   _mm_add_ps (one, m)));
+        const __m128 k = blendv_ps (_mm_div_ps (one, r), one,
+                                    _mm_cmplt_ps (r, one));
+        sphere_to_erect (k, vz, x, y);
+    }
+};
+
+struct Geom_ERect_Orthographic_SSE2
+{
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        // rho = sin (theta) is just the distance from the optical axis
+        __m128 vx, vy, w;
+        erect_to_sphere (x, y, vx, vy, w);
+        x = vx;
+        y = vy;
+    }
+};
+
+struct Geom_Stereographic_ERect_SSE2
+{
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        // With c = 2 atan (rh / 2): sin (c) = rh / (1 + rh^2 / 4),
+        // cos (c) = (1 - rh^2 / 4) / (1 + rh^2 / 4)
+        const __m128 eps = _mm_set1_ps (EPSLN);
+        const __m128 inf = _mm_set1_ps (1.6e16F);
+        const __m128 rh = radius_ps (x, y);
+        const __m128 q = _mm_mul_ps (_mm_mul_ps (rh, rh), _mm_set1_ps (0.25f));
+        const __m128 cos_num = _mm_sub_ps (_mm_set1_ps (1.0f), q);
+
+        __m128 lat = asin_signed_ps (_mm_div_ps (y, _mm_add_ps (_mm_set1_ps (1.0f), q)));
+        __m128 lon = atan2_ps (x, cos_num);
+        lon = blendv_ps (inf, lon, _mm_or_ps (
+            _mm_cmpge_ps (abs_ps (cos_num), eps),
+            _mm_cmpge_ps (abs_ps (x), eps)));
+
+        const __m128 centre = _mm_cmple_ps (rh, eps);
+        x = _mm_andnot_ps (centre, lon);
+        y = blendv_ps (lat, inf, centre);
+    }
+};
+
+struct Geom_ERect_Stereographic_SSE2
+{
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        __m128 vx, vy, w, w1;
+        erect_to_sphere (x, y, vx, vy, w, w1);
+        const __m128 ksp = _mm_div_ps (_mm_set1_ps (2.0f), w1);
+        x = _mm_mul_ps (ksp, vx);
+        y = _mm_mul_ps (ksp, vy);
+    }
+};
+
+struct Geom_Equisolid_ERect_SSE2
+{
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        // With theta = 2 asin (r / 2): sin (theta) = r sqrt (1 - r^2 / 4),
+        // cos (theta) = 1 - r^2 / 2
+        const __m128 one = _mm_set1_ps (1.0f);
+        const __m128 r = radius_ps (x, y);
+        const __m128 r2 = _mm_mul_ps (r, r);
+        const __m128 inside = _mm_cmplt_ps (r, _mm_set1_ps (2.0f));
+        const __m128 k = blendv_ps (
+            _mm_div_ps (one, r),
+            _mm_sqrt_ps (nmadd_ps (r2, _mm_set1_ps (0.25f), one)), inside);
+        const __m128 vz = _mm_and_ps (inside, nmadd_ps (r2, _mm_set1_ps (0.5f), one));
+        sphere_to_erect (k, vz, x, y);
+    }
+};
+
+struct Geom_ERect_Equisolid_SSE2
+{
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        __m128 vx, vy, w, d;
+        erect_to_sphere (x, y, vx, vy, w, d);
+        const __m128 k1 = _mm_sqrt_ps (_mm_div_ps (_mm_set1_ps (2.0f), d));
+        const __m128 pole = _mm_cmple_ps (abs_ps (d), _mm_set1_ps (EPSLN));
+        x = blendv_ps (_mm_mul_ps (k1, vx), _mm_set1_ps (1.6e16F), pole);
+        y = blendv_ps (_mm_mul_ps (k1, vy), _mm_set1_ps (1.6e16F), pole);
+    }
+};
+
+struct Geom_Thoby_ERect_SSE2
+{
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        const __m128 rho = radius_ps (x, y);
+        const __m128 theta = _mm_mul_ps (
+            asin_ps (_mm_min_ps (_mm_mul_ps (rho, _mm_set1_ps (1.0f / THOBY_K1_PARM)),
+                                 _mm_set1_ps (1.0f))),
+            _mm_set1_ps (1.0f / THOBY_K2_PARM));
+        __m128 s, vz;
+        sincos_ps (theta, s, vz);
+        __m128 k = _mm_div_ps (s, rho);
+        k = _mm_andnot_ps (_mm_cmpeq_ps (rho, _mm_setzero_ps ()), k);
+        const __m128 outside = _mm_cmpgt_ps (rho, _mm_set1_ps (THOBY_K1_PARM));
+        sphere_to_erect (k, vz, x, y);
+        x = blendv_ps (x, _mm_set1_ps (1.6e16F), outside);
+        y = blendv_ps (y, _mm_set1_ps (1.6e16F), outside);
+    }
+};
+
+struct Geom_ERect_Thoby_SSE2
+{
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        __m128 vx, vy, w;
+        erect_to_sphere (x, y, vx, vy, w);
+        const __m128 r = radius_ps (vx, vy);
+        __m128 s, c;
+        sincos_ps (_mm_mul_ps (atan2_ps (r, w), _mm_set1_ps (THOBY_K2_PARM)), s, c);
+        const __m128 rho = _mm_mul_ps (s, _mm_set1_ps (THOBY_K1_PARM));
+        // On the optical axis, the plain code takes the direction as (1, 0)
+        const __m128 axis = _mm_cmpeq_ps (r, _mm_setzero_ps ());
+        const __m128 k = _mm_div_ps (rho, r);
+        x = blendv_ps (_mm_mul_ps (k, vx), rho, axis);
+        y = _mm_andnot_ps (axis, _mm_mul_ps (k, vy));
+    }
+};
+
+/// Direct conversions between the rectilinear and the fisheye-like
+/// projections, which scale the point by a factor k depending on r^2 only
+
+template<typename Radial> struct Geom_Radial_SSE2
+{
+    Radial radial;
+
+    inline void operator () (__m128 &x, __m128 &y) const
+    {
+        const __m128 k = radial (madd_ps (x, x, _mm_mul_ps (y, y)));
+        x = _mm_mul_ps (k, x);
+        y = _mm_mul_ps (k, y);
+    }
+};
+
+/// cos (theta) for a rectilinear radius
+static inline __m128 rect_cos_ps (__m128 r2)
+{
+    return _mm_div_ps (_mm_set1_ps (1.0f), _mm_sqrt_ps (_mm_add_ps (_mm_set1_ps (1.0f), r2)));
+}
+
+/// k for r2 < limit, "infinity" beyond
+static inline __m128 limit_ps (__m128 k, __m128 r2, float limit)
+{
+    return blendv_ps (_mm_set1_ps (1.6e16F), k,
+                      _mm_cmplt_ps (r2, _mm_set1_ps (limit)));
+}
+
+struct Rect_Orthographic_Radial
+{
+    inline __m128 operator () (__m128 r2) const
+    {
+        return rect_cos_ps (r2);
+    }
+};
+
+struct Orthographic_Rect_Radial
+{
+    inline __m128 operator () (__m128 r2) const
+    {
+        const __m128 k = _mm_div_ps (_mm_set1_ps (1.0f),
+                                     _mm_sqrt_ps (_mm_sub_ps (_mm_set1_ps (1.0f), r2)));
+        return limit_ps (k, r2, 1.0f);
+    }
+};
+
+struct Rect_Stereographic_Radial
+{
+    inline __m128 operator () (__m128 r2) const
+    {
+        const __m128 c = rect_cos_ps (r2);
+        return _mm_div_ps (_mm_add_ps (c, c), _mm_add_ps (_mm_set1_ps (1.0f), c));
+    }
+};
+
+struct Stereographic_Rect_Radial
+{
+    inline __m128 operator () (__m128 r2) const
+    {
+        const __m128 k = _mm_div_ps (_mm_set1_ps (1.0f),
+                                     nmadd_ps (r2, _mm_set1_ps (0.25f), _mm_set1_ps (1.0f)));
+        return limit_ps (k, r2, 4.0f);
+    }
+};
+
+struct Rect_Equisolid_Radial
+{
+    inline __m128 operator () (__m128 r2) const
+    {
+        const __m128 c = rect_cos_ps (r2);
+        return _mm_mul_ps (c, _mm_sqrt_ps (_mm_div_ps (
+            _mm_set1_ps (2.0f), _mm_add_ps (_mm_set1_ps (1.0f), c))));
+    }
+};
+
+struct Equisolid_Rect_Radial
+{
+    inline __m128 operator () (__m128 r2) const
+    {
+        const __m128 one = _mm_set1_ps (1.0f);
+        const __m128 k = _mm_div_ps (
+            _mm_sqrt_ps (nmadd_ps (r2, _mm_set1_ps (0.25f), one)),
+            nmadd_ps (r2, _mm_set1_ps (0.5f), one));
+        return limit_ps (k, r2, 2.0f);
+    }
+};
+
+struct Rect_Thoby_Radial
+{
+    inline __m128 operator () (__m128 r2) const
+    {
+        const __m128 r = _mm_sqrt_ps (r2);
+        __m128 s, c;
+        sincos_ps (_mm_mul_ps (atan_ps (r), _mm_set1_ps (THOBY_K2_PARM)), s, c);
+        const __m128 k = _mm_div_ps (_mm_mul_ps (s, _mm_set1_ps (THOBY_K1_PARM)), r);
+        return blendv_ps (k, _mm_set1_ps (THOBY_K1_PARM * THOBY_K2_PARM),
+                          _mm_cmpeq_ps (r, _mm_setzero_ps ()));
+    }
+};
+
+struct Thoby_Rect_Radial
+{
+    inline __m128 operator () (__m128 r2) const
+    {
+        const __m128 r = _mm_sqrt_ps (r2);
+        const __m128 theta = _mm_mul_ps (
+            asin_ps (_mm_min_ps (_mm_mul_ps (r, _mm_set1_ps (1.0f / THOBY_K1_PARM)),
+                                 _mm_set1_ps (1.0f))),
+            _mm_set1_ps (1.0f / THOBY_K2_PARM));
+        __m128 s, c;
+        sincos_ps (theta, s, c);
+        __m128 k = _mm_div_ps (s, _mm_mul_ps (c, r));
+        k = blendv_ps (k, _mm_set1_ps (1.6e16F), _mm_or_ps (
+            _mm_cmpgt_ps (r, _mm_set1_ps (THOBY_K1_PARM)),
+            _mm_cmpge_ps (theta, _mm_set1_ps (M_PI / 2.0))));
+        return blendv_ps (k, _mm_set1_ps (1.0f / (THOBY_K1_PARM * THOBY_K2_PARM)),
+                          _mm_cmpeq_ps (r, _mm_setzero_ps ()));
+    }
+};
+
+typedef Geom_Radial_SSE2<Rect_Orthographic_Radial> Geom_Rect_Orthographic_SSE2;
+typedef Geom_Radial_SSE2<Orthographic_Rect_Radial> Geom_Orthographic_Rect_SSE2;
+typedef Geom_Radial_SSE2<Rect_Stereographic_Radial> Geom_Rect_Stereographic_SSE2;
+typedef Geom_Radial_SSE2<Stereographic_Rect_Radial> Geom_Stereographic_Rect_SSE2;
+typedef Geom_Radial_SSE2<Rect_Equisolid_Radial> Geom_Rect_Equisolid_SSE2;
+typedef Geom_Radial_SSE2<Equisolid_Rect_Radial> Geom_Equisolid_Rect_SSE2;
+typedef Geom_Radial_SSE2<Rect_Thoby_Radial> Geom_Rect_Thoby_SSE2;
+typedef Geom_Radial_SSE2<Thoby_Rect_Radial> Geom_Thoby_Rect_SSE2;
+
+/*
+ * Apply a stage to all complete blocks of 4 points in the buffer.  Returns
+ * the position of the count % 4 remaining points.
+ */
+template<typename Stage> static inline float *apply_stage (
+    const Stage &stage, float *iocoord, int count)
+{
+    for (float *end = iocoord + (count & ~3) * 2; iocoord < end; iocoord += 8)
+    {
+        __m128 x, y;
+        load_xy (iocoord, x, y);
+        stage (x, y);
+        store_xy (iocoord, x, y);
+    }
+    return iocoord;
+}
+
+//------------------------------------------------------------------------//
+
+#define GEOM_CALLBACK_SSE2(name)                                                \
+void lfModifier::ModifyCoord_Geom_##name##_SSE2 (void *data, float *iocoord, int count) \
+{                                                                               \
+    iocoord = apply_stage (Geom_##name##_SSE2 (), iocoord, count);              \
+    if (count % 4)                                                              \
+        ModifyCoord_Geom_##name (data, iocoord, count % 4);                     \
+}
+
+GEOM_CALLBACK_SSE2 (FishEye_Rect)
+GEOM_CALLBACK_SSE2 (Rect_FishEye)
+GEOM_CALLBACK_SSE2 (Panoramic_Rect)
+GEOM_CALLBACK_SSE2 (Rect_Panoramic)
+GEOM_CALLBACK_SSE2 (FishEye_Panoramic)
+GEOM_CALLBACK_SSE2 (Panoramic_FishEye)
+GEOM_CALLBACK_SSE2 (ERect_Rect)
+GEOM_CALLBACK_SSE2 (Rect_ERect)
+GEOM_CALLBACK_SSE2 (ERect_FishEye)
+GEOM_CALLBACK_SSE2 (FishEye_ERect)
+GEOM_CALLBACK_SSE2 (ERect_Panoramic)
+GEOM_CALLBACK_SSE2 (Panoramic_ERect)
+GEOM_CALLBACK_SSE2 (Orthographic_ERect)
+GEOM_CALLBACK_SSE2 (ERect_Orthographic)
+GEOM_CALLBACK_SSE2 (Stereographic_ERect)
+GEOM_CALLBACK_SSE2 (ERect_Stereographic)
+GEOM_CALLBACK_SSE2 (Equisolid_ERect)
+GEOM_CALLBACK_SSE2 (ERect_Equisolid)
+GEOM_CALLBACK_SSE2 (Thoby_ERect)
+GEOM_CALLBACK_SSE2 (ERect_Thoby)
+GEOM_CALLBACK_SSE2 (Orthographic_Rect)
+GEOM_CALLBACK_SSE2 (Rect_Orthographic)
+GEOM_CALLBACK_SSE2 (Stereographic_Rect)
+GEOM_CALLBACK_SSE2 (Rect_Stereographic)
+GEOM_CALLBACK_SSE2 (Equisolid_Rect)
+GEOM_CALLBACK_SSE2 (Rect_Equisolid)
+GEOM_CALLBACK_SSE2 (Thoby_Rect)
+GEOM_CALLBACK_SSE2 (Rect_Thoby)
+
+#undef GEOM_CALLBACK_SSE2
+
+lfModifier::lfModifyCoordFunc lfModifier::GetGeomCallback_SSE2 (lfModifyCoordFunc func)
+{
+    static const lfModifyCoordFunc callbacks [][2] =
+    {
+        { ModifyCoord_Geom_FishEye_Rect, ModifyCoord_Geom_FishEye_Rect_SSE2 },
+        { ModifyCoord_Geom_Rect_FishEye, ModifyCoord_Geom_Rect_FishEye_SSE2 },
+        { ModifyCoord_Geom_Panoramic_Rect, ModifyCoord_Geom_Panoramic_Rect_SSE2 },
+        { ModifyCoord_Geom_Rect_Panoramic, ModifyCoord_Geom_Rect_Panoramic_SSE2 },
+        { ModifyCoord_Geom_FishEye_Panoramic, ModifyCoord_Geom_FishEye_Panoramic_SSE2 },
+        { ModifyCoord_Geom_Panoramic_FishEye, ModifyCoord_Geom_Panoramic_FishEye_SSE2 },
+        { ModifyCoord_Geom_ERect_Rect, ModifyCoord_Geom_ERect_Rect_SSE2 },
+        { ModifyCoord_Geom_Rect_ERect, ModifyCoord_Geom_Rect_ERect_SSE2 },
+        { ModifyCoord_Geom_ERect_FishEye, ModifyCoord_Geom_ERect_FishEye_SSE2 },
+        { ModifyCoord_Geom_FishEye_ERect, ModifyCoord_Geom_FishEye_ERect_SSE2 },
+        { ModifyCoord_Geom_ERect_Panoramic, ModifyCoord_Geom_ERect_Panoramic_SSE2 },
+        { ModifyCoord_Geom_Panoramic_ERect, ModifyCoord_Geom_Panoramic_ERect_SSE2 },
+        { ModifyCoord_Geom_Orthographic_ERect, ModifyCoord_Geom_Orthographic_ERect_SSE2 },
+        { ModifyCoord_Geom_ERect_Orthographic, ModifyCoord_Geom_ERect_Orthographic_SSE2 },
+        { ModifyCoord_Geom_Stereographic_ERect, ModifyCoord_Geom_Stereographic_ERect_SSE2 },
+        { ModifyCoord_Geom_ERect_Stereographic, ModifyCoord_Geom_ERect_Stereographic_SSE2 },
+        { ModifyCoord_Geom_Equisolid_ERect, ModifyCoord_Geom_Equisolid_ERect_SSE2 },
+        { ModifyCoord_Geom_ERect_Equisolid, ModifyCoord_Geom_ERect_Equisolid_SSE2 },
+        { ModifyCoord_Geom_Thoby_ERect, ModifyCoord_Geom_Thoby_ERect_SSE2 },
+        { ModifyCoord_Geom_ERect_Thoby, ModifyCoord_Geom_ERect_Thoby_SSE2 },
+        { ModifyCoord_Geom_Orthographic_Rect, ModifyCoord_Geom_Orthographic_Rect_SSE2 },
+        { ModifyCoord_Geom_Rect_Orthographic, ModifyCoord_Geom_Rect_Orthographic_SSE2 },
+        { ModifyCoord_Geom_Stereographic_Rect, ModifyCoord_Geom_Stereographic_Rect_SSE2 },
+        { ModifyCoord_Geom_Rect_Stereographic, ModifyCoord_Geom_Rect_Stereographic_SSE2 },
+        { ModifyCoord_Geom_Equisolid_Rect, ModifyCoord_Geom_Equisolid_Rect_SSE2 },
+        { ModifyCoord_Geom_Rect_Equisolid, ModifyCoord_Geom_Rect_Equisolid_SSE2 },
+        { ModifyCoord_Geom_Thoby_Rect, ModifyCoord_Geom_Thoby_Rect_SSE2 },
+        { ModifyCoord_Geom_Rect_Thoby, ModifyCoord_Geom_Rect_Thoby_SSE2 }
+    };
+    for (auto &cb : callbacks)
+        if (cb [0] == func)
+            return cb [1];
+    return func;
+}
+
+#endif
@@ -31,8 +31,11 @@
 #include "lensfunprv.h"
 #include <math.h>
 #include "windows/mathconstants.h"
+#include <cmath>
 #include <limits>
 #include <cassert>
+#include <algorithm>
+#include <map>
 
 lfLensCalibDistortion rescale_polynomial_coefficients (const lfLensCalibDistortion& lcd_, double real_focal)
 {
@@ -73,21 +76,43 @@ lfLensCalibDistortion rescale_polynomial_coefficients (const lfLensCalibDistorti
 int lfModifier::EnableDistortionCorrection (const lfLensCalibDistortion& lcd_)
 {
     const lfLensCalibDistortion lcd = rescale_polynomial_coefficients (lcd_, RealFocal);
+#ifdef VECTORIZATION_AVX2
+    const bool avx2 = _lf_cpu_has_avx2_fma ();
+#endif
     if (Reverse)
         switch (lcd.Model)
         {
             case LF_DIST_MODEL_POLY3:
                 if (lcd.Terms [0] == 0)
                     return EnabledMods;
+#ifdef VECTORIZATION_AVX2
+                if (avx2)
+                    AddCoordDistCallback (lcd, ModifyCoord_UnDist_Poly3_AVX2, 250);
+                else
+#endif
                 AddCoordDistCallback (lcd, ModifyCoord_UnDist_Poly3, 250);
                 break;
 
             case LF_DIST_MODEL_POLY5:
+                if (AddCoordDistFitCallback (lcd, ModifyCoord_UnDist_Poly5, 250))
+                    break;
+#ifdef VECTORIZATION_AVX2
+                if (avx2)
+                    AddCoordDistCallback (lcd, ModifyCoord_UnDist_Poly5_AVX2, 250);
+                else
+#endif
                 AddCoordDistCallback (lcd, ModifyCoord_UnDist_Poly5, 250);
                 break;
 
             case LF_DIST_MODEL_PTLENS:
             {
+                if (AddCoordDistFitCallback (lcd, ModifyCoord_UnDist_PTLens, 250))
+                    break;
+#ifdef VECTORIZATION_AVX2
+                if (avx2)
+                    AddCoordDistCallback (lcd, ModifyCoord_UnDist_PTLens_AVX2, 250);
+                else
+#endif
 #ifdef VECTORIZATION_SSE
                 if (_lf_detect_cpu_features () & LF_CPU_FLAG_SSE)
                     AddCoordDistCallback (lcd, ModifyCoord_UnDist_PTLens_SSE, 250);
@@ -97,9 +122,20 @@ int lfModifier::EnableDistortionCorrection (const lfLensCalibDistortion& lcd_)
                 break;
             }
             case LF_DIST_MODEL_ACM:
-                g_warning ("[lensfun] \"acm\" distortion model is not yet implemented "
-                           "for reverse correction");
-                return EnabledMods;
+            {
+                lfCoordACMCallbackData cd;
+#ifdef VECTORIZATION_AVX2
+                if (avx2)
+                    cd.callback = ModifyCoord_UnDist_ACM_AVX2;
+                else
+#endif
+                cd.callback = ModifyCoord_UnDist_ACM;
+                cd.priority = 250;
+                memcpy (cd.terms, lcd.Terms, sizeof (lcd.Terms));
+                cd.chains = Callbacks;
+                AddCoordCallback (cd);
+                break;
+            }
 
             default:
                 return EnabledMods;
@@ -109,6 +145,11 @@ int lfModifier::EnableDistortionCorrection (const lfLensCalibDistortion& lcd_)
         {
             case LF_DIST_MODEL_POLY3:
                 {
+    #ifdef VECTORIZATION_AVX2
+                    if (avx2)
+                        AddCoordDistCallback (lcd, ModifyCoord_Dist_Poly3_AVX2, 750);
+                    else
+    #endif
     #ifdef VECTORIZATION_SSE
                     if (_lf_detect_cpu_features () & LF_CPU_FLAG_SSE)
                         AddCoordDistCallback (lcd, ModifyCoord_Dist_Poly3_SSE, 750);
@@ -119,12 +160,22 @@ int lfModifier::EnableDistortionCorrection (const lfLensCalibDistortion& lcd_)
                 break;
 
             case LF_DIST_MODEL_POLY5:
+    #ifdef VECTORIZATION_AVX2
+                if (avx2)
+                    AddCoordDistCallback (lcd, ModifyCoord_Dist_Poly5_AVX2, 750);
+                else
+    #endif
                 AddCoordDistCallback (lcd, ModifyCoord_Dist_Poly5, 750);
                 break;
 
             case LF_DIST_MODEL_PTLENS:
             {
                 {
+    #ifdef VECTORIZATION_AVX2
+                    if (avx2)
+                        AddCoordDistCallback (lcd, ModifyCoord_Dist_PTLens_AVX2, 750);
+                    else
+    #endif
     #ifdef VECTORIZATION_SSE
                     if (_lf_detect_cpu_features () & LF_CPU_FLAG_SSE)
                         AddCoordDistCallback (lcd, ModifyCoord_Dist_PTLens_SSE, 750);
@@ -135,6 +186,11 @@ int lfModifier::EnableDistortionCorrection (const lfLensCalibDistortion& lcd_)
                 break;
             }
             case LF_DIST_MODEL_ACM:
+    #ifdef VECTORIZATION_AVX2
+                if (avx2)
+                    AddCoordDistCallback (lcd, ModifyCoord_Dist_ACM_AVX2, 750);
+                else
+    #endif
                 AddCoordDistCallback (lcd, ModifyCoord_Dist_ACM, 750);
                 break;
 
@@ -194,11 +250,67 @@ int lfModifier::EnableProjectionTransform (lfLensType target_projection)
                     EnabledMods |= LF_MODIFY_GEOMETRY;
                     return EnabledMods;
 
+                case LF_FISHEYE_ORTHOGRAPHIC:
+                    AddCoordGeomCallback (ModifyCoord_Geom_Orthographic_Rect, 500);
+                    EnabledMods |= LF_MODIFY_GEOMETRY;
+                    return EnabledMods;
+
+                case LF_FISHEYE_STEREOGRAPHIC:
+                    AddCoordGeomCallback (ModifyCoord_Geom_Stereographic_Rect, 500);
+                    EnabledMods |= LF_MODIFY_GEOMETRY;
+                    return EnabledMods;
+
+                case LF_FISHEYE_EQUISOLID:
+                    AddCoordGeomCallback (ModifyCoord_Geom_Equisolid_Rect, 500);
+                    EnabledMods |= LF_MODIFY_GEOMETRY;
+                    return EnabledMods;
+
+                case LF_FISHEYE_THOBY:
+                    AddCoordGeomCallback (ModifyCoord_Geom_Thoby_Rect, 500);
+                    EnabledMods |= LF_MODIFY_GEOMETRY;
+                    return EnabledMods;
+
                 default:
                     break;
             }
             break;
 
+        case LF_FISHEYE_ORTHOGRAPHIC:
+            if (to == LF_RECTILINEAR)
+            {
+                AddCoordGeomCallback (ModifyCoord_Geom_Rect_Orthographic, 500);
+                EnabledMods |= LF_MODIFY_GEOMETRY;
+                return EnabledMods;
+            }
+            break;
+
+        case LF_FISHEYE_STEREOGRAPHIC:
+            if (to == LF_RECTILINEAR)
+            {
+                AddCoordGeomCallback (ModifyCoord_Geom_Rect_Stereographic, 500);
+                EnabledMods |= LF_MODIFY_GEOMETRY;
+                return EnabledMods;
+            }
+            break;
+
+        case LF_FISHEYE_EQUISOLID:
+            if (to == LF_RECTILINEAR)
+            {
+                AddCoordGeomCallback (ModifyCoord_Geom_Rect_Equisolid, 500);
+                EnabledMods |= LF_MODIFY_GEOMETRY;
+                return EnabledMods;
+            }
+            break;
+
+        case LF_FISHEYE_THOBY:
+            if (to == LF_RECTILINEAR)
+            {
+                AddCoordGeomCallback (ModifyCoord_Geom_Rect_Thoby, 500);
+                EnabledMods |= LF_MODIFY_GEOMETRY;
+                return EnabledMods;
+            }
+            break;
+
         case LF_FISHEYE:
             switch (to)
             {
@@ -377,170 +489,1979 @@ int lfModifier::EnableProjectionTransform (lfLensType target_projection)
 
 void lfModifier::AddCoordDistCallback (const lfLensCalibDistortion& lcd, lfModifyCoordFunc func, int priority)
 {
-    lfCoordDistCallbackData* cd = new lfCoordDistCallbackData;
+    lfCoordDistCallbackData cd;
 
-    cd->callback = func;
-    cd->priority = priority;
+    cd.callback = func;
+    cd.priority = priority;
 
-    memcpy(cd->terms, lcd.Terms, sizeof(lcd.Terms));
+    memcpy(cd.terms, lcd.Terms, sizeof(lcd.Terms));
 
-    CoordCallbacks.insert(cd);
+    AddCoordCallback (cd);
 }
 
-void lfModifier::AddCoordGeomCallback (lfModifyCoordFunc func, int priority)
+/*
+ * Distorted radius Rd (Ru) of the radial distortion models which are inverted
+ * by fitting, and optionally its derivative dRd/dRu.
+ */
+static double distorted_radius (const lfLensCalibDistortion& lcd, double ru,
+                                double *derivative = NULL)
 {
-    lfCoordGeomCallbackData* cd = new lfCoordGeomCallbackData;
+    const double ru2 = ru * ru;
+    switch (lcd.Model)
+    {
+        case LF_DIST_MODEL_POLY5:
+            if (derivative)
+                *derivative = 1.0 + 3 * lcd.Terms [0] * ru2 + 5 * lcd.Terms [1] * ru2 * ru2;
+            return ru * (1.0 + lcd.Terms [0] * ru2 + lcd.Terms [1] * ru2 * ru2);
 
-    cd->callback = func;
-    cd->priority = priority;
+        case LF_DIST_MODEL_PTLENS:
+            if (derivative)
+                *derivative = 4 * lcd.Terms [0] * ru2 * ru + 3 * lcd.Terms [1] * ru2 +
+                    2 * lcd.Terms [2] * ru + 1.0;
+            return ru * (lcd.Terms [0] * ru2 * ru + lcd.Terms [1] * ru2 +
+                         lcd.Terms [2] * ru + 1.0);
 
-    CoordCallbacks.insert(cd);
+        default:
+            return ru;
+    }
 }
 
-double lfModifier::AutoscaleResidualDistance (float *coord) const
+/*
+ * Evaluate a Chebyshev series at t in [-1, 1] by Clenshaw's recurrence.
+ */
+template<typename T> static inline T chebyshev_series (const float *coeffs, int count, T t)
 {
+    T b1 = 0, b2 = 0;
+    for (int j = count - 1; j > 0; j--)
+    {
+        const T b0 = coeffs [j] + 2 * t * b1 - b2;
+        b2 = b1;
+        b1 = b0;
+    }
+    return coeffs [0] + t * b1 - b2;
+}
 
-    // Maximal x and y value in normalized coordinates for the original image
-    double max_x = Width / 2.0 * NormScale;
-    double max_y = Height / 2.0 * NormScale;
+/*
+ * The process-wide caches of the fitted inverse distortions and of the
+ * automatic scale factors share a lock.  Batches of images usually share
+ * only a few combinations of lens, focal length, and image size, so that
+ * the work is done only once for each.
+ */
+#if defined(GLIB_CHECK_VERSION) && GLIB_CHECK_VERSION(2,32,0)
+static GMutex cache_mutex;
+#define cache_lock() g_mutex_lock (&cache_mutex)
+#define cache_unlock() g_mutex_unlock (&cache_mutex)
+#else
+static GStaticMutex cache_mutex = G_STATIC_MUTEX_INIT;
+#define cache_lock() g_static_mutex_lock (&cache_mutex)
+#define cache_unlock() g_static_mutex_unlock (&cache_mutex)
+#endif
 
-    double result = coord [0] - max_x;
-    double intermediate = -max_x - coord [0];
-    if (intermediate > result) result = intermediate;
-    intermediate = coord [1] - max_y;
-    if (intermediate > result) result = intermediate;
-    intermediate = -max_y - coord [1];
-    return intermediate > result ? intermediate : result;
+// Enough for any realistic batch; a cache starts over when it is full
+static const size_t cache_size = 1024;
+
+template <typename T> static void append_key (std::string &key, const T *values, int count = 1)
+{
+    key.append ((const char *) values, sizeof (T) * count);
 }
 
-float lfModifier::GetTransformedDistance (lfPoint point) const
+/// A fitted inverse distortion, see AddCoordDistFitCallback
+struct lfDistFit
 {
-    double dist = point.dist;
-    double sa = sin (point.angle);
-    double ca = cos (point.angle);
+    std::vector<float> coeffs;
+    double residual;
+};
 
-    // We have to find the radius ru in the direction of the given point which
-    // distorts to the original (distorted) image edge.  We will use Newton's
-    // method for minimizing the distance between the distorted point at ru and
-    // the original edge.
-    float ru = dist; // Initial approximation
-    float dx = 0.0001F;
-    for (int countdown = 50; ; countdown--)
+/// The fits by model, terms, and fitted range
+static std::map<std::string, lfDistFit> fit_cache;
+
+/*
+ * Fit Ru/Rd of a distortion model over [0, max_rd] by a Chebyshev series of
+ * at most max_coeffs coefficients.  Returns the number of coefficients, or 0
+ * if the model cannot be inverted there.
+ */
+static int fit_inverse_distortion (const lfLensCalibDistortion& lcd, double max_rd,
+                                   int max_coeffs, float *best_coeffs, double *best_residual)
+{
+    const int sample_count = 1024;
+    std::vector<float> coeffs (max_coeffs);
+    int best_count = 0;
+    *best_residual = NEWTON_EPS;
+
+    for (int count = 8; count <= max_coeffs; count += 4)
     {
-        float res [2];
+        // Interpolate Ru/Rd at the Chebyshev nodes.  Ru is found by Newton's
+        // method in double precision; the root must be on the monotonic
+        // branch of the model, otherwise the inverse is not well-defined.
+        std::vector<double> values (count);
+        bool ok = true;
+        for (int k = 0; k < count && ok; k++)
+        {
+            const double rd = (cos (M_PI * (k + 0.5) / count) + 1.0) * 0.5 * max_rd;
+            double ru = rd, derivative = 1.0;
+            int step;
+            for (step = 0; step < 50; step++)
+            {
+                const double fru = distorted_radius (lcd, ru, &derivative) - rd;
+                if (!(derivative > 0.0))
+                    break;
+                const double delta = fru / derivative;
+                ru -= delta;
+                if (absolute (delta) < 1e-12 * max_rd)
+                    break;
+            }
+            ok = step < 50 && derivative > 0.0 && ru > 0.0;
+            values [k] = ru / rd;
+        }
+        if (!ok)
+            return 0;
 
-        res [0] = ca * ru; res [1] = sa * ru;
-        for (auto cb : CoordCallbacks)
-            cb->callback (cb, res, 1);
+        for (int j = 0; j < count; j++)
+        {
+            double sum = 0.0;
+            for (int k = 0; k < count; k++)
+                sum += values [k] * cos (M_PI * j * (k + 0.5) / count);
+            coeffs [j] = sum * (j ? 2.0 : 1.0) / count;
+        }
 
-        double rd = AutoscaleResidualDistance (res);
-        if (rd > -NEWTON_EPS * 100 && rd < NEWTON_EPS * 100)
+        // Check the fit in Rd space, exactly like the Newton iteration checks
+        // its result.
+        double residual = 0.0;
+        for (int i = 1; i <= sample_count && ok; i++)
+        {
+            const double rd = max_rd * i / sample_count;
+            const double ru = rd * chebyshev_series (&coeffs [0], count, 2.0 * i / sample_count - 1.0);
+            double derivative;
+            residual = std::max (residual, absolute (distorted_radius (lcd, ru, &derivative) - rd));
+            ok = derivative > 0.0;
+        }
+        if (ok && residual < *best_residual)
+        {
+            *best_residual = residual;
+            best_count = count;
+            memcpy (best_coeffs, &coeffs [0], count * sizeof (float));
+        }
+        // Don't go further if this is well below the Newton tolerance; the
+        // float coefficients limit the residual to about 1e-7 anyway.
+        if (*best_residual < NEWTON_EPS * 0.05)
             break;
+    }
+    return best_count;
+}
 
-        if (!countdown)
-            // e.g. for some ultrawide fisheyes corners extend to infinity
-            // so function never converge ...
-            return -1;
+bool lfModifier::AddCoordDistFitCallback (const lfLensCalibDistortion& lcd, lfModifyCoordFunc newton, int priority)
+{
+    // In reverse mode, the distortion callback is the first one in the chain,
+    // so it sees the plain pixel grid.  The fit covers the distance to the
+    // farthest image corner, plus a margin for callers which sample slightly
+    // outside of the image.
+    double max_rd = 0.0;
+    for (int i = 0; i < 4; i++)
+    {
+        const double x = (i & 1 ? Width : 0.0) * NormScale - CenterX;
+        const double y = (i & 2 ? Height : 0.0) * NormScale - CenterY;
+        max_rd = std::max (max_rd, sqrt (x * x + y * y));
+    }
+    max_rd *= 1.05;
+    if (max_rd <= 0.0)
+        return false;
+
+    const int max_coeffs = sizeof (lfCoordDistFitCallbackData::coeffs) / sizeof (float);
+    float best_coeffs [max_coeffs];
+    double best_residual;
+    int best_count;
+
+    std::string key;
+    append_key (key, &lcd.Model);
+    append_key (key, lcd.Terms, sizeof (lcd.Terms) / sizeof (lcd.Terms [0]));
+    append_key (key, &max_rd);
+    cache_lock ();
+    auto cached = fit_cache.find (key);
+    const bool hit = cached != fit_cache.end ();
+    if (hit)
+    {
+        best_count = int (cached->second.coeffs.size ());
+        std::copy (cached->second.coeffs.begin (), cached->second.coeffs.end (), best_coeffs);
+        best_residual = cached->second.residual;
+    }
+    cache_unlock ();
 
-        // Compute approximative function prime in (x,y)
-        res [0] = ca * (ru + dx); res [1] = sa * (ru + dx);
-        for (auto cb : CoordCallbacks)
-            cb->callback (cb, res, 1);
+    if (!hit)
+    {
+        best_count = fit_inverse_distortion (lcd, max_rd, max_coeffs, best_coeffs, &best_residual);
+        cache_lock ();
+        if (fit_cache.size () >= cache_size)
+            fit_cache.clear ();
+        lfDistFit &fit = fit_cache [key];
+        fit.coeffs.assign (best_coeffs, best_coeffs + best_count);
+        fit.residual = best_residual;
+        cache_unlock ();
+    }
+    if (!best_count)
+        return false;
 
-        double rd1 = AutoscaleResidualDistance (res);
+    lfCoordDistFitCallbackData cd;
 
-        // If rd1 is very close to rd, this means our delta is too small
-        // and we can hit the precision limit of the float format...
-        if (absolute (rd1 - rd) < 0.00001)
+#ifdef VECTORIZATION_AVX2
+    if (_lf_cpu_has_avx2_fma ())
+        cd.callback = ModifyCoord_UnDist_Fit_AVX2;
+    else
+#endif
+    cd.callback = ModifyCoord_UnDist_Fit;
+    cd.priority = priority;
+    memcpy (cd.terms, lcd.Terms, sizeof (lcd.Terms));
+    cd.newton = newton;
+    cd.max_rd = max_rd;
+    memcpy (cd.coeffs, best_coeffs, best_count * sizeof (float));
+    cd.coeff_count = best_count;
+    cd.residual = best_residual;
+
+    AddCoordCallback (cd);
+    return true;
+}
+
+unsigned long lfModifier::GetUnconvergedCount () const
+{
+    return Callbacks->unconverged.load (std::memory_order_relaxed);
+}
+
+float lfModifier::GetDistortionFitResidual () const
+{
+    for (auto cb : Callbacks->Coord)
+    {
+        auto fit = dynamic_cast<lfCoordDistFitCallbackData*> (cb);
+        if (fit)
+            return fit->residual * NormUnScale;
+    }
+    return -1.0f;
+}
+
+/*
+ * Check whether the coordinate callback chain can run as a single fused pass
+ * in ApplyGeometryDistortion.  Scaling is folded into the pixel grid if it
+ * comes first, or into the conversion back to pixel coordinates if it comes
+ * last, so this is possible for chains of scaling and at most one other
+ * callback for which a fused kernel exists.  Purely radial chains are looked
+ * up in a table instead, unless they consist of a single polynomial, which is
+ * cheaper to evaluate directly; the table is only built on first use.
+ * Everything else runs callback by callback.
+ * Radial chains are also mirrored about the centre, see
+ * ComputeGeometryDistortion.
+ */
+void lfModifier::PlanCoordCallbacks ()
+{
+    // A grid sampled from the previous chain is no longer valid
+    CoordGrid.spacing = 0;
+    CoordGrid.nodes.clear ();
+    CoordGrid.exact.clear ();
+
+    lfCoordKernel &kernel = CoordKernel;
+    kernel.row = NULL;
+    kernel.stage = NULL;
+    kernel.chain_length = 0;
+    kernel.radial.clear ();
+    kernel.pre_scale = kernel.post_scale = 1.0f;
+
+    // The callbacks which are not a scaling, with the scaling after each
+    const int max_chain = sizeof (kernel.chain) / sizeof (kernel.chain [0]);
+    float scales [max_chain];
+    int stages = 0;
+    for (auto cb : Callbacks->Coord)
+    {
+        if (cb->callback == ModifyCoord_Scale)
         {
-            dx *= 2;
-            continue;
+            float scale = ((lfCoordScaleCallbackData *) cb)->scale_factor;
+            if (!stages)
+                kernel.pre_scale *= scale;
+            else if (stages <= max_chain)
+                scales [stages - 1] *= scale;
+        }
+        else
+        {
+            if (stages < max_chain)
+            {
+                kernel.chain [stages] = cb;
+                scales [stages] = 1.0f;
+            }
+            stages++;
         }
+    }
+    const bool single_stage = stages <= 1;
+    if (stages)
+        kernel.stage = kernel.chain [0];
+    if (stages == 1)
+        kernel.post_scale = scales [0];
+
+    // Radial chains are symmetric about the centre
+    bool polynomial = false, symmetric = false;
+#ifdef VECTORIZATION_AVX2
+    const bool avx2 = _lf_cpu_has_avx2_fma ();
+    if (avx2 && single_stage)
+    {
+        kernel.stage_id = GetFusedStage_AVX2 (kernel.stage ? kernel.stage->callback : NULL);
+        if (kernel.stage_id >= 0)
+            kernel.row = ModifyCoordRow_AVX2;
+        polynomial = !kernel.stage ||
+            kernel.stage->callback == ModifyCoord_Dist_Poly3_AVX2 ||
+            kernel.stage->callback == ModifyCoord_Dist_Poly5_AVX2 ||
+            kernel.stage->callback == ModifyCoord_Dist_PTLens_AVX2;
+        symmetric = polynomial;
+    }
 
-        // dy/dx;
-        double prime = (rd1 - rd) / dx;
+    // Longer chains run as one pass, too, if every stage has a kernel
+    if (avx2 && stages > 1 && stages <= max_chain)
+    {
+        int i;
+        for (i = 0; i < stages; i++)
+            if ((kernel.chain_id [i] = GetFusedStage_AVX2 (kernel.chain [i]->callback)) <= 0)
+                break;
+        if (i == stages)
+        {
+            kernel.row = ModifyCoordRow_AVX2;
+            kernel.chain_length = stages;
+            for (i = 0; i < stages - 1; i++)
+                kernel.chain_scale [i] = scales [i];
+            kernel.post_scale = scales [stages - 1];
+        }
+    }
+#endif
 
-        ru -= rd / prime;
+    // Without a vector kernel, single forward polynomials still run in one
+    // pass, see ModifyCoordRow_Dist
+    if (!kernel.row && single_stage && kernel.stage)
+    {
+        static const struct { lfModifyCoordFunc func; lfDistortionModel model; } dist_rows [] =
+        {
+            { ModifyCoord_Dist_Poly3, LF_DIST_MODEL_POLY3 },
+            { ModifyCoord_Dist_Poly5, LF_DIST_MODEL_POLY5 },
+            { ModifyCoord_Dist_PTLens, LF_DIST_MODEL_PTLENS },
+            { ModifyCoord_Dist_ACM, LF_DIST_MODEL_ACM },
+#ifdef VECTORIZATION_SSE
+            { ModifyCoord_Dist_Poly3_SSE, LF_DIST_MODEL_POLY3 },
+            { ModifyCoord_Dist_PTLens_SSE, LF_DIST_MODEL_PTLENS },
+#endif
+        };
+        for (auto &dist_row : dist_rows)
+            if (kernel.stage->callback == dist_row.func)
+            {
+                kernel.stage_id = dist_row.model;
+                kernel.row = ModifyCoordRow_Dist;
+                polynomial = true;
+                symmetric = dist_row.model != LF_DIST_MODEL_ACM;
+            }
     }
 
-    return ru;
+    // Perspective corrections, see PerspectiveRow
+    if (!kernel.row && single_stage && kernel.stage &&
+        (kernel.stage->callback == ModifyCoord_Perspective_Correction ||
+         kernel.stage->callback == ModifyCoord_Perspective_Distortion))
+    {
+#ifdef VECTORIZATION_AVX2
+        if (avx2)
+            kernel.row = ModifyCoordRow_Persp_AVX2;
+        else
+#endif
+#ifdef VECTORIZATION_SSE
+        if (_lf_detect_cpu_features () & LF_CPU_FLAG_SSE)
+            kernel.row = ModifyCoordRow_Persp_SSE;
+        else
+#endif
+        kernel.row = ModifyCoordRow_Persp;
+    }
+
+    // Building the table of a radial chain takes thousands of evaluations
+    // of the chain, so it waits for the first use of the kernel, see
+    // PrepareCoordKernel.  Until then, the kernel is what it would be
+    // without the table.
+    kernel.radial_pending = !polynomial && IsRadialChain ();
+    Callbacks->radial_ready = 0;
+
+    // Copying a row costs a read on top of the write, which is more than
+    // the vector kernels spend computing it unless the row is still in the
+    // cache, see ComputeGeometryDistortion
+    kernel.symmetric = symmetric && kernel.row;
+#ifdef VECTORIZATION_AVX2
+    if (avx2)
+    {
+        kernel.mirror_row = MirrorCoordRow_AVX2;
+        kernel.reflect_row = ReflectCoordRow_AVX2;
+        kernel.mirror_reach = 16384;
+    }
+    else
+#endif
+    {
+        kernel.mirror_row = MirrorCoordRow;
+        kernel.reflect_row = ReflectCoordRow;
+        kernel.mirror_reach = std::numeric_limits<size_t>::max ();
+    }
+    kernel.dx = NormScale * kernel.pre_scale;
+    kernel.out_scale = kernel.post_scale * NormUnScale;
+    kernel.out_x = CenterX * NormUnScale;
+    kernel.out_y = CenterY * NormUnScale;
 }
 
-float lfModifier::GetAutoScale (bool reverse)
+/*
+ * Radial distortion models, the scaling, and the conversions between
+ * rectilinear and fisheye-like projections only change the distance of a
+ * point from the centre.  A chain of them is completely described by the
+ * ratio of output to input radius, as a function of the input radius.
+ * This checks whether the chain consists of such callbacks only.
+ */
+bool lfModifier::IsRadialChain () const
 {
-    // Compute the scale factor automatically
-    const float subpixel_scale = SubpixelCallbacks.size() == 0 ? 1.0 : 1.001;
-
-    if (CoordCallbacks.size() == 0)
-        return subpixel_scale;
+    static const lfModifyCoordFunc radial [] =
+    {
+        ModifyCoord_Scale,
+        ModifyCoord_Dist_Poly3, ModifyCoord_UnDist_Poly3,
+        ModifyCoord_Dist_Poly5, ModifyCoord_UnDist_Poly5,
+        ModifyCoord_Dist_PTLens, ModifyCoord_UnDist_PTLens,
+        ModifyCoord_UnDist_Fit,
+        ModifyCoord_Geom_FishEye_Rect, ModifyCoord_Geom_Rect_FishEye,
+        ModifyCoord_Geom_Orthographic_Rect, ModifyCoord_Geom_Rect_Orthographic,
+        ModifyCoord_Geom_Stereographic_Rect, ModifyCoord_Geom_Rect_Stereographic,
+        ModifyCoord_Geom_Equisolid_Rect, ModifyCoord_Geom_Rect_Equisolid,
+        ModifyCoord_Geom_Thoby_Rect, ModifyCoord_Geom_Rect_Thoby,
+#ifdef VECTORIZATION_SSE
+        ModifyCoord_Dist_Poly3_SSE, ModifyCoord_Dist_PTLens_SSE, ModifyCoord_UnDist_PTLens_SSE,
+#endif
+#ifdef VECTORIZATION_SSE2
+        ModifyCoord_Geom_FishEye_Rect_SSE2, ModifyCoord_Geom_Rect_FishEye_SSE2,
+        ModifyCoord_Geom_Orthographic_Rect_SSE2, ModifyCoord_Geom_Rect_Orthographic_SSE2,
+        ModifyCoord_Geom_Stereographic_Rect_SSE2, ModifyCoord_Geom_Rect_Stereographic_SSE2,
+        ModifyCoord_Geom_Equisolid_Rect_SSE2, ModifyCoord_Geom_Rect_Equisolid_SSE2,
+        ModifyCoord_Geom_Thoby_Rect_SSE2, ModifyCoord_Geom_Rect_Thoby_SSE2,
+#endif
+#ifdef VECTORIZATION_AVX2
+        ModifyCoord_Dist_Poly3_AVX2, ModifyCoord_UnDist_Poly3_AVX2,
+        ModifyCoord_Dist_Poly5_AVX2, ModifyCoord_UnDist_Poly5_AVX2,
+        ModifyCoord_Dist_PTLens_AVX2, ModifyCoord_UnDist_PTLens_AVX2,
+        ModifyCoord_UnDist_Fit_AVX2,
+        ModifyCoord_Geom_FishEye_Rect_AVX2, ModifyCoord_Geom_Rect_FishEye_AVX2,
+        ModifyCoord_Geom_Orthographic_Rect_AVX2, ModifyCoord_Geom_Rect_Orthographic_AVX2,
+        ModifyCoord_Geom_Stereographic_Rect_AVX2, ModifyCoord_Geom_Rect_Stereographic_AVX2,
+        ModifyCoord_Geom_Equisolid_Rect_AVX2, ModifyCoord_Geom_Rect_Equisolid_AVX2,
+        ModifyCoord_Geom_Thoby_Rect_AVX2, ModifyCoord_Geom_Rect_Thoby_AVX2,
+#endif
+    };
+    // Projection changes via the equirectangular projection, see
+    // EnableProjectionTransform.  Whether a pair is really symmetric is
+    // checked below.
+    static const lfModifyCoordFunc to_erect [] =
+    {
+        ModifyCoord_Geom_Rect_ERect, ModifyCoord_Geom_FishEye_ERect,
+        ModifyCoord_Geom_Orthographic_ERect, ModifyCoord_Geom_Stereographic_ERect,
+        ModifyCoord_Geom_Equisolid_ERect, ModifyCoord_Geom_Thoby_ERect,
+#ifdef VECTORIZATION_SSE2
+        ModifyCoord_Geom_Rect_ERect_SSE2, ModifyCoord_Geom_FishEye_ERect_SSE2,
+        ModifyCoord_Geom_Orthographic_ERect_SSE2, ModifyCoord_Geom_Stereographic_ERect_SSE2,
+        ModifyCoord_Geom_Equisolid_ERect_SSE2, ModifyCoord_Geom_Thoby_ERect_SSE2,
+#endif
+#ifdef VECTORIZATION_AVX2
+        ModifyCoord_Geom_Rect_ERect_AVX2, ModifyCoord_Geom_FishEye_ERect_AVX2,
+        ModifyCoord_Geom_Orthographic_ERect_AVX2, ModifyCoord_Geom_Stereographic_ERect_AVX2,
+        ModifyCoord_Geom_Equisolid_ERect_AVX2, ModifyCoord_Geom_Thoby_ERect_AVX2,
+#endif
+    };
+    static const lfModifyCoordFunc from_erect [] =
+    {
+        ModifyCoord_Geom_ERect_Rect, ModifyCoord_Geom_ERect_FishEye,
+        ModifyCoord_Geom_ERect_Orthographic, ModifyCoord_Geom_ERect_Stereographic,
+        ModifyCoord_Geom_ERect_Equisolid, ModifyCoord_Geom_ERect_Thoby,
+#ifdef VECTORIZATION_SSE2
+        ModifyCoord_Geom_ERect_Rect_SSE2, ModifyCoord_Geom_ERect_FishEye_SSE2,
+        ModifyCoord_Geom_ERect_Orthographic_SSE2, ModifyCoord_Geom_ERect_Stereographic_SSE2,
+        ModifyCoord_Geom_ERect_Equisolid_SSE2, ModifyCoord_Geom_ERect_Thoby_SSE2,
+#endif
+#ifdef VECTORIZATION_AVX2
+        ModifyCoord_Geom_ERect_Rect_AVX2, ModifyCoord_Geom_ERect_FishEye_AVX2,
+        ModifyCoord_Geom_ERect_Orthographic_AVX2, ModifyCoord_Geom_ERect_Stereographic_AVX2,
+        ModifyCoord_Geom_ERect_Equisolid_AVX2, ModifyCoord_Geom_ERect_Thoby_AVX2,
+#endif
+    };
+    auto contains = [] (const lfModifyCoordFunc *begin, const lfModifyCoordFunc *end,
+                        lfModifyCoordFunc func)
+    {
+        return std::find (begin, end, func) != end;
+    };
 
-    // 3 2 1
-    // 4   0
-    // 5 6 7
-    lfPoint point [8];
+    for (auto it = Callbacks->Coord.begin (); it != Callbacks->Coord.end (); ++it)
+    {
+        if (contains (std::begin (radial), std::end (radial), (*it)->callback))
+            continue;
+        auto next = std::next (it);
+        if (next == Callbacks->Coord.end () ||
+            !contains (std::begin (to_erect), std::end (to_erect), (*it)->callback) ||
+            !contains (std::begin (from_erect), std::end (from_erect), (*next)->callback))
+            return false;
+        it = next;
+    }
+    return true;
+}
 
-    point [1].angle = atan2 (Height, Width);
-    point [3].angle = M_PI - point [1].angle;
-    point [5].angle = M_PI + point [1].angle;
-    point [7].angle = 2 * M_PI - point [1].angle;
+/*
+ * Build the kernel of a radial chain, once, when it is used for the first
+ * time after PlanCoordCallbacks.  Several threads may be applying the
+ * modifier at that moment, so that this is guarded; afterwards the kernel is
+ * only read.
+ */
+void lfModifier::PrepareCoordKernel () const
+{
+    if (!CoordKernel.radial_pending || !g_once_init_enter (&Callbacks->radial_ready))
+        return;
 
-    point [0].angle = 0.0F;
-    point [2].angle = float (M_PI / 2.0);
-    point [4].angle = float (M_PI);
-    point [6].angle = float (M_PI * 3.0 / 2.0);
+    lfModifier *self = const_cast<lfModifier *> (this);
+    if (self->BuildRadialTable ())
+    {
+        lfCoordKernel &kernel = self->CoordKernel;
+        // The table includes the scaling
+        kernel.pre_scale = kernel.post_scale = 1.0f;
+#ifdef VECTORIZATION_AVX2
+        if (_lf_cpu_has_avx2_fma ())
+            kernel.row = ModifyCoordRow_Radial_AVX2;
+        else
+#endif
+        kernel.row = ModifyCoordRow_Radial;
+        kernel.symmetric = true;
+        kernel.dx = NormScale;
+        kernel.out_scale = NormUnScale;
+    }
+    g_once_init_leave (&Callbacks->radial_ready, 1);
+}
 
-    point [1].dist = point [3].dist = point [5].dist = point [7].dist =
-        sqrt (pow (Width, 2) + pow (Height, 2)) * 0.5 * NormScale;
-    point [0].dist = point [4].dist = Width * 0.5 * NormScale;
-    point [2].dist = point [6].dist = Height * 0.5 * NormScale;
+/*
+ * The ratio of a radial chain is tabulated for linear interpolation over the
+ * radii of the image, with as many entries as it takes to stay within 1/1000
+ * pixel of the exact chain.  The error of linear interpolation grows with
+ * the square of the step, so the size is estimated from a coarse table.
+ * Where the error is still too large (e.g. beyond the valid range of a
+ * projection), the table ends and the callbacks are used.
+ */
+bool lfModifier::BuildRadialTable ()
+{
+    auto run = [this] (float *coords, int count)
+    {
+        for (auto cb : Callbacks->Coord)
+            cb->callback (cb, coords, count);
+    };
 
-    float scale = 0.01F;
-    for (int i = 0; i < 8; i++)
+    // Radii up to the farthest image corner, plus a margin like for the
+    // fitted inverse distortion
+    double max_r = 0.0;
+    for (int i = 0; i < 4; i++)
     {
-        float transformed_distance = GetTransformedDistance (point [i]);
-        float point_scale = point [i].dist / transformed_distance;
-        if (point_scale > scale)
-            scale = point_scale;
+        const double x = (i & 1 ? Width : 0.0) * NormScale - CenterX;
+        const double y = (i & 2 ? Height : 0.0) * NormScale - CenterY;
+        max_r = std::max (max_r, sqrt (x * x + y * y));
     }
-    // 1 permille is our limit of accuracy (in rare cases, we may be even
+    max_r *= 1.05;
+    if (max_r <= 0.0)
+        return false;
+
+    const double max_error = 1e-3 * NormScale;
+    std::vector<float> table, coords;
+    float table_step = 0.0f;
+    int table_cells = 0;
+
+    // Evaluate the chain at the nodes of a table of the given size and at
+    // the midpoints between them, and check the linear interpolation in
+    // every cell.  The table ends before the first cell where the error is
+    // above limit, and the largest error before is returned.
+    auto build = [&] (int size, double limit)
+    {
+        // At r = 0, the ratio is a limit
+        const float step = max_r / (size - 1);
+        coords.resize (4 * size);
+        for (int i = 0; i < 2 * size; i++)
+        {
+            coords [2 * i] = i * step * 0.5f;
+            coords [2 * i + 1] = 0.0f;
+        }
+        coords [0] = step * 1e-3f;
+        run (&coords [0], 2 * size);
+
+        table.resize (size);
+        table [0] = coords [0] / (step * 1e-3f);
+        for (int i = 1; i < size; i++)
+            table [i] = coords [4 * i] / (2 * i * step * 0.5f);
+
+        double largest = 0.0;
+        for (table_cells = 0; table_cells < size - 1; table_cells++)
+        {
+            const float r = (2 * table_cells + 1) * step * 0.5f;
+            const double error = absolute ((table [table_cells] + table [table_cells + 1]) * 0.5 * r -
+                                           coords [4 * table_cells + 2]);
+            if (!(error <= limit && absolute (coords [4 * table_cells + 3]) <= max_error))
+                break;
+            largest = std::max (largest, error);
+        }
+        table.resize (table_cells + 1);
+        table_step = step;
+        return largest;
+    };
+
+    // A coarse table over the range where the chain is finite tells the
+    // curvature; scale the size from there, with a margin of 25 %
+    const int coarse_size = 128, max_size = 16384;
+    const double coarse_error = build (coarse_size, std::numeric_limits<double>::max ());
+    const double size = 1 + (coarse_size - 1) * sqrt (coarse_error / max_error) * 1.25;
+    if (size > coarse_size)
+        build (int (std::min (ceil (size), double (max_size))), max_error);
+    if (!table_cells)
+        return false;
+
+    // Check the symmetry in other directions
+    for (int k = 1; k <= 32; k++)
+    {
+        static const float angles [] = { 0.4f, 1.2f, 2.1f, 3.7f, 5.3f };
+        const float r = table_cells * table_step * k / 33.0f;
+        const float t = r / table_step;
+        const float ratio = table [int (t)] + (table [int (t) + 1] - table [int (t)]) * (t - int (t));
+        for (float angle : angles)
+        {
+            float coords [2] = { r * cosf (angle), r * sinf (angle) };
+            const float x = coords [0] * ratio, y = coords [1] * ratio;
+            run (coords, 1);
+            if (!(hypot (coords [0] - x, coords [1] - y) <= 2 * max_error))
+                return false;
+        }
+    }
+
+    CoordKernel.radial.swap (table);
+    CoordKernel.radial_step = table_step;
+    return true;
+}
+
+void lfModifier::ModifyCoordRow_Radial (void *data, float x, float y, int width,
+                                        float *res_x, float *res_y, int stride)
+{
+    const lfModifier *modifier = (const lfModifier *) data;
+    const lfCoordKernel &kernel = modifier->CoordKernel;
+    const float *table = &kernel.radial [0];
+    const float last = float (kernel.radial.size () - 1);
+    const float inv_step = 1.0f / kernel.radial_step;
+
+    // Points beyond the table are collected into runs and sent through the
+    // callbacks in one go.
+    int run = -1;
+    for (int i = 0; i < width; i++)
+    {
+        const float xi = x + i * kernel.dx;
+        const float t = sqrtf (xi * xi + y * y) * inv_step;
+        float *out_x = res_x + i * stride, *out_y = res_y + i * stride;
+        if (t < last)
+        {
+            if (run >= 0)
+            {
+                modifier->ApplyCoordCallbacks (res_x + run * stride, res_y + run * stride,
+                                               stride, i - run);
+                run = -1;
+            }
+            const int k = int (t);
+            const float ratio = table [k] + (table [k + 1] - table [k]) * (t - k);
+            *out_x = xi * ratio * kernel.out_scale + kernel.out_x;
+            *out_y = y * ratio * kernel.out_scale + kernel.out_y;
+        }
+        else
+        {
+            *out_x = xi * kernel.out_scale + kernel.out_x;
+            *out_y = y * kernel.out_scale + kernel.out_y;
+            if (run < 0)
+                run = i;
+        }
+    }
+    if (run >= 0)
+        modifier->ApplyCoordCallbacks (res_x + run * stride, res_y + run * stride,
+                                       stride, width - run);
+}
+
+/*
+ * The forward distortion models for ModifyCoordRow_Dist.  They are set up
+ * once per row with the terms which only depend on y, and then give the
+ * distorted coordinates for x and the squared radius.
+ */
+struct Dist_Poly3_Row
+{
+    float k1;
+    Dist_Poly3_Row (const float *terms, float) : k1 (terms [0]) {}
+    inline void operator () (float x, float y, float r2, float &ox, float &oy) const
+    {
+        const float poly2 = k1 * r2 + 1;
+        ox = x * poly2;
+        oy = y * poly2;
+    }
+};
+
+struct Dist_Poly5_Row
+{
+    float k1, k2;
+    Dist_Poly5_Row (const float *terms, float) : k1 (terms [0]), k2 (terms [1]) {}
+    inline void operator () (float x, float y, float r2, float &ox, float &oy) const
+    {
+        const float poly4 = 1 + r2 * (k1 + r2 * k2);
+        ox = x * poly4;
+        oy = y * poly4;
+    }
+};
+
+struct Dist_PTLens_Row
+{
+    float a, b, c;
+    Dist_PTLens_Row (const float *terms, float) :
+        a (terms [0]), b (terms [1]), c (terms [2]) {}
+    inline void operator () (float x, float y, float r2, float &ox, float &oy) const
+    {
+        // The differences may step just below zero next to the centre
+        const float r = sqrtf (std::max (r2, 0.0f));
+        const float poly3 = (a * r + b) * r2 + c * r + 1;
+        ox = x * poly3;
+        oy = y * poly3;
+    }
+};
+
+struct Dist_ACM_Row
+{
+    float k1, k2, k3, k4, k5, row_term;
+    Dist_ACM_Row (const float *terms, float y) :
+        k1 (terms [0]), k2 (terms [1]), k3 (terms [2]), k4 (terms [3]), k5 (terms [4]),
+        row_term (1 + 2 * terms [3] * y) {}
+    inline void operator () (float x, float y, float r2, float &ox, float &oy) const
+    {
+        const float common_term = row_term + 2 * k5 * x + r2 * (k1 + r2 * (k2 + r2 * k3));
+        ox = x * common_term + k5 * r2;
+        oy = y * common_term + k4 * r2;
+    }
+};
+
+/*
+ * The squared radius is updated with forward differences along the row,
+ * which saves the multiplications of x * x + y * y.  Rounding errors add up,
+ * so the differences are restarted from the exact values every 64 pixels;
+ * this keeps the drift below 1e-5 of r².
+ */
+template<typename Model> static void dist_row (
+    const float *terms, float x, float y, float dx, float out_scale,
+    float out_x, float out_y, int width, float *res_x, float *res_y, int stride)
+{
+    const Model model (terms, y);
+    const float y2 = y * y;
+    const float d2 = 2 * dx * dx;
+
+    for (int i = 0; i < width; )
+    {
+        const int end = std::min (width, i + 64);
+        float xi = x + i * dx;
+        float r2 = xi * xi + y2;
+        float d1 = (2 * xi + dx) * dx;
+        for (; i < end; i++, xi += dx, r2 += d1, d1 += d2)
+        {
+            float ox, oy;
+            model (xi, y, r2, ox, oy);
+            res_x [i * stride] = ox * out_scale + out_x;
+            res_y [i * stride] = oy * out_scale + out_y;
+        }
+    }
+}
+
+/*
+ * Plain row function for a single forward distortion model, see
+ * PlanCoordCallbacks.  stage_id is the lfDistortionModel.
+ */
+void lfModifier::ModifyCoordRow_Dist (void *data, float x, float y, int width,
+                                      float *res_x, float *res_y, int stride)
+{
+    const lfCoordKernel &kernel = ((const lfModifier *) data)->CoordKernel;
+    const float *terms = ((lfCoordDistCallbackData *) kernel.stage)->terms;
+
+#define DIST_ROW(model) \
+    dist_row<model> (terms, x, y, kernel.dx, kernel.out_scale, kernel.out_x, \
+                     kernel.out_y, width, res_x, res_y, stride)
+
+    switch (kernel.stage_id)
+    {
+        case LF_DIST_MODEL_POLY3:
+            DIST_ROW (Dist_Poly3_Row);
+            break;
+        case LF_DIST_MODEL_POLY5:
+            DIST_ROW (Dist_Poly5_Row);
+            break;
+        case LF_DIST_MODEL_PTLENS:
+            DIST_ROW (Dist_PTLens_Row);
+            break;
+        case LF_DIST_MODEL_ACM:
+            DIST_ROW (Dist_ACM_Row);
+            break;
+        default:
+            break;
+    }
+
+#undef DIST_ROW
+}
+
+void lfModifier::AddCoordGeomCallback (lfModifyCoordFunc func, int priority)
+{
+    lfCoordGeomCallbackData cd;
+
+#ifdef VECTORIZATION_AVX2
+    if (_lf_cpu_has_avx2_fma ())
+        func = GetGeomCallback_AVX2 (func);
+#endif
+#ifdef VECTORIZATION_SSE2
+    // Leaves the AVX2 callbacks alone
+    if (_lf_detect_cpu_features () & LF_CPU_FLAG_SSE2)
+        func = GetGeomCallback_SSE2 (func);
+#endif
+    cd.callback = func;
+    cd.priority = priority;
+
+    AddCoordCallback (cd);
+}
+
+double lfModifier::AutoscaleResidualDistance (float *coord) const
+{
+
+    // Maximal x and y value in normalized coordinates for the original image
+    double max_x = Width / 2.0 * NormScale;
+    double max_y = Height / 2.0 * NormScale;
+
+    double result = coord [0] - max_x;
+    double intermediate = -max_x - coord [0];
+    if (intermediate > result) result = intermediate;
+    intermediate = coord [1] - max_y;
+    if (intermediate > result) result = intermediate;
+    intermediate = -max_y - coord [1];
+    return intermediate > result ? intermediate : result;
+}
+
+float lfModifier::GetTransformedDistance (lfPoint point) const
+{
+    double dist = point.dist;
+    double sa = sin (point.angle);
+    double ca = cos (point.angle);
+
+    // We have to find the radius ru in the direction of the given point which
+    // distorts to the original (distorted) image edge.  We will use Newton's
+    // method for minimizing the distance between the distorted point at ru and
+    // the original edge.
+    float ru = dist; // Initial approximation
+    float dx = 0.0001F;
+    for (int countdown = 50; ; countdown--)
+    {
+        float res [2];
+
+        res [0] = ca * ru; res [1] = sa * ru;
+        for (auto cb : Callbacks->Coord)
+            cb->callback (cb, res, 1);
+
+        double rd = AutoscaleResidualDistance (res);
+        if (rd > -NEWTON_EPS * 100 && rd < NEWTON_EPS * 100)
+            break;
+
+        if (!countdown)
+            // e.g. for some ultrawide fisheyes corners extend to infinity
+            // so function never converge ...
+            return -1;
+
+        // Compute approximative function prime in (x,y)
+        res [0] = ca * (ru + dx); res [1] = sa * (ru + dx);
+        for (auto cb : Callbacks->Coord)
+            cb->callback (cb, res, 1);
+
+        double rd1 = AutoscaleResidualDistance (res);
+
+        // If rd1 is very close to rd, this means our delta is too small
+        // and we can hit the precision limit of the float format...
+        if (absolute (rd1 - rd) < 0.00001)
+        {
+            dx *= 2;
+            continue;
+        }
+
+        // dy/dx;
+        double prime = (rd1 - rd) / dx;
+
+        ru -= rd / prime;
+    }
+
+    return ru;
+}
+
+/*
+ * Process-wide cache of automatic scale factors.  Batches of images usually
+ * share only a few combinations of lens, focal length, and image size, so
+ * the Newton iterations of ComputeAutoScale need to run only once for each.
+ */
+static struct
+{
+    std::map<std::string, float> scales;
+    unsigned long hits, misses;
+} autoscale_cache;
+
+/*
+ * Everything that ComputeAutoScale depends on: the image frame in normalized
+ * coordinates, and the coordinate callbacks with their parameters.  The
+ * geometry callbacks have no parameters.
+ */
+std::string lfModifier::AutoScaleKey (bool reverse) const
+{
+    std::string key;
+    const double frame [3] = { Width, Height, NormScale };
+    const char flags [2] = { reverse, Callbacks->Subpixel.size () != 0 };
+    append_key (key, frame, 3);
+    append_key (key, flags, 2);
+
+    for (auto cb : Callbacks->Coord)
+    {
+        append_key (key, &cb->callback);
+        append_key (key, &cb->priority);
+        if (auto fit = dynamic_cast<lfCoordDistFitCallbackData*> (cb))
+        {
+            append_key (key, &fit->newton);
+            append_key (key, &fit->max_rd);
+            append_key (key, fit->coeffs, fit->coeff_count);
+        }
+        if (auto dist = dynamic_cast<lfCoordDistCallbackData*> (cb))
+            append_key (key, dist->terms, 5);
+        else if (auto scale = dynamic_cast<lfCoordScaleCallbackData*> (cb))
+            append_key (key, &scale->scale_factor);
+        else if (auto persp = dynamic_cast<lfCoordPerspCallbackData*> (cb))
+        {
+            append_key (key, &persp->A [0][0], 9);
+            append_key (key, &persp->delta_a);
+            append_key (key, &persp->delta_b);
+        }
+    }
+    return key;
+}
+
+float lfModifier::GetAutoScale (bool reverse)
+{
+    const std::string key = AutoScaleKey (reverse);
+
+    cache_lock ();
+    auto cached = autoscale_cache.scales.find (key);
+    const bool hit = cached != autoscale_cache.scales.end ();
+    const float scale = hit ? cached->second : 0.0f;
+    if (hit)
+        autoscale_cache.hits++;
+    else
+        autoscale_cache.misses++;
+    cache_unlock ();
+    if (hit)
+        return scale;
+
+    // Computed outside of the lock, so that a concurrent miss for the same
+    // key just computes the same value again
+    const float result = ComputeAutoScale (reverse);
+
+    cache_lock ();
+    if (autoscale_cache.scales.size () >= cache_size)
+        autoscale_cache.scales.clear ();
+    autoscale_cache.scales [key] = result;
+    cache_unlock ();
+    return result;
+}
+
+void lfModifier::GetAutoScaleCacheStats (unsigned long *hits, unsigned long *misses)
+{
+    cache_lock ();
+    *hits = autoscale_cache.hits;
+    *misses = autoscale_cache.misses;
+    cache_unlock ();
+}
+
+void lfModifier::ClearAutoScaleCache ()
+{
+    cache_lock ();
+    autoscale_cache.scales.clear ();
+    autoscale_cache.hits = autoscale_cache.misses = 0;
+    cache_unlock ();
+}
+
+float lfModifier::ComputeAutoScale (bool reverse) const
+{
+    // Compute the scale factor automatically
+    const float subpixel_scale = Callbacks->Subpixel.size() == 0 ? 1.0 : 1.001;
+
+    if (Callbacks->Coord.size() == 0)
+        return subpixel_scale;
+
+    // 3 2 1
+    // 4   0
+    // 5 6 7
+    lfPoint point [8];
+
+    point [1].angle = atan2 (Height, Width);
+    point [3].angle = M_PI - point [1].angle;
+    point [5].angle = M_PI + point [1].angle;
+    point [7].angle = 2 * M_PI - point [1].angle;
+
+    point [0].angle = 0.0F;
+    point [2].angle = float (M_PI / 2.0);
+    point [4].angle = float (M_PI);
+    point [6].angle = float (M_PI * 3.0 / 2.0);
+
+    point [1].dist = point [3].dist = point [5].dist = point [7].dist =
+        sqrt (pow (Width, 2) + pow (Height, 2)) * 0.5 * NormScale;
+    point [0].dist = point [4].dist = Width * 0.5 * NormScale;
+    point [2].dist = point [6].dist = Height * 0.5 * NormScale;
+
+    float scale = 0.01F;
+    for (int i = 0; i < 8; i++)
+    {
+        float transformed_distance = GetTransformedDistance (point [i]);
+        float point_scale = point [i].dist / transformed_distance;
+        if (point_scale > scale)
+            scale = point_scale;
+    }
+    // 1 permille is our limit of accuracy (in rare cases, we may be even
     // worse, depending on what happens between the test points), so assure
     // that we really have no black borders left.
     scale *= 1.001;
     scale *= subpixel_scale;
 
-    return reverse ? 1.0 / scale : scale;
+    return reverse ? 1.0 / scale : scale;
+}
+
+/*
+ * The distance from the image centre, in pixels, to the edge of the valid
+ * region along every direction (cos, sin), i.e. to where the source
+ * coordinates leave the image or have no solution.  All rays are bracketed
+ * and then bisected in lockstep, so that every step runs the callbacks on
+ * all of them at once.  This assumes that the region is star-shaped about
+ * the centre.  Every distance is at most 1e-3 pixels too short.
+ */
+void lfModifier::TraceValidRays (const float *directions, int count, float *distances) const
+{
+    const float cx = Width / 2.0, cy = Height / 2.0;
+    std::vector<float> lo (count, 0.0f), hi (count, float (hypot (Width, Height)));
+    std::vector<float> coords (size_t (count) * 2);
+    std::vector<unsigned char> valid (count);
+    auto probe = [&] (const std::vector<float> &radius)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            coords [i * 2] = cx + directions [i * 2] * radius [i];
+            coords [i * 2 + 1] = cy + directions [i * 2 + 1] * radius [i];
+        }
+        ApplyCoordCallbacks (&coords [0], count);
+        for (int i = 0; i < count; i++)
+        {
+            const float x = coords [i * 2], y = coords [i * 2 + 1];
+            // NaN fails every comparison
+            valid [i] = x >= 0.0f && x <= Width && y >= 0.0f && y <= Height;
+        }
+    };
+
+    // Widen the brackets of rays which are still valid at their end, e.g.
+    // for a scaled down image
+    for (int step = 0; step < 8; step++)
+    {
+        probe (hi);
+        bool widened = false;
+        for (int i = 0; i < count; i++)
+            if (valid [i])
+            {
+                lo [i] = hi [i];
+                hi [i] *= 2;
+                widened = true;
+            }
+        if (!widened)
+            break;
+    }
+
+    std::vector<float> mid (count);
+    for (int step = 0; step < 40; step++)
+    {
+        float width = 0.0f;
+        for (int i = 0; i < count; i++)
+        {
+            mid [i] = 0.5f * (lo [i] + hi [i]);
+            width = std::max (width, hi [i] - lo [i]);
+        }
+        if (width < 1e-3f)
+            break;
+
+        probe (mid);
+        for (int i = 0; i < count; i++)
+            (valid [i] ? lo [i] : hi [i]) = mid [i];
+    }
+
+    for (int i = 0; i < count; i++)
+        distances [i] = lo [i];
+}
+
+bool lfModifier::GetValidOutline (int count, float *outline) const
+{
+    if (count <= 0)
+        return false;
+
+    std::vector<float> directions (size_t (count) * 2), distances (count);
+    for (int i = 0; i < count; i++)
+    {
+        const double angle = 2 * M_PI * i / count;
+        directions [i * 2] = cos (angle);
+        directions [i * 2 + 1] = sin (angle);
+    }
+    TraceValidRays (&directions [0], count, &distances [0]);
+
+    bool found = false;
+    for (int i = 0; i < count; i++)
+    {
+        outline [i * 2] = Width / 2.0 + directions [i * 2] * distances [i];
+        outline [i * 2 + 1] = Height / 2.0 + directions [i * 2 + 1] * distances [i];
+        found |= distances [i] > 0.0f;
+    }
+    return found;
+}
+
+/*
+ * The half height of the largest rectangle of the given aspect ratio about
+ * (x, y) which doesn't overlap the segment from p0 to p1, i.e. their
+ * distance in the maximum norm, with X divided by the aspect ratio.  This
+ * is convex and piecewise linear along the segment, so its minimum is at
+ * an end, or where U, V, U-V, or U+V has its root.
+ */
+static float crop_distance (float aspect, float x, float y, const float *p0, const float *p1)
+{
+    const float u = (p0 [0] - x) / aspect, v = p0 [1] - y;
+    const float du = (p1 [0] - p0 [0]) / aspect, dv = p1 [1] - p0 [1];
+    const float roots [6] = { 0.0f, 1.0f, -u / du, -v / dv, (v - u) / (du - dv), -(u + v) / (du + dv) };
+    float distance = std::numeric_limits<float>::infinity ();
+    for (float t : roots)
+        // Division by zero gives infinity or NaN, which fail the test
+        if (t >= 0.0f && t <= 1.0f)
+            distance = std::min (distance, std::max (fabs (u + t * du), fabs (v + t * dv)));
+    return distance;
+}
+
+/*
+ * The crop is searched within the polygon of the traced outline.  For a
+ * given centre inside the polygon, the largest rectangle is limited by the
+ * nearest edge in the maximum norm; a pattern search moves the centre,
+ * starting at the image centre, as long as this grows the rectangle.  The
+ * edges of the polygon cut across the region where the outline curves
+ * inwards between the rays, so finally the edges of the rectangle are
+ * checked at every pixel against the callbacks, and the rectangle shrinks
+ * until all of them have source pixels.  The region has no holes, since it
+ * is star-shaped, so this covers the whole rectangle.
+ */
+bool lfModifier::GetAutoCrop (float aspect, float *crop) const
+{
+    if (aspect <= 0.0f)
+        aspect = Width / Height;
+
+    const int count = 1024;
+    std::vector<float> outline (size_t (count) * 2);
+    if (!GetValidOutline (count, &outline [0]))
+        return false;
+
+    auto half_height = [&] (float x, float y)
+    {
+        // Only centres inside the polygon (by the crossing number) count;
+        // outside, the rectangle may miss all of the edges
+        bool inside = false;
+        float distance = std::numeric_limits<float>::infinity ();
+        for (int i = 0, j = count - 1; i < count; j = i++)
+        {
+            const float *p0 = &outline [j * 2], *p1 = &outline [i * 2];
+            if ((p0 [1] > y) != (p1 [1] > y) &&
+                x < p0 [0] + (y - p0 [1]) * (p1 [0] - p0 [0]) / (p1 [1] - p0 [1]))
+                inside = !inside;
+            distance = std::min (distance, crop_distance (aspect, x, y, p0, p1));
+        }
+        return inside ? distance : 0.0f;
+    };
+
+    float cx = Width / 2.0, cy = Height / 2.0;
+    float best = half_height (cx, cy);
+    if (!(best > 0.0f))
+        return false;
+
+    for (float step = best / 4; step > 1e-2f; )
+    {
+        float next_x = cx, next_y = cy;
+        for (int i = 0; i < 9; i++)
+        {
+            const float x = cx + (i % 3 - 1) * step, y = cy + (i / 3 - 1) * step;
+            const float h = i == 4 ? 0.0f : half_height (x, y);
+            if (h > best)
+            {
+                best = h;
+                next_x = x;
+                next_y = y;
+            }
+        }
+        if (next_x == cx && next_y == cy)
+            step /= 2;
+        cx = next_x;
+        cy = next_y;
+    }
+
+    std::vector<float> coords;
+    for (float shrink = 0.25f; ; shrink *= 2)
+    {
+        const float x0 = cx - best * aspect, y0 = cy - best;
+        const float x1 = cx + best * aspect, y1 = cy + best;
+        const int columns = int (ceil (x1 - x0)), rows = int (ceil (y1 - y0));
+        coords.clear ();
+        for (int i = 0; i <= columns; i++)
+        {
+            const float x = x0 + (x1 - x0) * i / columns;
+            coords.insert (coords.end (), { x, y0, x, y1 });
+        }
+        for (int i = 1; i < rows; i++)
+        {
+            const float y = y0 + (y1 - y0) * i / rows;
+            coords.insert (coords.end (), { x0, y, x1, y });
+        }
+        ApplyCoordCallbacks (&coords [0], int (coords.size () / 2));
+
+        bool valid = true;
+        for (size_t i = 0; i < coords.size () && valid; i += 2)
+            // NaN fails every comparison
+            valid = coords [i] >= 0.0f && coords [i] <= Width &&
+                    coords [i + 1] >= 0.0f && coords [i + 1] <= Height;
+        if (valid)
+            break;
+        best -= shrink;
+        if (!(best > 0.0f))
+            return false;
+    }
+
+    crop [0] = cx - best * aspect;
+    crop [1] = cy - best;
+    crop [2] = cx + best * aspect;
+    crop [3] = cy + best;
+    return true;
+}
+
+bool lfModifier::ApplyGeometryDistortion (
+    float xu, float yu, int width, int height, float *res) const
+{
+    return ComputeGeometryDistortion (xu, yu, width, height, res, res + 1,
+                                      2, size_t (width) * 2);
+}
+
+bool lfModifier::ApplyGeometryDistortion (
+    float xu, float yu, int width, int height,
+    float *res_x, float *res_y, int row_stride) const
+{
+    return ComputeGeometryDistortion (xu, yu, width, height, res_x, res_y,
+                                      1, row_stride / sizeof (float));
+}
+
+/// The rows of a band of the map of ComputeGeometryDistortionJacobian
+static const int jacobian_band_rows = 16;
+
+size_t lfModifier::JacobianScratchSize (int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return 0;
+    return (std::min (jacobian_band_rows, height) + 2) * size_t (width + 2) * 2;
+}
+
+bool lfModifier::ApplyGeometryDistortionJacobian (
+    float xu, float yu, int width, int height, float *res, float *jacobian) const
+{
+    if (Callbacks->Coord.size() <= 0 || width <= 0 || height <= 0)
+        return false; // nothing to do
+
+    std::vector<float> map (JacobianScratchSize (width, height));
+    return ComputeGeometryDistortionJacobian (xu, yu, width, height, res, jacobian, &map [0]);
+}
+
+/*
+ * The map is computed with a border of one pixel, so that the Jacobian is
+ * the central difference of the neighbours of every pixel.  This goes band
+ * by band, and the last two rows of a band are the first two of the next,
+ * so every row is computed once, by the fastest path available.  The map
+ * is the caller's scratch space of JacobianScratchSize() floats.
+ */
+bool lfModifier::ComputeGeometryDistortionJacobian (
+    float xu, float yu, int width, int height, float *res, float *jacobian,
+    float *map) const
+{
+    if (Callbacks->Coord.size() <= 0 || width <= 0 || height <= 0)
+        return false; // nothing to do
+
+    const int band_rows = jacobian_band_rows;
+    const size_t stride = size_t (width + 2) * 2;
+    ComputeGeometryDistortion (xu - 1, yu - 1, width + 2, 2, &map [0], &map [1], 2, stride);
+    for (int band = 0; band < height; band += band_rows)
+    {
+        const int rows = std::min (band_rows, height - band);
+        ComputeGeometryDistortion (xu - 1, yu + band + 1, width + 2, rows,
+                                   &map [2 * stride], &map [2 * stride + 1], 2, stride);
+
+        for (int j = 0; j < rows; j++)
+        {
+            const float *above = &map [j * stride];
+            const float *row = above + stride, *below = row + stride;
+            float *out = res + size_t (band + j) * width * 2;
+            float *jac = jacobian + size_t (band + j) * width * 4;
+            // The left, own and right coordinates slide along the row
+            float lx = row [0], ly = row [1], x = row [2], y = row [3];
+            for (int i = 0; i < width; i++, out += 2, jac += 4)
+            {
+                const int c = i * 2 + 2;
+                const float rx = row [c + 2], ry = row [c + 3];
+                out [0] = x;
+                out [1] = y;
+                jac [0] = 0.5f * (rx - lx);
+                jac [1] = 0.5f * (below [c] - above [c]);
+                jac [2] = 0.5f * (ry - ly);
+                jac [3] = 0.5f * (below [c + 1] - above [c + 1]);
+                lx = x; ly = y; x = rx; y = ry;
+            }
+        }
+
+        memmove (&map [0], &map [rows * stride], 2 * stride * sizeof (float));
+    }
+
+    return true;
+}
+
+/*
+ * Bit k of mask word i / 32 tells whether pixel i + k lies within the
+ * image.  NaN fails every comparison, so pixels without a solution are
+ * invalid without an extra test.
+ */
+void lfModifier::ValidMask (const float *coords, int count, float max_x, float max_y, lf_u32 *mask)
+{
+    for (int i = 0; i < count; i += 32, coords += 64)
+    {
+        const int n = std::min (32, count - i);
+        lf_u32 word = 0;
+        for (int k = 0; k < n; k++)
+        {
+            const float x = coords [k * 2], y = coords [k * 2 + 1];
+            word |= lf_u32 ((x >= 0.0f) & (x <= max_x) & (y >= 0.0f) & (y <= max_y)) << k;
+        }
+        mask [i / 32] = word;
+    }
+}
+
+bool lfModifier::ApplyGeometryDistortionMask (
+    float xu, float yu, int width, int height, float *res, lf_u32 *mask) const
+{
+    if (!ComputeGeometryDistortion (xu, yu, width, height, res, res + 1,
+                                    2, size_t (width) * 2))
+        return false;
+
+    void (*valid_mask) (const float *, int, float, float, lf_u32 *) = ValidMask;
+#ifdef VECTORIZATION_SSE
+    if (_lf_detect_cpu_features () & LF_CPU_FLAG_SSE)
+        valid_mask = ValidMask_SSE;
+#endif
+    const int mask_stride = (width + 31) / 32;
+    for (int j = 0; j < height; j++)
+        valid_mask (res + size_t (j) * width * 2, width, Width, Height,
+                    mask + size_t (j) * mask_stride);
+
+    return true;
+}
+
+/*
+ * The border of the rectangle x0 ... x1, y0 ... y1 as four edges which share
+ * their corners.  Every edge is sampled at least every pixel and at least
+ * once between the corners, so that it has a curvature estimate.  Edge e
+ * consists of the points edges [e] ... edges [e + 1] - 1.
+ */
+static void sample_border (float x0, float y0, float x1, float y1,
+                           std::vector<float> &coords, int edges [5])
+{
+    const float corners [5][2] = { { x0, y0 }, { x1, y0 }, { x1, y1 }, { x0, y1 }, { x0, y0 } };
+    coords.clear ();
+    for (int e = 0; e < 4; e++)
+    {
+        edges [e] = int (coords.size () / 2);
+        const float dx = corners [e + 1][0] - corners [e][0];
+        const float dy = corners [e + 1][1] - corners [e][1];
+        const int n = std::max (2, int (ceil (std::max (fabs (dx), fabs (dy)))));
+        for (int i = 0; i <= n; i++)
+        {
+            coords.push_back (corners [e][0] + dx * i / n);
+            coords.push_back (corners [e][1] + dy * i / n);
+        }
+    }
+    edges [4] = int (coords.size () / 2);
+}
+
+/*
+ * The bounding box of a mapped border, { x_min, y_min, x_max, y_max }.  A
+ * one-to-one mapping has a regular Jacobian, so neither coordinate has an
+ * extremum inside the rectangle, and the box of the border holds the whole
+ * rectangle.  Between two samples at most a pixel apart, the mapped border
+ * leaves the chord by at most an eighth of its largest second derivative
+ * there.  At this spacing, the second differences of the samples give the
+ * second derivatives up to the third order terms, which a smooth mapping
+ * makes negligible; the box gets twice the largest of them as a margin.
+ * The tolerance is added on top.  Returns false if a point has no
+ * solution.
+ */
+static bool border_region (const std::vector<float> &coords, const int edges [5],
+                           float tolerance, float region [4])
+{
+    float margin [2] = { 0.0f, 0.0f };
+    region [0] = region [1] = std::numeric_limits<float>::infinity ();
+    region [2] = region [3] = -std::numeric_limits<float>::infinity ();
+    for (int e = 0; e < 4; e++)
+        for (int i = edges [e]; i < edges [e + 1]; i++)
+            for (int c = 0; c < 2; c++)
+            {
+                const float v = coords [i * 2 + c];
+                if (std::isnan (v))
+                    return false;
+                region [c] = std::min (region [c], v);
+                region [c + 2] = std::max (region [c + 2], v);
+                if (i > edges [e] && i + 1 < edges [e + 1])
+                {
+                    const float d2 = coords [i * 2 - 2 + c] - 2 * v + coords [i * 2 + 2 + c];
+                    margin [c] = std::max (margin [c], fabs (d2) / 4);
+                }
+            }
+
+    for (int c = 0; c < 2; c++)
+    {
+        region [c] -= margin [c] + tolerance;
+        region [c + 2] += margin [c] + tolerance;
+    }
+    return true;
+}
+
+/// Extend a bounding box by a point
+static inline void extend_region (float region [4], float x, float y)
+{
+    region [0] = std::min (region [0], x);
+    region [1] = std::min (region [1], y);
+    region [2] = std::max (region [2], x);
+    region [3] = std::max (region [3], y);
+}
+
+bool lfModifier::GetSourceRegion (
+    float xu, float yu, int width, int height, float *region) const
+{
+    if (Callbacks->Coord.size() <= 0 || width <= 0 || height <= 0)
+        return false; // nothing to do
+
+    // The border is mapped by the callbacks.  The fused rows of
+    // ComputeGeometryDistortion round differently, and the grid, if any,
+    // only gets within its error of the callbacks.
+    const float tolerance = 0.01f + (CoordGrid.spacing ? CoordGrid.error : 0.0f);
+    std::vector<float> coords;
+    int edges [5];
+    sample_border (xu, yu, xu + width - 1, yu + height - 1, coords, edges);
+    ApplyCoordCallbacks (&coords [0], edges [4]);
+    if (border_region (coords, edges, tolerance, region))
+        return true;
+
+    // Parts of the border have no source, so the region is only known from
+    // all of its pixels
+    region [0] = region [1] = std::numeric_limits<float>::infinity ();
+    region [2] = region [3] = -std::numeric_limits<float>::infinity ();
+    std::vector<float> row (size_t (width) * 2);
+    bool found = false;
+    for (int j = 0; j < height; j++)
+    {
+        ComputeGeometryDistortion (xu, yu + j, width, 1, &row [0], &row [1], 2, row.size ());
+        for (int i = 0; i < width; i++)
+            if (!std::isnan (row [i * 2]) && !std::isnan (row [i * 2 + 1]))
+            {
+                extend_region (region, row [i * 2], row [i * 2 + 1]);
+                found = true;
+            }
+    }
+    return found;
+}
+
+bool lfModifier::GetTargetRegion (
+    float xs, float ys, int width, int height, float *region) const
+{
+    if (Callbacks->Coord.size() <= 0 || width <= 0 || height <= 0)
+        return false; // nothing to do
+
+    // With the grid, pixels whose exact coordinates are up to its error
+    // outside of the rectangle may have their coordinates in it.  The
+    // tolerance covers that of InvertCoordCallbacks and the rounding of the
+    // fused rows.
+    const float grid_error = CoordGrid.spacing ? CoordGrid.error : 0.0f;
+    std::vector<float> coords;
+    int edges [5];
+    const float x1 = xs + width - 1, y1 = ys + height - 1;
+    sample_border (xs - grid_error, ys - grid_error, x1 + grid_error, y1 + grid_error,
+                   coords, edges);
+    if (InvertCoordCallbacks (&coords [0], edges [4]) &&
+        border_region (coords, edges, 0.01f, region))
+    {
+        // Whole pixels of the image, like the search below
+        region [0] = std::max (floorf (region [0]), 0.0f);
+        region [1] = std::max (floorf (region [1]), 0.0f);
+        region [2] = std::min (ceilf (region [2]), float (Width));
+        region [3] = std::min (ceilf (region [3]), float (Height));
+        return region [0] <= region [2] && region [1] <= region [3];
+    }
+
+    // Some points of the border have no target or are out of reach of
+    // Newton's method, so every pixel of the image has to be checked
+    region [0] = region [1] = std::numeric_limits<float>::infinity ();
+    region [2] = region [3] = -std::numeric_limits<float>::infinity ();
+    const int image_width = int (Width) + 1, image_height = int (Height) + 1;
+    std::vector<float> row (size_t (image_width) * 2);
+    bool found = false;
+    for (int j = 0; j < image_height; j++)
+    {
+        ComputeGeometryDistortion (0.0f, j, image_width, 1, &row [0], &row [1], 2, row.size ());
+        for (int i = 0; i < image_width; i++)
+        {
+            const float x = row [i * 2], y = row [i * 2 + 1];
+            if (x >= xs && x <= x1 && y >= ys && y <= y1)
+            {
+                extend_region (region, i, j);
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+/*
+ * Replace points, given in pixel coordinates, by the pixels whose
+ * coordinates they are.  Newton's method runs on all points at once, with
+ * the Jacobian from forward differences, starting at the points themselves.
+ * Returns false if a point does not converge.
+ */
+bool lfModifier::InvertCoordCallbacks (float *coords, int count) const
+{
+    const float h = 0.5f;
+    std::vector<float> target (coords, coords + count * 2), probe (size_t (count) * 6);
+    for (int step = 0; step < 20; step++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            float *p = &probe [i * 6];
+            p [0] = p [4] = coords [i * 2];
+            p [1] = p [3] = coords [i * 2 + 1];
+            p [2] = p [0] + h;
+            p [5] = p [1] + h;
+        }
+        ApplyCoordCallbacks (&probe [0], count * 3);
+
+        bool converged = true;
+        for (int i = 0; i < count; i++)
+        {
+            const float *p = &probe [i * 6];
+            const float rx = p [0] - target [i * 2], ry = p [1] - target [i * 2 + 1];
+            // NaN never converges
+            if (!(fabs (rx) < 0.01f && fabs (ry) < 0.01f))
+                converged = false;
+
+            const float dxdx = (p [2] - p [0]) / h, dxdy = (p [4] - p [0]) / h;
+            const float dydx = (p [3] - p [1]) / h, dydy = (p [5] - p [1]) / h;
+            const float det = dxdx * dydy - dxdy * dydx;
+            coords [i * 2] -= (dydy * rx - dxdy * ry) / det;
+            coords [i * 2 + 1] -= (dxdx * ry - dydx * rx) / det;
+        }
+        if (converged)
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Pixel i of a row or column which starts at pixel u has its mirror image
+ * about the centre (given in normalized coordinates) at pixel k - i.
+ * Returns k, or -1 if the mirror images miss the pixels, e.g. for an
+ * off-centre lens.
+ */
+static int mirror_index (float u, float center, float norm_scale)
+{
+    const double k = 2.0 * center / norm_scale - 2.0 * u;
+    const double rounded = floor (k + 0.5);
+    if (!(fabs (k - rounded) <= 1e-3 && rounded >= 0 &&
+          rounded < std::numeric_limits<int>::max ()))
+        return -1;
+    return int (rounded);
+}
+
+/*
+ * Copy a row which mirrors another one about the centre line, where the
+ * results are the same but for the Y coordinate, see lfMirrorCoordFunc.
+ */
+void lfModifier::MirrorCoordRow (const float *src_x, const float *src_y,
+                                 float *res_x, float *res_y, int count,
+                                 int stride, float flip)
+{
+    for (int i = 0; i < count * stride; i += stride)
+    {
+        res_x [i] = src_x [i];
+        res_y [i] = flip - src_y [i];
+    }
+}
+
+/*
+ * Reflect a part of a row about the centre: pixel i is the mirror image of
+ * the pixel i before the one at src, see lfMirrorCoordFunc.
+ */
+void lfModifier::ReflectCoordRow (const float *src_x, const float *src_y,
+                                  float *res_x, float *res_y, int count,
+                                  int stride, float flip)
+{
+    for (int i = 0; i < count * stride; i += stride)
+    {
+        res_x [i] = flip - src_x [-i];
+        res_y [i] = src_y [-i];
+    }
+}
+
+/*
+ * Common part of both variants of ApplyGeometryDistortion.  The coordinates
+ * of a pixel are stride floats apart, the rows row_stride floats.
+ */
+bool lfModifier::ComputeGeometryDistortion (
+    float xu, float yu, int width, int height,
+    float *res_x, float *res_y, int stride, size_t row_stride) const
+{
+    if (Callbacks->Coord.size() <= 0 || height <= 0)
+        return false; // nothing to do
+
+    PrepareCoordKernel ();
+    if (CoordGrid.spacing &&
+        InterpolateCoordGrid (xu, yu, width, height, res_x, res_y, stride, row_stride))
+        return true;
+
+    const bool symmetric = CoordKernel.symmetric;
+    const int kx = symmetric ? mirror_index (xu, CenterX, NormScale) : -1;
+    const int ky = symmetric ? mirror_index (yu, CenterY, NormScale) : -1;
+
+    // All callbacks work with normalized coordinates
+    xu = xu * NormScale - CenterX;
+    yu = yu * NormScale - CenterY;
+    const float step = NormScale;
+
+    if (CoordKernel.row)
+    {
+        // The whole chain in one pass, see PlanCoordCallbacks
+        const lfCoordKernel &kernel = CoordKernel;
+        const float x = xu * kernel.pre_scale;
+
+        // A symmetric chain gives the mirror image of its result for the
+        // mirror image of a point.  Rows of the block which mirror earlier
+        // rows within reach are copied, and in every other row, the pixels
+        // which mirror pixels on the other side of the centre are reflected.
+        const float flip_x = 2 * kernel.out_x, flip_y = 2 * kernel.out_y;
+        const int hi = std::min (width - 1, kx), mid = kx / 2;
+
+        for (int j = 0; j < height; j++, res_x += row_stride, res_y += row_stride)
+        {
+            const int mj = ky - j;
+            if (mj >= 0 && mj < j && size_t (j - mj) * width * 2 <= kernel.mirror_reach)
+            {
+                kernel.mirror_row (res_x - (j - mj) * row_stride, res_y - (j - mj) * row_stride,
+                                   res_x, res_y, width, stride, flip_y);
+                continue;
+            }
+
+            const float y = (yu + j * step) * kernel.pre_scale;
+            if (mid >= hi)
+            {
+                kernel.row ((void *) this, x, y, width, res_x, res_y, stride);
+                continue;
+            }
+
+            // Pixels mid + 1 ... hi are the mirror images of kx - hi ... mid
+            kernel.row ((void *) this, x, y, mid + 1, res_x, res_y, stride);
+            kernel.reflect_row (res_x + (kx - mid - 1) * stride, res_y + (kx - mid - 1) * stride,
+                                res_x + (mid + 1) * stride, res_y + (mid + 1) * stride,
+                                hi - mid, stride, flip_x);
+            if (hi + 1 < width)
+                kernel.row ((void *) this, x + (hi + 1) * kernel.dx, y, width - hi - 1,
+                            res_x + (hi + 1) * stride, res_y + (hi + 1) * stride, stride);
+        }
+        return true;
+    }
+
+    // Process every row in blocks which stay in the L1 cache while the
+    // callbacks walk over them one after another.  Interleaved output is
+    // its own block buffer, planes are split off in the final conversion.
+    // The SSE callbacks need the buffer aligned.
+    const int block_size = 256;
+    alignas (32) float buffer [block_size * 2];
+    const bool planar = stride != 2;
+    for (int j = 0; j < height; j++, res_x += row_stride, res_y += row_stride)
+    {
+        const float y = yu + j * step;
+        for (int block = 0; block < width; block += block_size)
+        {
+            const int count = std::min (block_size, width - block);
+            float *coords = planar ? buffer : res_x + block * 2;
+            int i;
+            for (i = 0; i < count; i++)
+            {
+                coords [i * 2] = xu + (block + i) * step;
+                coords [i * 2 + 1] = y;
+            }
+
+            for (auto cb : Callbacks->Coord)
+                cb->callback (cb, coords, count);
+
+            // Convert normalized coordinates back into natural coordinates
+            float *out_x = res_x + block * stride, *out_y = res_y + block * stride;
+            for (i = 0; i < count; i++)
+            {
+                out_x [i * stride] = (coords [i * 2] + CenterX) * NormUnScale;
+                out_y [i * stride] = (coords [i * 2 + 1] + CenterY) * NormUnScale;
+            }
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Run the coordinate callbacks on arbitrary points, given in pixel
+ * coordinates.
+ */
+void lfModifier::ApplyCoordCallbacks (float *coords, int count) const
+{
+    int i;
+    for (i = 0; i < count * 2; i += 2)
+    {
+        coords [i] = coords [i] * NormScale - CenterX;
+        coords [i + 1] = coords [i + 1] * NormScale - CenterY;
+    }
+
+    for (auto cb : Callbacks->Coord)
+        cb->callback (cb, coords, count);
+
+    for (i = 0; i < count * 2; i += 2)
+    {
+        coords [i] = (coords [i] + CenterX) * NormUnScale;
+        coords [i + 1] = (coords [i + 1] + CenterY) * NormUnScale;
+    }
 }
 
-bool lfModifier::ApplyGeometryDistortion (
-    float xu, float yu, int width, int height, float *res) const
+/*
+ * The same for points whose coordinates are stride floats apart, see
+ * lfModifyCoordRowFunc.
+ */
+void lfModifier::ApplyCoordCallbacks (float *res_x, float *res_y, int stride, int count) const
 {
-    if (CoordCallbacks.size() <= 0 || height <= 0)
-        return false; // nothing to do
-
-    // All callbacks work with normalized coordinates
-    xu = xu * NormScale - CenterX;
-    yu = yu * NormScale - CenterY;
+    if (stride == 2)
+    {
+        ApplyCoordCallbacks (res_x, count);
+        return;
+    }
 
-    for (float y = yu; height; y += NormScale, height--)
+    // Aligned for the SSE callbacks, see ComputeGeometryDistortion
+    const int block_size = 256;
+    alignas (32) float buffer [block_size * 2];
+    for (int block = 0; block < count; block += block_size)
     {
+        const int n = std::min (block_size, count - block);
+        float *x = res_x + block * stride, *y = res_y + block * stride;
         int i;
-        float x = xu;
-        for (i = 0; i < width; i++, x += NormScale)
+        for (i = 0; i < n; i++)
+        {
+            buffer [i * 2] = x [i * stride];
+            buffer [i * 2 + 1] = y [i * stride];
+        }
+        ApplyCoordCallbacks (buffer, n);
+        for (i = 0; i < n; i++)
+        {
+            x [i * stride] = buffer [i * 2];
+            y [i * stride] = buffer [i * 2 + 1];
+        }
+    }
+}
+
+float lfModifier::EnableGridInterpolation (float max_error)
+{
+    // Sample the exact chain while building the grid
+    lfCoordGrid &grid = CoordGrid;
+    grid.spacing = 0;
+    grid.nodes.clear ();
+    grid.exact.clear ();
+
+    if (Callbacks->Coord.size () == 0 || !(max_error > 0))
+        return -1.0f;
+
+    // Cells whose estimated error is too large are computed exactly.  Finer grids
+    // are only tried as long as that affects more than 1 % of the cells.
+    lfCoordGrid best;
+    best.spacing = 0;
+    double best_exact = 0.5;
+
+    for (int spacing = 64; spacing >= 8 && best_exact > 0.01; spacing /= 2)
+    {
+        // The grid covers the image, so its last nodes may lie outside
+        const int width = int (ceil (Width / spacing)) + 1;
+        const int height = int (ceil (Height / spacing)) + 1;
+
+        // Evaluate the chain at half the spacing.  The even points are the
+        // nodes, the others are the centres and edge midpoints of the cells,
+        // where the bilinear interpolation is checked.
+        const int lw = 2 * width - 1, lh = 2 * height - 1;
+        std::vector<float> lattice (size_t (2) * lw * lh);
+        for (int j = 0; j < lh; j++)
+            for (int i = 0; i < lw; i++)
+            {
+                lattice [2 * (size_t (j) * lw + i)] = i * spacing * 0.5f;
+                lattice [2 * (size_t (j) * lw + i) + 1] = j * spacing * 0.5f;
+            }
+        ApplyCoordCallbacks (&lattice [0], lw * lh);
+
+        auto at = [&] (int i, int j) { return &lattice [2 * (size_t (j) * lw + i)]; };
+
+        std::vector<unsigned char> exact (size_t (width - 1) * (height - 1));
+        size_t exact_count = 0;
+        double error = 0.0;
+        for (int cy = 0; cy < height - 1; cy++)
+            for (int cx = 0; cx < width - 1; cx++)
+            {
+                // Each sample lies halfway between two (or, for the centre,
+                // four) nodes, so the interpolation is their average.  The
+                // samples miss the higher order terms, so the error is taken
+                // with a margin of 25 %.  NaN fails the comparison, so such
+                // cells are computed exactly, as are cells which magnify by
+                // more than 64: they are close to a singularity which the
+                // samples may not see.
+                static const int samples [5][2] = { {1, 1}, {1, 0}, {0, 1}, {2, 1}, {1, 2} };
+                const float *corner = at (2 * cx, 2 * cy), *opposite = at (2 * cx + 2, 2 * cy + 2);
+                const double extent = std::max (absolute (opposite [0] - corner [0]),
+                                                absolute (opposite [1] - corner [1]));
+                double cell_error = 0.0;
+                bool ok = extent <= 64.0 * spacing;
+                for (int k = 0; k < 5 && ok; k++)
+                {
+                    const int i = samples [k][0], j = samples [k][1];
+                    const float *n0 = at (2 * cx + i - (i & 1), 2 * cy + j - (j & 1));
+                    const float *n1 = at (2 * cx + i + (i & 1), 2 * cy + j + (j & 1));
+                    const float *n2 = at (2 * cx + i - (i & 1), 2 * cy + j + (j & 1));
+                    const float *n3 = at (2 * cx + i + (i & 1), 2 * cy + j - (j & 1));
+                    const float *p = at (2 * cx + i, 2 * cy + j);
+                    const double dx = (n0 [0] + n1 [0] + n2 [0] + n3 [0]) / 4.0 - p [0];
+                    const double dy = (n0 [1] + n1 [1] + n2 [1] + n3 [1]) / 4.0 - p [1];
+                    const double sample_error = 1.25 * sqrt (dx * dx + dy * dy);
+                    ok = sample_error <= max_error;
+                    cell_error = std::max (cell_error, sample_error);
+                }
+                if (ok)
+                    error = std::max (error, cell_error);
+                else
+                {
+                    exact [size_t (cy) * (width - 1) + cx] = 1;
+                    exact_count++;
+                }
+            }
+
+        const double exact_fraction = double (exact_count) / exact.size ();
+        if (exact_fraction < best_exact)
         {
-            res [i * 2] = x;
-            res [i * 2 + 1] = y;
+            best_exact = exact_fraction;
+            best.spacing = spacing;
+            best.width = width;
+            best.height = height;
+            best.error = error;
+            best.nodes.resize (size_t (2) * width * height);
+            for (int j = 0; j < height; j++)
+                for (int i = 0; i < width; i++)
+                {
+                    best.nodes [2 * (size_t (j) * width + i)] = at (2 * i, 2 * j) [0];
+                    best.nodes [2 * (size_t (j) * width + i) + 1] = at (2 * i, 2 * j) [1];
+                }
+            best.exact.swap (exact);
         }
+    }
 
-        for (auto cb : CoordCallbacks)
-            cb->callback (cb, res, width);
+    // Not worth it if most of the image has to be computed exactly anyway
+    if (!best.spacing)
+        return -1.0f;
+
+    grid.width = best.width;
+    grid.height = best.height;
+    grid.error = best.error;
+    grid.max_error = max_error;
+    grid.nodes.swap (best.nodes);
+    grid.exact.swap (best.exact);
+    grid.spacing = best.spacing;
+    return grid.error;
+}
 
-        // Convert normalized coordinates back into natural coordinates
-        for (i = 0; i < width; i++)
+/*
+ * Interpolate a block of pixels on the grid built by EnableGridInterpolation.
+ * Returns false if the block reaches outside of the grid.
+ */
+bool lfModifier::InterpolateCoordGrid (
+    float xu, float yu, int width, int height,
+    float *res_x, float *res_y, int stride, size_t row_stride) const
+{
+    const lfCoordGrid &grid = CoordGrid;
+    const float max_x = float ((grid.width - 1) * grid.spacing);
+    const float max_y = float ((grid.height - 1) * grid.spacing);
+    if (!(xu >= 0 && yu >= 0 && xu + width - 1 <= max_x && yu + height - 1 <= max_y))
+        return false;
+
+    const float inv_spacing = 1.0f / grid.spacing;
+    for (int j = 0; j < height; j++, res_x += row_stride, res_y += row_stride)
+    {
+        const float y = yu + j;
+        const float gy = y * inv_spacing;
+        const int cy = std::min (int (gy), grid.height - 2);
+        const float fy = gy - cy;
+        const float *row0 = &grid.nodes [2 * size_t (cy) * grid.width];
+        const float *row1 = row0 + 2 * grid.width;
+        const unsigned char *exact = &grid.exact [size_t (cy) * (grid.width - 1)];
+
+        // Go through the row cell by cell.  Within a cell, the interpolated
+        // coordinates are linear in x.  Pixels in cells without a valid
+        // interpolation are collected into runs and sent through the
+        // callbacks in one go.
+        int run = -1;
+        for (int i = 0; i < width; )
         {
-            res [0] = (res [0] + CenterX) * NormUnScale;
-            res [1] = (res [1] + CenterY) * NormUnScale;
-            res += 2;
+            const float x = xu + i;
+            const int cx = std::min (int (x * inv_spacing), grid.width - 2);
+            int count = width - i;
+            if (cx < grid.width - 2)
+                count = std::min (count, std::max (1, int (ceil ((cx + 1) * grid.spacing - x))));
+            float *out_x = res_x + i * stride, *out_y = res_y + i * stride;
+
+            if (exact [cx])
+            {
+                for (int k = 0; k < count; k++)
+                {
+                    out_x [k * stride] = x + k;
+                    out_y [k * stride] = y;
+                }
+                if (run < 0)
+                    run = i;
+            }
+            else
+            {
+                if (run >= 0)
+                {
+                    ApplyCoordCallbacks (res_x + run * stride, res_y + run * stride,
+                                         stride, i - run);
+                    run = -1;
+                }
+
+                const float *n0 = row0 + 2 * cx, *n1 = row1 + 2 * cx;
+                const float left_x = n0 [0] + (n1 [0] - n0 [0]) * fy;
+                const float left_y = n0 [1] + (n1 [1] - n0 [1]) * fy;
+                const float step_x = (n0 [2] + (n1 [2] - n0 [2]) * fy - left_x) * inv_spacing;
+                const float step_y = (n0 [3] + (n1 [3] - n0 [3]) * fy - left_y) * inv_spacing;
+                const float offset = x - cx * grid.spacing;
+                for (int k = 0; k < count; k++)
+                {
+                    out_x [k * stride] = left_x + (offset + k) * step_x;
+                    out_y [k * stride] = left_y + (offset + k) * step_y;
+                }
+            }
+            i += count;
         }
+        if (run >= 0)
+            ApplyCoordCallbacks (res_x + run * stride, res_y + run * stride,
+                                 stride, width - run);
     }
 
     return true;
@@ -562,7 +2483,26 @@ void lfModifier::ModifyCoord_UnDist_Poly3 (void *data, float *iocoord, int count
     lfCoordDistCallbackData* cddata = (lfCoordDistCallbackData*) data;
 
     // See "Note about PT-based distortion models" at the top of this file.
-    const float inv_k1_ = 1.0 / cddata->terms[0];
+    //
+    // Rd = k1_ * Ru^3 + Ru is solved in closed form.  With
+    //
+    //     Rd0 = 2/3 * sqrt (1 / (3 * |k1_|)),  s = Rd / Rd0,  Ru = Rd0 * g
+    //
+    // the cubic becomes sign(k1_) * 4/27 * g^3 + g - s = 0, which no longer
+    // depends on the lens.  For k1_ < 0, Rd0 is the largest distorted radius
+    // that has a solution at all, and the root continuous with Ru = Rd is
+    //
+    //     g = 3 * sin (asin (s) / 3)
+    //
+    // For k1_ > 0 there is exactly one real root.  Cardano's formula
+    // A + B with A^3 - B^3 = 27/4 * s, A * B = 9/4 is rearranged to
+    //
+    //     g = 27/4 * s / (A^2 + 9/4 + (9/4)^2 / A^2)
+    //
+    // to avoid the cancellation in A + B for small radii.
+    const double k1_ = cddata->terms [0];
+    const double rd0 = 2.0 / 3.0 * sqrt (1.0 / (3.0 * absolute (k1_)));
+    const double inv_rd0 = 1.0 / rd0;
 
     for (float *end = iocoord + count * 2; iocoord < end; iocoord += 2)
     {
@@ -572,43 +2512,28 @@ void lfModifier::ModifyCoord_UnDist_Poly3 (void *data, float *iocoord, int count
         if (rd == 0.0)
             continue;
 
-        float rd_div_k1_ = rd * inv_k1_;
-
-        // Use Newton's method to avoid dealing with complex numbers
-        // When carefully tuned this works almost as fast as Cardano's
-        // method (and we don't use complex numbers in it, which is
-        // required for a full solution!)
-        //
-        // Original function: Rd = k1_ * Ru^3 + Ru
-        // Target function:   k1_ * Ru^3 + Ru - Rd = 0
-        // Divide by k1_:     Ru^3 + Ru/k1_ - Rd/k1_ = 0
-        // Derivative:        3 * Ru^2 + 1/k1_
-        double ru = rd;
-        for (int step = 0; ; step++)
+        const double s = rd * inv_rd0;
+        double g;
+        if (k1_ < 0)
         {
-            double fru = ru * ru * ru + ru * inv_k1_ - rd_div_k1_;
-            if (fru >= -NEWTON_EPS && fru < NEWTON_EPS)
-                break;
-            if (step > 5)
+            if (!(s <= 1.0))
             {
-                // Does not converge, no real solution in this area?
+                // No real solution in this area
                 iocoord [0] = iocoord [1] = std::numeric_limits<double>::quiet_NaN();
-                goto next_pixel;
+                continue;
             }
-
-            ru -= fru / (3 * ru * ru + inv_k1_);
+            g = 3.0 * sin (asin (s) / 3.0);
         }
-        if (ru < 0.0) {
-            iocoord [0] = iocoord [1] = std::numeric_limits<double>::quiet_NaN();
-            continue; // Negative radius does not make sense at all
+        else
+        {
+            const double q = 27.0 / 8.0 * s;
+            const double a2 = pow (q + sqrt (q * q + 729.0 / 64.0), 2.0 / 3.0);
+            g = 2 * q / (a2 + 9.0 / 4.0 + 81.0 / 16.0 / a2);
         }
 
-        ru /= rd;
+        const double ru = g * rd0 / rd;
         iocoord [0] = x * ru;
         iocoord [1] = y * ru;
-
-    next_pixel:
-        ;
     }
 }
 
@@ -733,6 +2658,34 @@ void lfModifier::ModifyCoord_UnDist_PTLens (void *data, float *iocoord, int coun
     }
 }
 
+void lfModifier::ModifyCoord_UnDist_Fit (void *data, float *iocoord, int count)
+{
+    lfCoordDistFitCallbackData* cddata = (lfCoordDistFitCallbackData*) data;
+
+    // Ru/Rd is a Chebyshev series in t = 2 * Rd / max_rd - 1, see
+    // AddCoordDistFitCallback.
+    const float max_rd = cddata->max_rd;
+    const float t_scale = 2.0f / max_rd;
+
+    for (float *end = iocoord + count * 2; iocoord < end; iocoord += 2)
+    {
+        const float x = iocoord [0];
+        const float y = iocoord [1];
+        const float rd = sqrtf (x * x + y * y);
+        if (!(rd <= max_rd))
+        {
+            // Beyond the fitted range
+            cddata->newton (data, iocoord, 1);
+            continue;
+        }
+
+        const float ru = chebyshev_series (cddata->coeffs, cddata->coeff_count,
+                                           rd * t_scale - 1.0f);
+        iocoord [0] = x * ru;
+        iocoord [1] = y * ru;
+    }
+}
+
 void lfModifier::ModifyCoord_Dist_PTLens (void *data, float *iocoord, int count)
 {
     lfCoordDistCallbackData* cddata = (lfCoordDistCallbackData*) data;
@@ -756,6 +2709,73 @@ void lfModifier::ModifyCoord_Dist_PTLens (void *data, float *iocoord, int count)
     }
 }
 
+void lfModifier::ModifyCoord_UnDist_ACM (void *data, float *iocoord, int count)
+{
+    lfCoordACMCallbackData* cddata = (lfCoordACMCallbackData*) data;
+
+    const double k1 = cddata->terms [0];
+    const double k2 = cddata->terms [1];
+    const double k3 = cddata->terms [2];
+    const double k4 = cddata->terms [3];
+    const double k5 = cddata->terms [4];
+    unsigned long unconverged = 0;
+
+    for (float *end = iocoord + count * 2; iocoord < end; iocoord += 2)
+    {
+        const double xd = iocoord [0];
+        const double yd = iocoord [1];
+
+        // Because of the tangential terms k4 and k5 the model is not radial,
+        // so we use Newton's method in two dimensions.  See
+        // ModifyCoord_Dist_ACM for the forward function.
+        double x = xd, y = yd;
+        for (int step = 0; ; step++)
+        {
+            const double ru2 = x * x + y * y;
+            const double radial = 1.0 + ru2 * (k1 + ru2 * (k2 + ru2 * k3));
+            const double common_term = radial + 2 * (k4 * y + k5 * x);
+            const double fx = x * common_term + k5 * ru2 - xd;
+            const double fy = y * common_term + k4 * ru2 - yd;
+            if (fx >= -NEWTON_EPS && fx < NEWTON_EPS &&
+                fy >= -NEWTON_EPS && fy < NEWTON_EPS)
+                break;
+            if (step > 5)
+            {
+                // Does not converge, no real solution in this area?
+                unconverged++;
+                goto next_pixel;
+            }
+
+            // Jacobian of the forward function
+            const double dradial = 2 * (k1 + ru2 * (2 * k2 + ru2 * 3 * k3));
+            const double dct_dx = dradial * x + 2 * k5;
+            const double dct_dy = dradial * y + 2 * k4;
+            const double j11 = common_term + x * dct_dx + 2 * k5 * x;
+            const double j12 = x * dct_dy + 2 * k5 * y;
+            const double j21 = y * dct_dx + 2 * k4 * x;
+            const double j22 = common_term + y * dct_dy + 2 * k4 * y;
+            const double det = j11 * j22 - j12 * j21;
+            if (det == 0.0)
+            {
+                unconverged++;
+                goto next_pixel;
+            }
+
+            x -= (j22 * fx - j12 * fy) / det;
+            y -= (j11 * fy - j21 * fx) / det;
+        }
+
+        iocoord [0] = x;
+        iocoord [1] = y;
+
+    next_pixel:
+        ;
+    }
+
+    if (unconverged)
+        cddata->chains->unconverged.fetch_add (unconverged, std::memory_order_relaxed);
+}
+
 void lfModifier::ModifyCoord_Dist_ACM (void *data, float *iocoord, int count)
 {
     lfCoordDistCallbackData* cddata = (lfCoordDistCallbackData*) data;
@@ -1060,8 +3080,6 @@ void lfModifier::ModifyCoord_Geom_ERect_Orthographic (void *data, float *iocoord
      }
 }
 
-#define EPSLN   1.0e-10
-
 void lfModifier::ModifyCoord_Geom_Stereographic_ERect (void *data, float *iocoord, int count)
 {
     (void)data;
@@ -1161,9 +3179,6 @@ void lfModifier::ModifyCoord_Geom_ERect_Equisolid (void *data, float *iocoord, i
     };
 }
 
-#define THOBY_K1_PARM 1.47F
-#define THOBY_K2_PARM 0.713F
-
 void lfModifier::ModifyCoord_Geom_Thoby_ERect (void *data, float *iocoord, int count)
 {
     (void)data;
@@ -1225,6 +3240,181 @@ void lfModifier::ModifyCoord_Geom_ERect_Thoby (void *data, float *iocoord, int c
     };
 }
 
+/*
+ * Direct conversions between the rectilinear and the fisheye-like
+ * projections.  They are the same as going via the equirectangular
+ * projection, but only change the distance from the centre: with
+ * theta the angle to the optical axis, a rectilinear radius r = tan (theta)
+ * gives cos (theta) = 1 / sqrt (1 + r^2).  Like ModifyCoord_Geom_FishEye_Rect,
+ * angles of pi/2 or more have no rectilinear counterpart and end up "at
+ * infinity".
+ */
+
+void lfModifier::ModifyCoord_Geom_Rect_Orthographic (void *data, float *iocoord, int count)
+{
+    (void)data;
+    for (float *end = iocoord + count * 2; iocoord < end; iocoord += 2)
+    {
+        float x = iocoord [0];
+        float y = iocoord [1];
+
+        // r' = sin (theta)
+        double k = 1.0 / sqrt (1.0 + x * x + y * y);
+
+        iocoord [0] = k * x;
+        iocoord [1] = k * y;
+    }
+}
+
+void lfModifier::ModifyCoord_Geom_Orthographic_Rect (void *data, float *iocoord, int count)
+{
+    (void)data;
+    for (float *end = iocoord + count * 2; iocoord < end; iocoord += 2)
+    {
+        float x = iocoord [0];
+        float y = iocoord [1];
+
+        double r2 = x * x + y * y;
+        double k;
+
+        if (r2 >= 1.0)
+            k = 1.6e16F;
+        else
+            k = 1.0 / sqrt (1.0 - r2);
+
+        iocoord [0] = k * x;
+        iocoord [1] = k * y;
+    }
+}
+
+void lfModifier::ModifyCoord_Geom_Rect_Stereographic (void *data, float *iocoord, int count)
+{
+    (void)data;
+    for (float *end = iocoord + count * 2; iocoord < end; iocoord += 2)
+    {
+        float x = iocoord [0];
+        float y = iocoord [1];
+
+        // r' = 2 tan (theta / 2) = 2 sin (theta) / (1 + cos (theta))
+        double c = 1.0 / sqrt (1.0 + x * x + y * y);
+        double k = 2.0 * c / (1.0 + c);
+
+        iocoord [0] = k * x;
+        iocoord [1] = k * y;
+    }
+}
+
+void lfModifier::ModifyCoord_Geom_Stereographic_Rect (void *data, float *iocoord, int count)
+{
+    (void)data;
+    for (float *end = iocoord + count * 2; iocoord < end; iocoord += 2)
+    {
+        float x = iocoord [0];
+        float y = iocoord [1];
+
+        // tan (2 atan (r / 2)) = r / (1 - r^2 / 4)
+        double q = 1.0 - (x * x + y * y) / 4.0;
+        double k;
+
+        if (q <= 0.0)
+            k = 1.6e16F;
+        else
+            k = 1.0 / q;
+
+        iocoord [0] = k * x;
+        iocoord [1] = k * y;
+    }
+}
+
+void lfModifier::ModifyCoord_Geom_Rect_Equisolid (void *data, float *iocoord, int count)
+{
+    (void)data;
+    for (float *end = iocoord + count * 2; iocoord < end; iocoord += 2)
+    {
+        float x = iocoord [0];
+        float y = iocoord [1];
+
+        // r' = 2 sin (theta / 2) = sin (theta) * sqrt (2 / (1 + cos (theta)))
+        double c = 1.0 / sqrt (1.0 + x * x + y * y);
+        double k = c * sqrt (2.0 / (1.0 + c));
+
+        iocoord [0] = k * x;
+        iocoord [1] = k * y;
+    }
+}
+
+void lfModifier::ModifyCoord_Geom_Equisolid_Rect (void *data, float *iocoord, int count)
+{
+    (void)data;
+    for (float *end = iocoord + count * 2; iocoord < end; iocoord += 2)
+    {
+        float x = iocoord [0];
+        float y = iocoord [1];
+
+        // With theta = 2 asin (r / 2): tan (theta) = r sqrt (1 - r^2 / 4) / (1 - r^2 / 2)
+        double r2 = x * x + y * y;
+        double k;
+
+        if (r2 >= 2.0)
+            k = 1.6e16F;
+        else
+            k = sqrt (1.0 - r2 / 4.0) / (1.0 - r2 / 2.0);
+
+        iocoord [0] = k * x;
+        iocoord [1] = k * y;
+    }
+}
+
+void lfModifier::ModifyCoord_Geom_Rect_Thoby (void *data, float *iocoord, int count)
+{
+    (void)data;
+    for (float *end = iocoord + count * 2; iocoord < end; iocoord += 2)
+    {
+        float x = iocoord [0];
+        float y = iocoord [1];
+
+        double r = sqrt (x * x + y * y);
+        double k;
+
+        if (r == 0.0)
+            k = THOBY_K1_PARM * THOBY_K2_PARM;
+        else
+            k = THOBY_K1_PARM * sin (THOBY_K2_PARM * atan (r)) / r;
+
+        iocoord [0] = k * x;
+        iocoord [1] = k * y;
+    }
+}
+
+void lfModifier::ModifyCoord_Geom_Thoby_Rect (void *data, float *iocoord, int count)
+{
+    (void)data;
+    for (float *end = iocoord + count * 2; iocoord < end; iocoord += 2)
+    {
+        float x = iocoord [0];
+        float y = iocoord [1];
+
+        double r = sqrt (x * x + y * y);
+        double k;
+
+        if (r == 0.0)
+            k = 1.0 / (THOBY_K1_PARM * THOBY_K2_PARM);
+        else if (r > THOBY_K1_PARM)
+            k = 1.6e16F;
+        else
+        {
+            double theta = asin (r / THOBY_K1_PARM) / THOBY_K2_PARM;
+            if (theta >= M_PI / 2.0)
+                k = 1.6e16F;
+            else
+                k = tan (theta) / r;
+        }
+
+        iocoord [0] = k * x;
+        iocoord [1] = k * y;
+    }
+}
+
 //---------------------------// The C interface //---------------------------//
 
 float lf_modifier_get_auto_scale (lfModifier *modifier, cbool reverse)
@@ -1232,12 +3422,82 @@ float lf_modifier_get_auto_scale (lfModifier *modifier, cbool reverse)
     return modifier->GetAutoScale (reverse);
 }
 
+float lf_modifier_get_distortion_fit_residual (lfModifier *modifier)
+{
+    return modifier->GetDistortionFitResidual ();
+}
+
+unsigned long lf_modifier_get_unconverged_count (lfModifier *modifier)
+{
+    return modifier->GetUnconvergedCount ();
+}
+
 cbool lf_modifier_apply_geometry_distortion (
     lfModifier *modifier, float xu, float yu, int width, int height, float *res)
 {
     return modifier->ApplyGeometryDistortion (xu, yu, width, height, res);
 }
 
+cbool lf_modifier_apply_geometry_distortion_planar (
+    lfModifier *modifier, float xu, float yu, int width, int height,
+    float *res_x, float *res_y, int row_stride)
+{
+    return modifier->ApplyGeometryDistortion (xu, yu, width, height,
+                                              res_x, res_y, row_stride);
+}
+
+cbool lf_modifier_apply_geometry_distortion_jacobian (
+    lfModifier *modifier, float xu, float yu, int width, int height,
+    float *res, float *jacobian)
+{
+    return modifier->ApplyGeometryDistortionJacobian (xu, yu, width, height,
+                                                      res, jacobian);
+}
+
+cbool lf_modifier_apply_geometry_distortion_mask (
+    lfModifier *modifier, float xu, float yu, int width, int height,
+    float *res, lf_u32 *mask)
+{
+    return modifier->ApplyGeometryDistortionMask (xu, yu, width, height, res, mask);
+}
+
+cbool lf_modifier_get_source_region (
+    lfModifier *modifier, float xu, float yu, int width, int height, float *region)
+{
+    return modifier->GetSourceRegion (xu, yu, width, height, region);
+}
+
+cbool lf_modifier_get_target_region (
+    lfModifier *modifier, float xs, float ys, int width, int height, float *region)
+{
+    return modifier->GetTargetRegion (xs, ys, width, height, region);
+}
+
+void lf_modifier_get_auto_scale_cache_stats (unsigned long *hits, unsigned long *misses)
+{
+    lfModifier::GetAutoScaleCacheStats (hits, misses);
+}
+
+void lf_modifier_clear_auto_scale_cache ()
+{
+    lfModifier::ClearAutoScaleCache ();
+}
+
+cbool lf_modifier_get_valid_outline (lfModifier *modifier, int count, float *outline)
+{
+    return modifier->GetValidOutline (count, outline);
+}
+
+cbool lf_modifier_get_auto_crop (lfModifier *modifier, float aspect, float *crop)
+{
+    return modifier->GetAutoCrop (aspect, crop);
+}
+
+float lf_modifier_enable_grid_interpolation (lfModifier *modifier, float max_error)
+{
+    return modifier->EnableGridInterpolation (max_error);
+}
+
 int lf_modifier_enable_distortion_correction (lfModifier *modifier)
 {
     return modifier->EnableDistortionCorrection();
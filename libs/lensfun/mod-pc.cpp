@@ -60,6 +60,7 @@
 #include <vector>
 #include <numeric>
 #include <stdexcept>
+#include <cstring>
 #include "windows/mathconstants.h"
 
 using std::acos;
@@ -569,16 +570,13 @@ matrix generate_rotation_matrix (double rho_1, double delta, double rho_2, doubl
     return M;
 }
 
-int lfModifier::EnablePerspectiveCorrection (float *x, float *y, int count, float d)
+bool lfModifier::SolvePerspectiveCorrection (float *x, float *y, int count,
+                                             lfPerspectiveSolution *solution) const
 {
     const int number_of_control_points = count;
 
     if (number_of_control_points < 4 || number_of_control_points > 8)
-        return EnabledMods;
-    if (d < -1)
-        d = -1;
-    if (d > 1)
-        d = 1;
+        return false;
     dvector x_, y_;
     for (int i = 0; i < number_of_control_points; i++)
     {
@@ -586,20 +584,39 @@ int lfModifier::EnablePerspectiveCorrection (float *x, float *y, int count, floa
         y_.push_back (y [i] * NormScale - CenterY);
     }
 
-
-    double rho, delta, rho_h, alpha, center_of_control_points_x,
-        center_of_control_points_y, z;
     double f_normalized = 1.0;
     try
     {
-        calculate_angles (x_, y_, f_normalized, rho, delta, rho_h, alpha,
-                          center_of_control_points_x, center_of_control_points_y);
+        calculate_angles (x_, y_, f_normalized, solution->Rho, solution->Delta,
+                          solution->RhoH, solution->Alpha,
+                          solution->CenterX, solution->CenterY);
     }
     catch (svd_no_convergence &e)
     {
         g_warning ("[Lensfun] %s", e.what());
-        return EnabledMods;
+        return false;
     }
+    solution->Focal = f_normalized;
+    return true;
+}
+
+/*
+ * Everything that depends on d, see the comment at the top.  Returns false if
+ * the new image centre is not visible.
+ */
+bool lfModifier::PerspectiveCallbackData (const lfPerspectiveSolution &solution, float d,
+                                          lfCoordPerspCallbackData *cd) const
+{
+    if (d < -1)
+        d = -1;
+    if (d > 1)
+        d = 1;
+
+    const double rho = solution.Rho, delta = solution.Delta, rho_h = solution.RhoH,
+        alpha = solution.Alpha, f_normalized = solution.Focal,
+        center_of_control_points_x = solution.CenterX,
+        center_of_control_points_y = solution.CenterY;
+    double z;
 
     // Transform center point to get shift
     z = rotate_rho_delta_rho_h (rho, delta, rho_h, 0, 0, f_normalized) [2];
@@ -636,7 +653,7 @@ int lfModifier::EnablePerspectiveCorrection (float *x, float *y, int count, floa
     }
     }
     if (center_coords [2] <= 0)
-        return EnabledMods;
+        return false;
     // This is the mapping scale in the image center
     double mapping_scale = f_normalized / center_coords [2];
 
@@ -665,8 +682,6 @@ int lfModifier::EnablePerspectiveCorrection (float *x, float *y, int count, floa
         Delta_b = - sin (alpha) * Delta_a_old + cos (alpha) * Delta_b;
     }
 
-    lfCoordPerspCallbackData* cd = new lfCoordPerspCallbackData;
-
     if (!Reverse) {
         cd->callback = ModifyCoord_Perspective_Correction;
         cd->priority = 300;
@@ -702,8 +717,67 @@ int lfModifier::EnablePerspectiveCorrection (float *x, float *y, int count, floa
 
     cd->delta_a = Delta_a / mapping_scale;
     cd->delta_b = Delta_b / mapping_scale;
+    return true;
+}
+
+int lfModifier::EnablePerspectiveCorrection (float *x, float *y, int count, float d)
+{
+    lfPerspectiveSolution solution;
+    if (!SolvePerspectiveCorrection (x, y, count, &solution))
+        return EnabledMods;
+
+    lfCoordPerspCallbackData cd;
+    if (!PerspectiveCallbackData (solution, d, &cd))
+        return EnabledMods;
+    AddCoordCallback (cd);
+
+    EnabledMods |= LF_MODIFY_PERSPECTIVE;
+    return EnabledMods;
+}
+
+int lfModifier::EnablePerspectiveCorrection (const lfPerspectiveSolution *solution, float d)
+{
+    lfCoordPerspCallbackData data;
+    const bool valid = PerspectiveCallbackData (*solution, d, &data);
+
+    // The callback for a previous d is updated in place; its priority is the
+    // same, so the order of the chain does not change.  The chain cannot drop
+    // callbacks, so if d is not valid, it becomes the identity.
+    for (auto cb : Callbacks->Coord)
+    {
+        auto cd = dynamic_cast<lfCoordPerspCallbackData*> (cb);
+        if (cd)
+        {
+            if (valid)
+            {
+                memcpy (cd->A, data.A, sizeof (data.A));
+                cd->delta_a = data.delta_a;
+                cd->delta_b = data.delta_b;
+                EnabledMods |= LF_MODIFY_PERSPECTIVE;
+            }
+            else
+            {
+                for (int i = 0; i < 3; i++)
+                    for (int j = 0; j < 3; j++)
+                        cd->A [i][j] = i == j ? 1.0f : 0.0f;
+                cd->delta_a = cd->delta_b = 0.0f;
+                EnabledMods &= ~LF_MODIFY_PERSPECTIVE;
+            }
 
-    CoordCallbacks.insert(cd);
+            // Whatever was derived from the chain has to follow d
+            const float grid_error = CoordGrid.spacing ? CoordGrid.max_error : 0.0f;
+            PlanCoordCallbacks ();
+            UpdateAutoScale ();
+            if (grid_error > 0.0f)
+                EnableGridInterpolation (grid_error);
+            return EnabledMods;
+        }
+    }
+
+    if (!valid)
+        return EnabledMods;
+
+    AddCoordCallback (data);
 
     EnabledMods |= LF_MODIFY_PERSPECTIVE;
     return EnabledMods;
@@ -757,6 +831,59 @@ void lfModifier::ModifyCoord_Perspective_Distortion (void *data, float *iocoord,
     }
 }
 
+/*
+ * Along a row, the numerators and the denominator of both perspective
+ * callbacks are affine in x.  This sets them up for the fused kernel, see
+ * PlanCoordCallbacks: the result at pixel i is (x0 + i dx) / (z0 + i dz), and
+ * the same for y.  The conversion into pixel coordinates is folded into the
+ * numerators, which avoids the cancellation of adding it afterwards.
+ */
+void lfModifier::PerspectiveRow (const lfCoordKernel &kernel, float x, float y, lfPerspRow &row)
+{
+    const lfCoordPerspCallbackData* cddata = (const lfCoordPerspCallbackData*) kernel.stage;
+    const float (*A)[3] = cddata->A;
+    const bool correction = cddata->callback == ModifyCoord_Perspective_Correction;
+    const double scale = kernel.out_scale;
+
+    const double u = x + (correction ? cddata->delta_a : 0.0);
+    const double v = y + (correction ? cddata->delta_b : 0.0);
+    const double out_x = kernel.out_x - (correction ? 0.0 : cddata->delta_a * scale);
+    const double out_y = kernel.out_y - (correction ? 0.0 : cddata->delta_b * scale);
+    const double z0 = A [2][0] * u + A [2][1] * v + A [2][2];
+    const double dz = A [2][0] * kernel.dx;
+    row.x0 = (A [0][0] * u + A [0][1] * v + A [0][2]) * scale + out_x * z0;
+    row.dx = A [0][0] * kernel.dx * scale + out_x * dz;
+    row.y0 = (A [1][0] * u + A [1][1] * v + A [1][2]) * scale + out_y * z0;
+    row.dy = A [1][0] * kernel.dx * scale + out_y * dz;
+    row.z0 = z0;
+    row.dz = dz;
+    row.invalid_x = 1.6e16 * scale + kernel.out_x;
+    row.invalid_y = 1.6e16 * scale + kernel.out_y;
+}
+
+void lfModifier::ModifyCoordRow_Persp (void *data, float x, float y, int width,
+                                       float *res_x, float *res_y, int stride)
+{
+    lfPerspRow row;
+    PerspectiveRow (((const lfModifier *) data)->CoordKernel, x, y, row);
+
+    for (int i = 0; i < width; i++)
+    {
+        const double z = row.z0 + i * row.dz;
+        if (z > 0)
+        {
+            const double z_inv = 1.0 / z;
+            res_x [i * stride] = (row.x0 + i * row.dx) * z_inv;
+            res_y [i * stride] = (row.y0 + i * row.dy) * z_inv;
+        }
+        else
+        {
+            res_x [i * stride] = row.invalid_x;
+            res_y [i * stride] = row.invalid_y;
+        }
+    }
+}
+
 //---------------------------// The C interface //---------------------------//
 
 int lf_modifier_enable_perspective_correction (
@@ -764,3 +891,15 @@ int lf_modifier_enable_perspective_correction (
 {
     return modifier->EnablePerspectiveCorrection (x, y, count, d);
 }
+
+cbool lf_modifier_solve_perspective_correction (
+    lfModifier *modifier, float *x, float *y, int count, lfPerspectiveSolution *solution)
+{
+    return modifier->SolvePerspectiveCorrection (x, y, count, solution);
+}
+
+int lf_modifier_enable_perspective_solution (
+    lfModifier *modifier, const lfPerspectiveSolution *solution, float d)
+{
+    return modifier->EnablePerspectiveCorrection (solution, d);
+}
@@ -0,0 +1,293 @@
+/*
+    Image modifier implementation: AVX2/FMA TCA correction functions
+
+    These are 8-lane versions of the TCA callbacks in mod-subpix.cpp, which
+    are only registered if the CPU reports both AVX2 and FMA, see
+    _lf_cpu_has_avx2_fma().
+
+    The subpixel coordinates are processed right where they are, without
+    separating x and y: four pixels (R, G, B) are exactly three vectors, and
+    every lane gets the coefficients of its colour from a pattern vector.
+    The green lanes get coefficients which leave them untouched.  The other
+    coordinate of a point is always the neighbouring lane within the pair.
+    For the (X, Y) pairs of a single channel, all lanes get the coefficients
+    of this channel.
+*/
+
+#include "config.h"
+
+#ifdef VECTORIZATION_AVX2
+
+#include "lensfun.h"
+#include "lensfunprv.h"
+#include <immintrin.h>
+#include <math.h>
+
+/*
+ * Coefficients of three colours, laid out like the coordinates of four
+ * pixels in three vectors.
+ */
+struct subpix_pattern
+{
+    __m256 v [3];
+
+    subpix_pattern (float red, float green, float blue)
+    {
+        const float colour [3] = { red, green, blue };
+        float lanes [24];
+        for (int i = 0; i < 24; i++)
+            lanes [i] = colour [(i % 6) / 2];
+        for (int i = 0; i < 3; i++)
+            v [i] = _mm256_loadu_ps (lanes + i * 8);
+    }
+
+    /// Different coefficients for the x and y coordinates
+    subpix_pattern (const float x [3], const float y [3])
+    {
+        float lanes [24];
+        for (int i = 0; i < 24; i++)
+            lanes [i] = (i & 1 ? y : x) [(i % 6) / 2];
+        for (int i = 0; i < 3; i++)
+            v [i] = _mm256_loadu_ps (lanes + i * 8);
+    }
+};
+
+/*
+ * Coefficient k of a TCA model, times factor.  For (R, G, B) groups
+ * (channel < 0) the green lanes get the given value, otherwise all lanes get
+ * the coefficient of the channel.
+ */
+static subpix_pattern tca_coefficient (
+    const float *terms, int k, float green, int channel, float factor = 1.0f)
+{
+    if (channel < 0)
+        return subpix_pattern (factor * terms [2 * k], green, factor * terms [2 * k + 1]);
+    const float t = factor * terms [2 * k + (channel == 2)];
+    return subpix_pattern (t, t, t);
+}
+
+/// The same with coefficient kx for x and ky for y coordinates
+static subpix_pattern tca_coefficient (
+    const float *terms, int kx, int ky, int channel, float factor)
+{
+    const int c = channel == 2;
+    const float x [3] = { factor * terms [2 * kx], 0.0f, factor * terms [2 * kx + 1] };
+    const float y [3] = { factor * terms [2 * ky], 0.0f, factor * terms [2 * ky + 1] };
+    if (channel < 0)
+        return subpix_pattern (x, y);
+    const float cx [3] = { x [2 * c], x [2 * c], x [2 * c] };
+    const float cy [3] = { y [2 * c], y [2 * c], y [2 * c] };
+    return subpix_pattern (cx, cy);
+}
+
+/// The other coordinate of every point, i.e. x and y swapped
+static inline __m256 swap_xy (__m256 c)
+{
+    return _mm256_permute_ps (c, _MM_SHUFFLE (2, 3, 0, 1));
+}
+
+/// x^2 + y^2 of every point, in both of its lanes
+static inline __m256 radius2 (__m256 c)
+{
+    const __m256 c2 = _mm256_mul_ps (c, c);
+    return _mm256_add_ps (c2, swap_xy (c2));
+}
+
+/*
+ * Apply a kernel to all complete blocks of three vectors, i.e. four pixels
+ * or twelve points of a single channel.  Returns the position of the
+ * remaining floats.
+ */
+template<typename Kernel> static inline float *apply_subpix (
+    const Kernel &kernel, float *iocoord, int floats)
+{
+    for (float *end = iocoord + floats / 24 * 24; iocoord < end; iocoord += 24)
+        for (int i = 0; i < 3; i++)
+        {
+            __m256 c = _mm256_loadu_ps (iocoord + i * 8);
+            c = kernel (c, i);
+            _mm256_storeu_ps (iocoord + i * 8, c);
+        }
+    return iocoord;
+}
+
+struct TCA_Linear_AVX2
+{
+    subpix_pattern k;
+
+    TCA_Linear_AVX2 (const float *terms, int channel)
+        : k (tca_coefficient (terms, 0, 1.0f, channel)) {}
+
+    inline __m256 operator () (__m256 c, int i) const
+    {
+        return _mm256_mul_ps (c, k.v [i]);
+    }
+};
+
+struct TCA_Poly3_AVX2
+{
+    // Rd = Ru * (b * Ru^2 + c * Ru + v)
+    subpix_pattern v, c, b;
+    bool linear_c;
+
+    TCA_Poly3_AVX2 (const float *terms, int channel)
+        : v (tca_coefficient (terms, 0, 1.0f, channel)),
+          c (tca_coefficient (terms, 1, 0.0f, channel)),
+          b (tca_coefficient (terms, 2, 0.0f, channel)),
+          linear_c (terms [2] != 0.0f || terms [3] != 0.0f) {}
+
+    inline __m256 operator () (__m256 coord, int i) const
+    {
+        const __m256 ru2 = radius2 (coord);
+        __m256 poly2 = _mm256_fmadd_ps (b.v [i], ru2, v.v [i]);
+        // Avoid the square root for the common case c == 0
+        if (linear_c)
+            poly2 = _mm256_fmadd_ps (c.v [i], _mm256_sqrt_ps (ru2), poly2);
+        return _mm256_mul_ps (coord, poly2);
+    }
+};
+
+struct UnTCA_Poly3_AVX2
+{
+    // Newton's method like in ModifyCoord_UnTCA_Poly3, in lockstep for all
+    // lanes like undist_radial_newton () in mod-coord-avx2.cpp.  Points which
+    // did not converge, at rd == 0, or with a negative ru stay untouched.
+    subpix_pattern v, c, b, c_2, b_3;
+
+    UnTCA_Poly3_AVX2 (const float *terms, int channel)
+        : v (tca_coefficient (terms, 0, 1.0f, channel)),
+          c (tca_coefficient (terms, 1, 0.0f, channel)),
+          b (tca_coefficient (terms, 2, 0.0f, channel)),
+          c_2 (tca_coefficient (terms, 1, 0.0f, channel, 2.0f)),
+          b_3 (tca_coefficient (terms, 2, 0.0f, channel, 3.0f)) {}
+
+    inline __m256 operator () (__m256 coord, int i) const
+    {
+        const __m256 zero = _mm256_setzero_ps ();
+        const __m256 eps = _mm256_set1_ps (NEWTON_EPS);
+        const __m256 rd = _mm256_sqrt_ps (radius2 (coord));
+        __m256 ru = rd;
+        __m256 converged = zero;
+        for (int step = 0; step <= 6; step++)
+        {
+            // fru = b * Ru^3 + c * Ru^2 + v * Ru - Rd
+            __m256 fru = _mm256_fmadd_ps (_mm256_fmadd_ps (b.v [i], ru, c.v [i]), ru, v.v [i]);
+            fru = _mm256_fmsub_ps (fru, ru, rd);
+            converged = _mm256_or_ps (converged, _mm256_cmp_ps (
+                _mm256_andnot_ps (_mm256_set1_ps (-0.0f), fru), eps, _CMP_LT_OQ));
+            const __m256 dfru = _mm256_fmadd_ps (_mm256_fmadd_ps (b_3.v [i], ru, c_2.v [i]), ru, v.v [i]);
+            // Converged lanes keep their ru, like the scalar loop
+            ru = _mm256_sub_ps (ru, _mm256_andnot_ps (converged, _mm256_div_ps (fru, dfru)));
+            if (_mm256_movemask_ps (converged) == 0xff)
+                break;
+        }
+
+        __m256 valid = _mm256_and_ps (converged, _mm256_cmp_ps (ru, zero, _CMP_GT_OQ));
+        valid = _mm256_andnot_ps (_mm256_cmp_ps (rd, zero, _CMP_EQ_OQ), valid);
+        return _mm256_blendv_ps (coord, _mm256_mul_ps (coord, _mm256_div_ps (ru, rd)), valid);
+    }
+};
+
+struct TCA_ACM_AVX2
+{
+    // See ModifyCoord_TCA_ACM.  x * common_term + alpha5 * ru2 and
+    // y * common_term + alpha4 * ru2 are the same with the coefficients of
+    // the own and of the other coordinate swapped.
+    subpix_pattern k0, k1, k2, k3, own_2, other_2, own;
+
+    TCA_ACM_AVX2 (const float *terms, int channel)
+        : k0 (tca_coefficient (terms, 0, 1.0f, channel)),
+          k1 (tca_coefficient (terms, 1, 0.0f, channel)),
+          k2 (tca_coefficient (terms, 2, 0.0f, channel)),
+          k3 (tca_coefficient (terms, 3, 0.0f, channel)),
+          own_2 (tca_coefficient (terms, 5, 4, channel, 2.0f)),
+          other_2 (tca_coefficient (terms, 4, 5, channel, 2.0f)),
+          own (tca_coefficient (terms, 5, 4, channel, 1.0f)) {}
+
+    inline __m256 operator () (__m256 coord, int i) const
+    {
+        const __m256 ru2 = radius2 (coord);
+        __m256 common_term = _mm256_fmadd_ps (_mm256_fmadd_ps (k3.v [i], ru2, k2.v [i]), ru2, k1.v [i]);
+        common_term = _mm256_fmadd_ps (common_term, ru2, _mm256_set1_ps (1.0f));
+        common_term = _mm256_fmadd_ps (own_2.v [i], coord, common_term);
+        common_term = _mm256_fmadd_ps (other_2.v [i], swap_xy (coord), common_term);
+        return _mm256_mul_ps (k0.v [i], _mm256_fmadd_ps (coord, common_term,
+                                                         _mm256_mul_ps (own.v [i], ru2)));
+    }
+};
+
+//------------------------------------------------------------------------//
+
+void lfModifier::ModifyCoord_TCA_Linear_AVX2 (void *data, float *iocoord, int count)
+{
+    lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+    iocoord = apply_subpix (TCA_Linear_AVX2 (cddata->terms, -1), iocoord, count * 6);
+    if (count % 4)
+        ModifyCoord_TCA_Linear (data, iocoord, count % 4);
+}
+
+void lfModifier::ModifyCoord_TCA_Linear_Channel_AVX2 (void *data, int channel, float *iocoord, int count)
+{
+    if (channel == 1)
+        return;
+    lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+    iocoord = apply_subpix (TCA_Linear_AVX2 (cddata->terms, channel), iocoord, count * 2);
+    if (count % 12)
+        ModifyCoord_TCA_Linear_Channel (data, channel, iocoord, count % 12);
+}
+
+void lfModifier::ModifyCoord_TCA_Poly3_AVX2 (void *data, float *iocoord, int count)
+{
+    lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+    iocoord = apply_subpix (TCA_Poly3_AVX2 (cddata->terms, -1), iocoord, count * 6);
+    if (count % 4)
+        ModifyCoord_TCA_Poly3 (data, iocoord, count % 4);
+}
+
+void lfModifier::ModifyCoord_TCA_Poly3_Channel_AVX2 (void *data, int channel, float *iocoord, int count)
+{
+    if (channel == 1)
+        return;
+    lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+    iocoord = apply_subpix (TCA_Poly3_AVX2 (cddata->terms, channel), iocoord, count * 2);
+    if (count % 12)
+        ModifyCoord_TCA_Poly3_Channel (data, channel, iocoord, count % 12);
+}
+
+void lfModifier::ModifyCoord_UnTCA_Poly3_AVX2 (void *data, float *iocoord, int count)
+{
+    lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+    iocoord = apply_subpix (UnTCA_Poly3_AVX2 (cddata->terms, -1), iocoord, count * 6);
+    if (count % 4)
+        ModifyCoord_UnTCA_Poly3 (data, iocoord, count % 4);
+}
+
+void lfModifier::ModifyCoord_UnTCA_Poly3_Channel_AVX2 (void *data, int channel, float *iocoord, int count)
+{
+    if (channel == 1)
+        return;
+    lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+    iocoord = apply_subpix (UnTCA_Poly3_AVX2 (cddata->terms, channel), iocoord, count * 2);
+    if (count % 12)
+        ModifyCoord_UnTCA_Poly3_Channel (data, channel, iocoord, count % 12);
+}
+
+void lfModifier::ModifyCoord_TCA_ACM_AVX2 (void *data, float *iocoord, int count)
+{
+    lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+    iocoord = apply_subpix (TCA_ACM_AVX2 (cddata->terms, -1), iocoord, count * 6);
+    if (count % 4)
+        ModifyCoord_TCA_ACM (data, iocoord, count % 4);
+}
+
+void lfModifier::ModifyCoord_TCA_ACM_Channel_AVX2 (void *data, int channel, float *iocoord, int count)
+{
+    if (channel == 1)
+        return;
+    lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+    iocoord = apply_subpix (TCA_ACM_AVX2 (cddata->terms, channel), iocoord, count * 2);
+    if (count % 12)
+        ModifyCoord_TCA_ACM_Channel (data, channel, iocoord, count % 12);
+}
+
+#endif
@@ -0,0 +1,335 @@
+/*
+    Image modifier implementation: SSE TCA correction functions
+
+    Two pixels (R, G, B) are exactly three vectors, so the subpixel
+    coordinates are processed in place.  Every lane gets the coefficients of
+    its colour from a pattern vector; the green lanes get coefficients which
+    leave them untouched.  Six (X, Y) pairs of a single channel are three
+    vectors, too, with the coefficients of this channel in all lanes.  See
+    also mod-subpix-avx2.cpp.
+*/
+
+#include "config.h"
+
+#ifdef VECTORIZATION_SSE
+
+#include "lensfun.h"
+#include "lensfunprv.h"
+#include <xmmintrin.h>
+
+#if defined (_MSC_VER)
+typedef size_t uintptr_t;
+#else
+typedef __SIZE_TYPE__ uintptr_t;
+#endif
+
+/*
+ * Coefficients of three colours, laid out like the coordinates of two
+ * pixels in three vectors.  x and y may have different coefficients.
+ */
+struct subpix_pattern_sse
+{
+  __m128 v [3];
+
+  subpix_pattern_sse (const float x [3], const float y [3])
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      float lanes [4];
+      for (int j = 0; j < 4; j++)
+      {
+        int l = i * 4 + j;
+        lanes [j] = (l & 1 ? y : x) [(l % 6) / 2];
+      }
+      v [i] = _mm_loadu_ps (lanes);
+    }
+  }
+};
+
+/*
+ * Coefficient k of a TCA model, times factor.  For (R, G, B) groups
+ * (channel < 0) the green lanes get the given value, otherwise all lanes get
+ * the coefficient of the channel.
+ */
+static subpix_pattern_sse pattern_sse (
+  const float *terms, int k, float green, int channel, float factor = 1.0f)
+{
+  float c [3] = { factor * terms [2 * k], green, factor * terms [2 * k + 1] };
+  if (channel >= 0)
+    c [0] = c [1] = c [2] = c [2 * (channel == 2)];
+  return subpix_pattern_sse (c, c);
+}
+
+/// The other coordinate of every point, i.e. x and y swapped
+static inline __m128 swap_xy (__m128 c)
+{
+  return _mm_shuffle_ps (c, c, _MM_SHUFFLE (2, 3, 0, 1));
+}
+
+/// x^2 + y^2 of every point, in both of its lanes
+static inline __m128 radius2 (__m128 c)
+{
+  __m128 c2 = _mm_mul_ps (c, c);
+  return _mm_add_ps (c2, swap_xy (c2));
+}
+
+/*
+ * The kernels process blocks of three vectors, either of two (R, G, B)
+ * groups (channel < 0) or of six (X, Y) pairs of the given channel.
+ */
+static void tca_linear_sse (const float *t, int channel, float *iocoord, int blocks)
+{
+  subpix_pattern_sse k = pattern_sse (t, 0, 1.0f, channel);
+
+  for (int i = 0; i < blocks; i++)
+    for (int j = 0; j < 3; j++)
+    {
+      float *p = &iocoord [12 * i + 4 * j];
+      _mm_store_ps (p, _mm_mul_ps (_mm_load_ps (p), k.v [j]));
+    }
+}
+
+static void tca_poly3_sse (const float *t, int channel, float *iocoord, int blocks)
+{
+  subpix_pattern_sse v = pattern_sse (t, 0, 1.0f, channel);
+  subpix_pattern_sse c = pattern_sse (t, 1, 0.0f, channel);
+  subpix_pattern_sse b = pattern_sse (t, 2, 0.0f, channel);
+  // Avoid the square root for the common case c == 0
+  bool linear_c = (t [2] != 0.0f || t [3] != 0.0f);
+
+  for (int i = 0; i < blocks; i++)
+    for (int j = 0; j < 3; j++)
+    {
+      float *p = &iocoord [12 * i + 4 * j];
+      __m128 coord = _mm_load_ps (p);
+      __m128 ru2 = radius2 (coord);
+      __m128 poly2 = _mm_add_ps (_mm_mul_ps (b.v [j], ru2), v.v [j]);
+      if (linear_c)
+        poly2 = _mm_add_ps (poly2, _mm_mul_ps (c.v [j], _mm_sqrt_ps (ru2)));
+      _mm_store_ps (p, _mm_mul_ps (coord, poly2));
+    }
+}
+
+static void untca_poly3_sse (const float *t, int channel, float *iocoord, int blocks)
+{
+  subpix_pattern_sse v = pattern_sse (t, 0, 1.0f, channel);
+  subpix_pattern_sse c = pattern_sse (t, 1, 0.0f, channel);
+  subpix_pattern_sse b = pattern_sse (t, 2, 0.0f, channel);
+  subpix_pattern_sse c_2 = pattern_sse (t, 1, 0.0f, channel, 2.0f);
+  subpix_pattern_sse b_3 = pattern_sse (t, 2, 0.0f, channel, 3.0f);
+  __m128 zero = _mm_setzero_ps ();
+  __m128 eps = _mm_set_ps1 (NEWTON_EPS);
+  __m128 sign = _mm_set_ps1 (-0.0f);
+
+  for (int i = 0; i < blocks; i++)
+    for (int j = 0; j < 3; j++)
+    {
+      float *p = &iocoord [12 * i + 4 * j];
+      __m128 coord = _mm_load_ps (p);
+      __m128 rd = _mm_sqrt_ps (radius2 (coord));
+
+      // Newton's method for all lanes in lockstep, see ModifyCoord_UnTCA_Poly3
+      __m128 ru = rd;
+      __m128 converged = zero;
+      for (int step = 0; step <= 6; step++)
+      {
+        // fru = b * Ru^3 + c * Ru^2 + v * Ru - Rd
+        __m128 fru = _mm_add_ps (_mm_mul_ps (b.v [j], ru), c.v [j]);
+        fru = _mm_add_ps (_mm_mul_ps (fru, ru), v.v [j]);
+        fru = _mm_sub_ps (_mm_mul_ps (fru, ru), rd);
+        converged = _mm_or_ps (converged, _mm_cmplt_ps (_mm_andnot_ps (sign, fru), eps));
+        __m128 dfru = _mm_add_ps (_mm_mul_ps (b_3.v [j], ru), c_2.v [j]);
+        dfru = _mm_add_ps (_mm_mul_ps (dfru, ru), v.v [j]);
+        // Converged lanes keep their ru, like the scalar loop
+        ru = _mm_sub_ps (ru, _mm_andnot_ps (converged, _mm_div_ps (fru, dfru)));
+        if (_mm_movemask_ps (converged) == 0xf)
+          break;
+      }
+
+      // Points which did not converge, at rd == 0, or with a negative ru
+      // stay untouched
+      __m128 valid = _mm_and_ps (converged, _mm_cmpgt_ps (ru, zero));
+      valid = _mm_andnot_ps (_mm_cmpeq_ps (rd, zero), valid);
+      __m128 res = _mm_mul_ps (coord, _mm_div_ps (ru, rd));
+      _mm_store_ps (p, _mm_or_ps (_mm_and_ps (valid, res), _mm_andnot_ps (valid, coord)));
+    }
+}
+
+static void tca_acm_sse (const float *t, int channel, float *iocoord, int blocks)
+{
+  subpix_pattern_sse k0 = pattern_sse (t, 0, 1.0f, channel);
+  subpix_pattern_sse k1 = pattern_sse (t, 1, 0.0f, channel);
+  subpix_pattern_sse k2 = pattern_sse (t, 2, 0.0f, channel);
+  subpix_pattern_sse k3 = pattern_sse (t, 3, 0.0f, channel);
+  // x * common_term + alpha5 * ru2 and y * common_term + alpha4 * ru2 are the
+  // same with the coefficients of the own and the other coordinate swapped
+  float alpha4 [3] = { t [8], 0.0f, t [9] };
+  float alpha5 [3] = { t [10], 0.0f, t [11] };
+  if (channel >= 0)
+  {
+    const int c = 2 * (channel == 2);
+    alpha4 [0] = alpha4 [1] = alpha4 [2] = alpha4 [c];
+    alpha5 [0] = alpha5 [1] = alpha5 [2] = alpha5 [c];
+  }
+  subpix_pattern_sse own (alpha5, alpha4);
+  subpix_pattern_sse other (alpha4, alpha5);
+  __m128 one = _mm_set_ps1 (1.0f);
+  __m128 two = _mm_set_ps1 (2.0f);
+
+  for (int i = 0; i < blocks; i++)
+    for (int j = 0; j < 3; j++)
+    {
+      float *p = &iocoord [12 * i + 4 * j];
+      __m128 coord = _mm_load_ps (p);
+      __m128 ru2 = radius2 (coord);
+      __m128 common_term = _mm_add_ps (_mm_mul_ps (k3.v [j], ru2), k2.v [j]);
+      common_term = _mm_add_ps (_mm_mul_ps (common_term, ru2), k1.v [j]);
+      common_term = _mm_add_ps (_mm_mul_ps (common_term, ru2), one);
+      __m128 tangential = _mm_add_ps (_mm_mul_ps (own.v [j], coord),
+                                      _mm_mul_ps (other.v [j], swap_xy (coord)));
+      common_term = _mm_add_ps (common_term, _mm_mul_ps (two, tangential));
+      __m128 res = _mm_add_ps (_mm_mul_ps (coord, common_term), _mm_mul_ps (own.v [j], ru2));
+      _mm_store_ps (p, _mm_mul_ps (k0.v [j], res));
+    }
+}
+
+void lfModifier::ModifyCoord_TCA_Linear_SSE (void *data, float *iocoord, int count)
+{
+  /*
+   * If buffer is not aligned, fall back to plain code
+   */
+  if((uintptr_t)(iocoord) & 0xf)
+  {
+    return ModifyCoord_TCA_Linear(data, iocoord, count);
+  }
+
+  lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+  // SSE Loop processes 2 pixels/loop
+  int loop_count = count / 2;
+  tca_linear_sse (cddata->terms, -1, iocoord, loop_count);
+
+  if (count & 1)
+    ModifyCoord_TCA_Linear (data, &iocoord [12 * loop_count], 1);
+}
+
+void lfModifier::ModifyCoord_TCA_Linear_Channel_SSE (void *data, int channel, float *iocoord, int count)
+{
+  if (channel == 1)
+    return;
+  if((uintptr_t)(iocoord) & 0xf)
+  {
+    return ModifyCoord_TCA_Linear_Channel(data, channel, iocoord, count);
+  }
+
+  lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+  // SSE Loop processes 6 points/loop
+  int loop_count = count / 6;
+  tca_linear_sse (cddata->terms, channel, iocoord, loop_count);
+
+  if (count % 6)
+    ModifyCoord_TCA_Linear_Channel (data, channel, &iocoord [12 * loop_count], count % 6);
+}
+
+void lfModifier::ModifyCoord_TCA_Poly3_SSE (void *data, float *iocoord, int count)
+{
+  if((uintptr_t)(iocoord) & 0xf)
+  {
+    return ModifyCoord_TCA_Poly3(data, iocoord, count);
+  }
+
+  lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+  // SSE Loop processes 2 pixels/loop
+  int loop_count = count / 2;
+  tca_poly3_sse (cddata->terms, -1, iocoord, loop_count);
+
+  if (count & 1)
+    ModifyCoord_TCA_Poly3 (data, &iocoord [12 * loop_count], 1);
+}
+
+void lfModifier::ModifyCoord_TCA_Poly3_Channel_SSE (void *data, int channel, float *iocoord, int count)
+{
+  if (channel == 1)
+    return;
+  if((uintptr_t)(iocoord) & 0xf)
+  {
+    return ModifyCoord_TCA_Poly3_Channel(data, channel, iocoord, count);
+  }
+
+  lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+  // SSE Loop processes 6 points/loop
+  int loop_count = count / 6;
+  tca_poly3_sse (cddata->terms, channel, iocoord, loop_count);
+
+  if (count % 6)
+    ModifyCoord_TCA_Poly3_Channel (data, channel, &iocoord [12 * loop_count], count % 6);
+}
+
+void lfModifier::ModifyCoord_UnTCA_Poly3_SSE (void *data, float *iocoord, int count)
+{
+  if((uintptr_t)(iocoord) & 0xf)
+  {
+    return ModifyCoord_UnTCA_Poly3(data, iocoord, count);
+  }
+
+  lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+  // SSE Loop processes 2 pixels/loop
+  int loop_count = count / 2;
+  untca_poly3_sse (cddata->terms, -1, iocoord, loop_count);
+
+  if (count & 1)
+    ModifyCoord_UnTCA_Poly3 (data, &iocoord [12 * loop_count], 1);
+}
+
+void lfModifier::ModifyCoord_UnTCA_Poly3_Channel_SSE (void *data, int channel, float *iocoord, int count)
+{
+  if (channel == 1)
+    return;
+  if((uintptr_t)(iocoord) & 0xf)
+  {
+    return ModifyCoord_UnTCA_Poly3_Channel(data, channel, iocoord, count);
+  }
+
+  lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+  // SSE Loop processes 6 points/loop
+  int loop_count = count / 6;
+  untca_poly3_sse (cddata->terms, channel, iocoord, loop_count);
+
+  if (count % 6)
+    ModifyCoord_UnTCA_Poly3_Channel (data, channel, &iocoord [12 * loop_count], count % 6);
+}
+
+void lfModifier::ModifyCoord_TCA_ACM_SSE (void *data, float *iocoord, int count)
+{
+  if((uintptr_t)(iocoord) & 0xf)
+  {
+    return ModifyCoord_TCA_ACM(data, iocoord, count);
+  }
+
+  lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+  // SSE Loop processes 2 pixels/loop
+  int loop_count = count / 2;
+  tca_acm_sse (cddata->terms, -1, iocoord, loop_count);
+
+  if (count & 1)
+    ModifyCoord_TCA_ACM (data, &iocoord [12 * loop_count], 1);
+}
+
+void lfModifier::ModifyCoord_TCA_ACM_Channel_SSE (void *data, int channel, float *iocoord, int count)
+{
+  if (channel == 1)
+    return;
+  if((uintptr_t)(iocoord) & 0xf)
+  {
+    return ModifyCoord_TCA_ACM_Channel(data, channel, iocoord, count);
+  }
+
+  lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+  // SSE Loop processes 6 points/loop
+  int loop_count = count / 6;
+  tca_acm_sse (cddata->terms, channel, iocoord, loop_count);
+
+  if (count % 6)
+    ModifyCoord_TCA_ACM_Channel (data, channel, &iocoord [12 * loop_count], count % 6);
+}
+
+#endif
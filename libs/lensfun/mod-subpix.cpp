@@ -42,6 +42,28 @@ lfLensCalibTCA rescale_polynomial_coefficients (const lfLensCalibTCA& lctca_, do
 int lfModifier::EnableTCACorrection (const lfLensCalibTCA& lctca_)
 {
     const lfLensCalibTCA lctca = rescale_polynomial_coefficients (lctca_, RealFocal, Reverse);
+
+    // The plain, SSE and AVX2 kernels of every model, NULL where they are
+    // not compiled in
+#ifdef VECTORIZATION_SSE
+#define TCA_SSE(func) { func##_SSE, func##_Channel_SSE }
+#else
+#define TCA_SSE(func) { NULL, NULL }
+#endif
+#ifdef VECTORIZATION_AVX2
+#define TCA_AVX2(func) { func##_AVX2, func##_Channel_AVX2 }
+#else
+#define TCA_AVX2(func) { NULL, NULL }
+#endif
+#define TCA_KERNELS(func) { { func, func##_Channel }, TCA_SSE (func), TCA_AVX2 (func) }
+    static const lfSubpixKernel linear [3] = TCA_KERNELS (ModifyCoord_TCA_Linear);
+    static const lfSubpixKernel poly3 [3] = TCA_KERNELS (ModifyCoord_TCA_Poly3);
+    static const lfSubpixKernel unpoly3 [3] = TCA_KERNELS (ModifyCoord_UnTCA_Poly3);
+    static const lfSubpixKernel acm [3] = TCA_KERNELS (ModifyCoord_TCA_ACM);
+#undef TCA_KERNELS
+#undef TCA_AVX2
+#undef TCA_SSE
+
     if (Reverse)
         switch (lctca.Model)
         {
@@ -49,12 +71,12 @@ int lfModifier::EnableTCACorrection (const lfLensCalibTCA& lctca_)
                 break;
 
             case LF_TCA_MODEL_LINEAR:
-                AddSubpixTCACallback(lctca, ModifyCoord_TCA_Linear, 500);
+                AddSubpixTCACallback (lctca, linear, 500);
                 EnabledMods |= LF_MODIFY_TCA;
                 return EnabledMods;
 
             case LF_TCA_MODEL_POLY3:
-                AddSubpixTCACallback(lctca, ModifyCoord_UnTCA_Poly3, 500);
+                AddSubpixTCACallback (lctca, unpoly3, 500);
                 EnabledMods |= LF_MODIFY_TCA;
                 return EnabledMods;
 
@@ -74,17 +96,17 @@ int lfModifier::EnableTCACorrection (const lfLensCalibTCA& lctca_)
                 break;
 
             case LF_TCA_MODEL_LINEAR:
-                AddSubpixTCACallback(lctca, ModifyCoord_TCA_Linear, 500);
+                AddSubpixTCACallback (lctca, linear, 500);
                 EnabledMods |= LF_MODIFY_TCA;
                 return EnabledMods;
 
             case LF_TCA_MODEL_POLY3:
-                AddSubpixTCACallback(lctca, ModifyCoord_TCA_Poly3, 500);
+                AddSubpixTCACallback (lctca, poly3, 500);
                 EnabledMods |= LF_MODIFY_TCA;
                 return EnabledMods;
 
             case LF_TCA_MODEL_ACM:
-                AddSubpixTCACallback(lctca, ModifyCoord_TCA_ACM, 500);
+                AddSubpixTCACallback (lctca, acm, 500);
                 EnabledMods |= LF_MODIFY_TCA;
                 return EnabledMods;
 
@@ -107,91 +129,346 @@ int lfModifier::EnableTCACorrection ()
     return EnabledMods;
 }
 
-void lfModifier::AddSubpixTCACallback (const lfLensCalibTCA& lctca, lfModifySubpixCoordFunc func, int priority)
+/*
+ * Add the fastest of the plain, SSE and AVX2 kernels of a TCA model which the
+ * CPU supports.
+ */
+void lfModifier::AddSubpixTCACallback (const lfLensCalibTCA& lctca,
+                                       const lfSubpixKernel (&kernels) [3], int priority)
 {
-    lfSubpixTCACallback* cd = new lfSubpixTCACallback;
+    const lfSubpixKernel *kernel = &kernels [0];
+#ifdef VECTORIZATION_SSE
+    if (_lf_detect_cpu_features () & LF_CPU_FLAG_SSE)
+        kernel = &kernels [1];
+#endif
+#ifdef VECTORIZATION_AVX2
+    if (_lf_cpu_has_avx2_fma ())
+        kernel = &kernels [2];
+#endif
 
-    cd->callback = func;
-    cd->priority = priority;
+    lfSubpixTCACallback cd;
 
-    memcpy(cd->terms, lctca.Terms, sizeof(lctca.Terms));
+    cd.callback = kernel->func;
+    cd.channel_callback = kernel->channel_func;
+    cd.priority = priority;
 
-    SubpixelCallbacks.insert(cd);
+    memcpy(cd.terms, lctca.Terms, sizeof(lctca.Terms));
+
+    Callbacks->Subpixel.insert(cd);
 }
 
 bool lfModifier::ApplySubpixelDistortion (
     float xu, float yu, int width, int height, float *res) const
 {
-    if (SubpixelCallbacks.size() <= 0 || height <= 0)
+    float *const res_x [3] = { res, res + 2, res + 4 };
+    float *const res_y [3] = { res + 1, res + 3, res + 5 };
+    return ComputeSubpixelDistortion (false, xu, yu, width, height, res_x, res_y,
+                                      6, size_t (width) * 6);
+}
+
+bool lfModifier::ApplySubpixelGeometryDistortion (
+    float xu, float yu, int width, int height, float *res) const
+{
+    float *const res_x [3] = { res, res + 2, res + 4 };
+    float *const res_y [3] = { res + 1, res + 3, res + 5 };
+    return ComputeSubpixelDistortion (true, xu, yu, width, height, res_x, res_y,
+                                      6, size_t (width) * 6);
+}
+
+bool lfModifier::ApplySubpixelDistortion (
+    float xu, float yu, int width, int height,
+    float *const res_x [3], float *const res_y [3], int row_stride) const
+{
+    return ComputeSubpixelDistortion (false, xu, yu, width, height, res_x, res_y,
+                                      1, row_stride / sizeof (float));
+}
+
+bool lfModifier::ApplySubpixelGeometryDistortion (
+    float xu, float yu, int width, int height,
+    float *const res_x [3], float *const res_y [3], int row_stride) const
+{
+    return ComputeSubpixelDistortion (true, xu, yu, width, height, res_x, res_y,
+                                      1, row_stride / sizeof (float));
+}
+
+bool lfModifier::ApplySubpixelDistortion (
+    float xu, float yu, int width, int height, float *const res [3], int row_stride) const
+{
+    return ComputeSubpixelDistortionChannels (false, xu, yu, width, height, res,
+                                              row_stride / sizeof (float));
+}
+
+bool lfModifier::ApplySubpixelGeometryDistortion (
+    float xu, float yu, int width, int height, float *const res [3], int row_stride) const
+{
+    return ComputeSubpixelDistortionChannels (true, xu, yu, width, height, res,
+                                              row_stride / sizeof (float));
+}
+
+/*
+ * Common part of the variants of ApplySubpixelDistortion and
+ * ApplySubpixelGeometryDistortion; the latter run the coordinate callbacks
+ * first.  The coordinates of a pixel are stride floats apart, the rows
+ * row_stride floats.  A stride of 6 means interleaved (R, G, B) pairs.
+ */
+bool lfModifier::ComputeSubpixelDistortion (
+    bool geometry, float xu, float yu, int width, int height,
+    float *const res_x [3], float *const res_y [3], int stride, size_t row_stride) const
+{
+    if (height <= 0 || (Callbacks->Subpixel.size() <= 0 &&
+                        (!geometry || Callbacks->Coord.size() <= 0)))
         return false; // nothing to do
 
     // All callbacks work with normalized coordinates
     xu = xu * NormScale - CenterX;
     yu = yu * NormScale - CenterY;
-
-    for (float y = yu; height; y += NormScale, height--)
+    const float step = NormScale;
+
+    // Work in blocks which stay in the L1 cache.  Interleaved output is its
+    // own block buffer, planes are split off in the final conversion.  The
+    // SSE callbacks need the buffer aligned.
+    const int block_size = 256;
+    alignas (32) float buffer [block_size * 6];
+    const bool planar = stride != 6;
+    for (int j = 0; j < height; j++)
     {
-        int i;
-        float x = xu;
-        float *out = res;
-        for (i = 0; i < width; i++, x += NormScale)
+        const float y = yu + j * step;
+        const size_t row = j * row_stride;
+        for (int block = 0; block < width; block += block_size)
         {
-            out [0] = out [2] = out [4] = x;
-            out [1] = out [3] = out [5] = y;
-            out += 6;
-        }
-
-        for (auto cb : SubpixelCallbacks)
-            cb->callback (cb, res, width);
-
-        // Convert normalized coordinates back into natural coordinates
-        for (i = width * 3; i > 0; i--)
-        {
-            res [0] = (res [0] + CenterX) * NormUnScale;
-            res [1] = (res [1] + CenterY) * NormUnScale;
-            res += 2;
+            const int count = std::min (block_size, width - block);
+            float *coords = planar ? buffer : res_x [0] + row + block * 6;
+            int i;
+            if (geometry)
+            {
+                // The geometry is the same for all three colours, so it is
+                // computed once per pixel, in the last third of the block.
+                // Spreading it out front to back never overwrites a pixel
+                // which is still to be read.
+                float *geom = coords + count * 4;
+                for (i = 0; i < count; i++)
+                {
+                    geom [i * 2] = xu + (block + i) * step;
+                    geom [i * 2 + 1] = y;
+                }
+
+                for (auto cb : Callbacks->Coord)
+                    cb->callback (cb, geom, count);
+
+                for (i = 0; i < count; i++)
+                {
+                    const float gx = geom [i * 2], gy = geom [i * 2 + 1];
+                    float *out = coords + i * 6;
+                    out [0] = out [2] = out [4] = gx;
+                    out [1] = out [3] = out [5] = gy;
+                }
+            }
+            else
+                for (i = 0; i < count; i++)
+                {
+                    float *out = coords + i * 6;
+                    out [0] = out [2] = out [4] = xu + (block + i) * step;
+                    out [1] = out [3] = out [5] = y;
+                }
+
+            for (auto cb : Callbacks->Subpixel)
+                cb->callback (cb, coords, count);
+
+            // Convert normalized coordinates back into natural coordinates
+            for (int c = 0; c < 3; c++)
+            {
+                float *out_x = res_x [c] + row + block * stride;
+                float *out_y = res_y [c] + row + block * stride;
+                for (i = 0; i < count; i++)
+                {
+                    out_x [i * stride] = (coords [i * 6 + c * 2] + CenterX) * NormUnScale;
+                    out_y [i * stride] = (coords [i * 6 + c * 2 + 1] + CenterY) * NormUnScale;
+                }
+            }
         }
     }
 
     return true;
 }
 
-bool lfModifier::ApplySubpixelGeometryDistortion (
-    float xu, float yu, int width, int height, float *res) const
+/*
+ * The same with an (X, Y) map per channel.  The maps are the work buffers:
+ * the geometry is computed once into the green map, copied to the red and
+ * blue maps, and then every channel goes through the channel variants of
+ * the subpixel callbacks on its own.
+ */
+bool lfModifier::ComputeSubpixelDistortionChannels (
+    bool geometry, float xu, float yu, int width, int height,
+    float *const res [3], size_t row_stride) const
 {
-    if ((SubpixelCallbacks.size() <= 0 && CoordCallbacks.size() <= 0) || height <= 0)
+    if (height <= 0 || (Callbacks->Subpixel.size() <= 0 &&
+                        (!geometry || Callbacks->Coord.size() <= 0)))
         return false; // nothing to do
 
     // All callbacks work with normalized coordinates
     xu = xu * NormScale - CenterX;
     yu = yu * NormScale - CenterY;
+    const float step = NormScale;
 
-    for (float y = yu; height; y += NormScale, height--)
+    // Blocks which stay in the L1 cache, like in ComputeSubpixelDistortion
+    const int block_size = 256;
+    for (int j = 0; j < height; j++)
     {
-        int i;
-        float x = xu;
-        float *out = res;
-        for (i = 0; i < width; i++, x += NormScale)
+        const float y = yu + j * step;
+        const size_t row = j * row_stride;
+        for (int block = 0; block < width; block += block_size)
         {
-            out [0] = out [2] = out [4] = x;
-            out [1] = out [3] = out [5] = y;
-            out += 6;
+            const int count = std::min (block_size, width - block);
+            float *coords [3];
+            for (int c = 0; c < 3; c++)
+                coords [c] = res [c] + row + block * 2;
+
+            float *green = coords [1];
+            for (int i = 0; i < count; i++)
+            {
+                green [i * 2] = xu + (block + i) * step;
+                green [i * 2 + 1] = y;
+            }
+
+            if (geometry)
+                for (auto cb : Callbacks->Coord)
+                    cb->callback (cb, green, count);
+
+            memcpy (coords [0], green, count * 2 * sizeof (float));
+            memcpy (coords [2], green, count * 2 * sizeof (float));
+
+            for (int c = 0; c < 3; c++)
+            {
+                for (auto cb : Callbacks->Subpixel)
+                    cb->channel_callback (cb, c, coords [c], count);
+
+                // Convert normalized coordinates back into natural coordinates
+                float *out = coords [c];
+                for (int i = 0; i < count; i++)
+                {
+                    out [i * 2] = (out [i * 2] + CenterX) * NormUnScale;
+                    out [i * 2 + 1] = (out [i * 2 + 1] + CenterY) * NormUnScale;
+                }
+            }
         }
+    }
+
+    return true;
+}
 
-        for (auto cb : CoordCallbacks)
-            cb->callback (cb, res, width * 3);
+bool lfModifier::ApplySubpixelDistortionCFA (
+    float xu, float yu, int width, int height,
+    const unsigned char *cfa, int cfa_size, float *res) const
+{
+    return ComputeSubpixelDistortionCFA (false, xu, yu, width, height, cfa, cfa_size, res);
+}
+
+bool lfModifier::ApplySubpixelGeometryDistortionCFA (
+    float xu, float yu, int width, int height,
+    const unsigned char *cfa, int cfa_size, float *res) const
+{
+    return ComputeSubpixelDistortionCFA (true, xu, yu, width, height, cfa, cfa_size, res);
+}
+
+/*
+ * Common part of both CFA variants.  The geometry is computed for the whole
+ * block like in ApplyGeometryDistortion, which is all that green sites
+ * need, since TCA is relative to green.  Only the red and blue sites go
+ * through the subpixel callbacks.  They are collected from one repetition
+ * of the pattern at a time, column by column, so that red and blue sites
+ * fill the red and blue slots of the same (R, G, B) groups.
+ */
+bool lfModifier::ComputeSubpixelDistortionCFA (
+    bool geometry, float xu, float yu, int width, int height,
+    const unsigned char *cfa, int cfa_size, float *res) const
+{
+    if (height <= 0 || cfa_size <= 0 ||
+        (Callbacks->Subpixel.size() <= 0 && (!geometry || Callbacks->Coord.size() <= 0)))
+        return false; // nothing to do
 
-        for (auto cb : SubpixelCallbacks)
-            cb->callback (cb, res, width);
+    const size_t row_stride = size_t (width) * 2;
+    const int n = cfa_size;
+
+    // The pattern site of the first pixel of the block
+    const int site_x = (int (floor (xu + 0.5f)) % n + n) % n;
+    const int site_y = (int (floor (yu + 0.5f)) % n + n) % n;
+
+    // The callbacks work with normalized coordinates.  Red sites go into the
+    // red slots of the groups, blue sites into the blue slots; what is left
+    // in the other slots is ignored, but must be valid numbers.
+    const int block_size = 256;
+    alignas (32) float groups [block_size * 6];
+    memset (groups, 0, sizeof (groups));
+    float *red [block_size], *blue [block_size];
+    int red_count = 0, blue_count = 0;
+    auto run_subpixel_callbacks = [&] ()
+    {
+        const int count = std::max (red_count, blue_count);
+        for (auto cb : Callbacks->Subpixel)
+            cb->callback (cb, groups, count);
 
-        // Convert normalized coordinates back into natural coordinates
-        for (i = width * 3; i > 0; i--)
+        for (int k = 0; k < red_count; k++)
+        {
+            red [k][0] = (groups [k * 6] + CenterX) * NormUnScale;
+            red [k][1] = (groups [k * 6 + 1] + CenterY) * NormUnScale;
+        }
+        for (int k = 0; k < blue_count; k++)
         {
-            res [0] = (res [0] + CenterX) * NormUnScale;
-            res [1] = (res [1] + CenterY) * NormUnScale;
-            res += 2;
+            blue [k][0] = (groups [k * 6 + 4] + CenterX) * NormUnScale;
+            blue [k][1] = (groups [k * 6 + 5] + CenterY) * NormUnScale;
         }
+        red_count = blue_count = 0;
+    };
+
+    // One repetition of the pattern at a time, so that it stays in the cache
+    for (int band = 0; band < height; band += n)
+    {
+        const int rows = std::min (n, height - band);
+        float *const band_res = res + band * row_stride;
+        if (!geometry || !ComputeGeometryDistortion (xu, yu + band, width, rows, band_res,
+                                                     band_res + 1, 2, row_stride))
+            for (int j = 0; j < rows; j++)
+            {
+                float *coords = band_res + j * row_stride;
+                for (int i = 0; i < width; i++)
+                {
+                    coords [i * 2] = xu + i;
+                    coords [i * 2 + 1] = yu + band + j;
+                }
+            }
+
+        if (Callbacks->Subpixel.size() <= 0)
+            continue;
+
+        for (int i = 0, site = site_x; i < width; i++, site = site + 1 < n ? site + 1 : 0)
+            // Every band starts with pattern row site_y
+            for (int j = 0, site_row = site_y; j < rows;
+                 j++, site_row = site_row + 1 < n ? site_row + 1 : 0)
+            {
+                const unsigned char colour = cfa [site_row * n + site];
+                if (colour != 0 && colour != 2)
+                    continue;
+
+                float *coords = band_res + j * row_stride + i * 2;
+                float *group;
+                if (colour == 0)
+                {
+                    group = groups + red_count * 6;
+                    red [red_count++] = coords;
+                }
+                else
+                {
+                    group = groups + blue_count * 6 + 4;
+                    blue [blue_count++] = coords;
+                }
+                group [0] = coords [0] * NormScale - CenterX;
+                group [1] = coords [1] * NormScale - CenterY;
+                if (red_count == block_size || blue_count == block_size)
+                    run_subpixel_callbacks ();
+            }
     }
+    if (red_count || blue_count)
+        run_subpixel_callbacks ();
 
     return true;
 }
@@ -204,13 +481,10 @@ void lfModifier::ModifyCoord_TCA_Linear (void *data, float *iocoord, int count)
 
     for (float *end = iocoord + count * 2 * 3; iocoord < end; iocoord += 6)
     {
-        const float x = iocoord [0];
-        const float y = iocoord [1];
-
-        iocoord [0] = x * k_r;
-        iocoord [1] = y * k_r;
-        iocoord [4] = x * k_b;
-        iocoord [5] = y * k_b;
+        iocoord [0] *= k_r;
+        iocoord [1] *= k_r;
+        iocoord [4] *= k_b;
+        iocoord [5] *= k_b;
     }
 }
 
@@ -386,6 +660,120 @@ void lfModifier::ModifyCoord_TCA_ACM (void *data, float *iocoord, int count)
     }
 }
 
+/*
+ * The channel variants of the TCA callbacks.  Red has its coefficients at
+ * the even, blue at the odd indices of the terms; green is the reference
+ * and stays untouched.
+ */
+
+void lfModifier::ModifyCoord_TCA_Linear_Channel (void *data, int channel, float *iocoord, int count)
+{
+    if (channel == 1)
+        return;
+    lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+    const float k = cddata->terms [channel == 2];
+
+    for (float *end = iocoord + count * 2; iocoord < end; iocoord += 2)
+    {
+        iocoord [0] *= k;
+        iocoord [1] *= k;
+    }
+}
+
+void lfModifier::ModifyCoord_UnTCA_Poly3_Channel (void *data, int channel, float *iocoord, int count)
+{
+    if (channel == 1)
+        return;
+    lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+    const float *terms = cddata->terms + (channel == 2);
+    const float v = terms [0];
+    const float c = terms [2];
+    const float b = terms [4];
+
+    for (float *end = iocoord + count * 2; iocoord < end; iocoord += 2)
+    {
+        const float x = iocoord [0];
+        const float y = iocoord [1];
+        const double rd = sqrt (x * x + y * y);
+        if (rd == 0.0)
+            continue;
+
+        // Newton's method, see ModifyCoord_UnTCA_Poly3
+        double ru = rd;
+        for (int step = 0; ; step++)
+        {
+            const double ru2 = ru * ru;
+            const double fru = b * ru2 * ru + c * ru2 + v * ru - rd;
+            if (fru >= -NEWTON_EPS && fru < NEWTON_EPS)
+                break;
+            if (step > 5)
+            {
+                // Does not converge, no real solution in this area?
+                ru = 0.0;
+                break;
+            }
+
+            ru -= fru / (3 * b * ru2 + 2 * c * ru + v);
+        }
+        // Negative radius does not make sense at all
+        if (ru > 0.0)
+        {
+            ru /= rd;
+            iocoord [0] = x * ru;
+            iocoord [1] = y * ru;
+        }
+    }
+}
+
+void lfModifier::ModifyCoord_TCA_Poly3_Channel (void *data, int channel, float *iocoord, int count)
+{
+    if (channel == 1)
+        return;
+    lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+    const float *terms = cddata->terms + (channel == 2);
+    const float v = terms [0];
+    const float c = terms [2];
+    const float b = terms [4];
+
+    for (float *end = iocoord + count * 2; iocoord < end; iocoord += 2)
+    {
+        const float x = iocoord [0];
+        const float y = iocoord [1];
+        const float ru2 = x * x + y * y;
+        // Avoid the square root for the common case c == 0
+        const float poly2 = c == 0.0 ? b * ru2 + v : b * ru2 + c * sqrt (ru2) + v;
+        iocoord [0] = x * poly2;
+        iocoord [1] = y * poly2;
+    }
+}
+
+void lfModifier::ModifyCoord_TCA_ACM_Channel (void *data, int channel, float *iocoord, int count)
+{
+    if (channel == 1)
+        return;
+    lfSubpixTCACallback* cddata = (lfSubpixTCACallback*) data;
+    const float *terms = cddata->terms + (channel == 2);
+    const float k0 = terms [0];
+    const float k1 = terms [2];
+    const float k2 = terms [4];
+    const float k3 = terms [6];
+    const float k4 = terms [8];
+    const float k5 = terms [10];
+
+    for (float *end = iocoord + count * 2; iocoord < end; iocoord += 2)
+    {
+        // See ModifyCoord_TCA_ACM
+        const float x = iocoord [0];
+        const float y = iocoord [1];
+        const float ru2 = x * x + y * y;
+        const float ru4 = ru2 * ru2;
+        const float common_term = 1.0 + k1 * ru2 + k2 * ru4 + k3 * ru4 * ru2 +
+                                  2 * (k4 * y + k5 * x);
+        iocoord [0] = k0 * (x * common_term + k5 * ru2);
+        iocoord [1] = k0 * (y * common_term + k4 * ru2);
+    }
+}
+
 //---------------------------// The C interface //---------------------------//
 
 cbool lf_modifier_apply_subpixel_distortion (
@@ -400,6 +788,52 @@ cbool lf_modifier_apply_subpixel_geometry_distortion (
     return modifier->ApplySubpixelGeometryDistortion (xu, yu, width, height, res);
 }
 
+cbool lf_modifier_apply_subpixel_distortion_planar (
+    lfModifier *modifier, float xu, float yu, int width, int height,
+    float *const *res_x, float *const *res_y, int row_stride)
+{
+    return modifier->ApplySubpixelDistortion (xu, yu, width, height,
+                                              res_x, res_y, row_stride);
+}
+
+cbool lf_modifier_apply_subpixel_geometry_distortion_planar (
+    lfModifier *modifier, float xu, float yu, int width, int height,
+    float *const *res_x, float *const *res_y, int row_stride)
+{
+    return modifier->ApplySubpixelGeometryDistortion (xu, yu, width, height,
+                                                      res_x, res_y, row_stride);
+}
+
+cbool lf_modifier_apply_subpixel_distortion_channels (
+    lfModifier *modifier, float xu, float yu, int width, int height,
+    float *const *res, int row_stride)
+{
+    return modifier->ApplySubpixelDistortion (xu, yu, width, height, res, row_stride);
+}
+
+cbool lf_modifier_apply_subpixel_geometry_distortion_channels (
+    lfModifier *modifier, float xu, float yu, int width, int height,
+    float *const *res, int row_stride)
+{
+    return modifier->ApplySubpixelGeometryDistortion (xu, yu, width, height, res, row_stride);
+}
+
+cbool lf_modifier_apply_subpixel_distortion_cfa (
+    lfModifier *modifier, float xu, float yu, int width, int height,
+    const unsigned char *cfa, int cfa_size, float *res)
+{
+    return modifier->ApplySubpixelDistortionCFA (xu, yu, width, height,
+                                                 cfa, cfa_size, res);
+}
+
+cbool lf_modifier_apply_subpixel_geometry_distortion_cfa (
+    lfModifier *modifier, float xu, float yu, int width, int height,
+    const unsigned char *cfa, int cfa_size, float *res)
+{
+    return modifier->ApplySubpixelGeometryDistortionCFA (xu, yu, width, height,
+                                                         cfa, cfa_size, res);
+}
+
 int lf_modifier_enable_tca_correction (lfModifier *modifier)
 {
     return modifier->EnableTCACorrection();
@@ -60,7 +60,8 @@
 
 lfModifier::lfModifier (const lfLens *lens, float imgfocal, float imgcrop, int imgwidth, int imgheight,
                         lfPixelFormat pixel_format, bool reverse /* = false */)
-    : Crop(imgcrop), Focal(imgfocal), Reverse(reverse), PixelFormat(pixel_format), Lens(lens)
+    : Callbacks(new lfCallbackChains), Crop(imgcrop), Focal(imgfocal), Reverse(reverse),
+      PixelFormat(pixel_format), Lens(lens)
 {
     // Avoid divide overflows on singular cases.  The "- 1" is due to the fact
     // that `Width` and `Height` are measured at the pixel centres (they are
@@ -85,6 +86,13 @@ lfModifier::lfModifier (const lfLens *lens, float imgfocal, float imgcrop, int i
     CenterY = (Height / 2.0 + size / 2.0 * Lens->CenterY) * NormScale;
 
     EnabledMods = 0;
+    CoordKernel.row = NULL;
+    CoordKernel.symmetric = false;
+    CoordKernel.mirror_row = CoordKernel.reflect_row = NULL;
+    CoordKernel.mirror_reach = 0;
+    CoordKernel.radial_pending = false;
+    CoordGrid.spacing = 0;
+    CoordGrid.max_error = 0.0f;
 }
 
 int lfModifier::EnableScaling (float scale)
@@ -93,25 +101,53 @@ int lfModifier::EnableScaling (float scale)
         return EnabledMods;
 
     // Inverse scale factor
-    if (scale == 0.0)
+    const bool automatic = scale == 0.0;
+    if (automatic)
     {
+        if (UpdateAutoScale ())
+            return EnabledMods;
         scale = GetAutoScale (Reverse);
         if (scale == 0.0)
             return EnabledMods;
     }
 
-    lfCoordScaleCallbackData* cd = new lfCoordScaleCallbackData;
+    lfCoordScaleCallbackData cd;
 
-    cd->callback = ModifyCoord_Scale;
-    cd->priority = Reverse ? 900 : 100;
-    cd->scale_factor = Reverse ? scale : 1.0 / scale;
+    cd.callback = ModifyCoord_Scale;
+    cd.priority = Reverse ? 900 : 100;
+    cd.scale_factor = Reverse ? scale : 1.0 / scale;
+    cd.automatic = automatic;
 
-    CoordCallbacks.insert(cd);
+    AddCoordCallback (cd);
 
     EnabledMods |= LF_MODIFY_SCALE;
     return EnabledMods;
 }
 
+/*
+ * Compute the scale of EnableScaling(0) again, after a callback was changed in
+ * place.  Returns false if there is no such scale.
+ */
+bool lfModifier::UpdateAutoScale ()
+{
+    for (auto cb : Callbacks->Coord)
+    {
+        auto cd = dynamic_cast<lfCoordScaleCallbackData*> (cb);
+        if (cd && cd->automatic)
+        {
+            // The scale is computed for the chain without itself
+            cd->scale_factor = 1.0f;
+            PlanCoordCallbacks ();
+            const float scale = GetAutoScale (Reverse);
+            if (scale != 0.0)
+                cd->scale_factor = Reverse ? scale : 1.0 / scale;
+            PlanCoordCallbacks ();
+            return true;
+        }
+    }
+    return false;
+}
+
 
 int lfModifier::GetModFlags()
 {
@@ -120,12 +156,127 @@ int lfModifier::GetModFlags()
 
 lfModifier::~lfModifier ()
 {
-    for (auto cb : CoordCallbacks)
-        delete cb;
-    for (auto cb : SubpixelCallbacks)
-        delete cb;
-    for (auto cb : ColorCallbacks)
-        delete cb;
+    // The callback chains destroy their callbacks themselves
+    delete Callbacks;
+}
+
+//---------------------------------------------------------------------------//
+
+/*
+  A plan is a modifier which nobody changes any more.  Everything which is
+  computed for the corrections, including the interpolation grid, is in place
+  when the modifier is handed over, except for the radial table of the
+  coordinate kernel, which is built on first use; the plan builds it right
+  away.  Afterwards the Apply methods only read the modifier, so the plan
+  just forwards them.  What makes sharing safe is that the plan has no way to
+  reach the Enable methods.
+*/
+
+lfModifierPlan::lfModifierPlan (lfModifier *modifier) : Modifier (modifier)
+{
+    // Finish the kernel now, so that the plan is never written to again
+    Modifier->PrepareCoordKernel ();
+}
+
+lfModifierPlan::~lfModifierPlan ()
+{
+    delete Modifier;
+}
+
+int lfModifierPlan::GetModFlags () const
+{
+    return Modifier->EnabledMods;
+}
+
+size_t lfModifierPlan::GetJacobianScratchSize (int width, int height)
+{
+    return lfModifier::JacobianScratchSize (width, height);
+}
+
+bool lfModifierPlan::ApplyColorModification (
+    void *pixels, float x, float y, int width, int height, int comp_role, int row_stride) const
+{
+    return Modifier->ApplyColorModification (pixels, x, y, width, height, comp_role, row_stride);
+}
+
+bool lfModifierPlan::ApplyGeometryDistortion (
+    float xu, float yu, int width, int height, float *res) const
+{
+    return Modifier->ApplyGeometryDistortion (xu, yu, width, height, res);
+}
+
+bool lfModifierPlan::ApplyGeometryDistortion (
+    float xu, float yu, int width, int height,
+    float *res_x, float *res_y, int row_stride) const
+{
+    return Modifier->ApplyGeometryDistortion (xu, yu, width, height, res_x, res_y, row_stride);
+}
+
+bool lfModifierPlan::ApplyGeometryDistortionJacobian (
+    float xu, float yu, int width, int height, float *res, float *jacobian, float *scratch) const
+{
+    return Modifier->ComputeGeometryDistortionJacobian (xu, yu, width, height,
+                                                        res, jacobian, scratch);
+}
+
+bool lfModifierPlan::ApplyGeometryDistortionMask (
+    float xu, float yu, int width, int height, float *res, lf_u32 *mask) const
+{
+    return Modifier->ApplyGeometryDistortionMask (xu, yu, width, height, res, mask);
+}
+
+bool lfModifierPlan::ApplySubpixelDistortion (
+    float xu, float yu, int width, int height, float *res) const
+{
+    return Modifier->ApplySubpixelDistortion (xu, yu, width, height, res);
+}
+
+bool lfModifierPlan::ApplySubpixelGeometryDistortion (
+    float xu, float yu, int width, int height, float *res) const
+{
+    return Modifier->ApplySubpixelGeometryDistortion (xu, yu, width, height, res);
+}
+
+bool lfModifierPlan::ApplySubpixelDistortion (
+    float xu, float yu, int width, int height,
+    float *const res_x [3], float *const res_y [3], int row_stride) const
+{
+    return Modifier->ApplySubpixelDistortion (xu, yu, width, height, res_x, res_y, row_stride);
+}
+
+bool lfModifierPlan::ApplySubpixelGeometryDistortion (
+    float xu, float yu, int width, int height,
+    float *const res_x [3], float *const res_y [3], int row_stride) const
+{
+    return Modifier->ApplySubpixelGeometryDistortion (xu, yu, width, height,
+                                                      res_x, res_y, row_stride);
+}
+
+bool lfModifierPlan::ApplySubpixelDistortion (
+    float xu, float yu, int width, int height, float *const res [3], int row_stride) const
+{
+    return Modifier->ApplySubpixelDistortion (xu, yu, width, height, res, row_stride);
+}
+
+bool lfModifierPlan::ApplySubpixelGeometryDistortion (
+    float xu, float yu, int width, int height, float *const res [3], int row_stride) const
+{
+    return Modifier->ApplySubpixelGeometryDistortion (xu, yu, width, height, res, row_stride);
+}
+
+bool lfModifierPlan::ApplySubpixelDistortionCFA (
+    float xu, float yu, int width, int height,
+    const unsigned char *cfa, int cfa_size, float *res) const
+{
+    return Modifier->ApplySubpixelDistortionCFA (xu, yu, width, height, cfa, cfa_size, res);
+}
+
+bool lfModifierPlan::ApplySubpixelGeometryDistortionCFA (
+    float xu, float yu, int width, int height,
+    const unsigned char *cfa, int cfa_size, float *res) const
+{
+    return Modifier->ApplySubpixelGeometryDistortionCFA (xu, yu, width, height,
+                                                         cfa, cfa_size, res);
 }
 
 //---------------------------// The C interface //---------------------------//
@@ -152,3 +303,112 @@ int lf_modifier_get_mod_flags (lfModifier *modifier)
 {
     return modifier->GetModFlags();
 }
+
+lfModifierPlan *lf_modifier_plan_create (lfModifier *modifier)
+{
+    return new lfModifierPlan (modifier);
+}
+
+void lf_modifier_plan_destroy (lfModifierPlan *plan)
+{
+    delete plan;
+}
+
+int lf_modifier_plan_get_mod_flags (const lfModifierPlan *plan)
+{
+    return plan->GetModFlags ();
+}
+
+size_t lf_modifier_plan_get_jacobian_scratch_size (int width, int height)
+{
+    return lfModifierPlan::GetJacobianScratchSize (width, height);
+}
+
+cbool lf_modifier_plan_apply_color_modification (
+    const lfModifierPlan *plan, void *pixels, float x, float y, int width, int height,
+    int comp_role, int row_stride)
+{
+    return plan->ApplyColorModification (pixels, x, y, width, height, comp_role, row_stride);
+}
+
+cbool lf_modifier_plan_apply_geometry_distortion (
+    const lfModifierPlan *plan, float xu, float yu, int width, int height, float *res)
+{
+    return plan->ApplyGeometryDistortion (xu, yu, width, height, res);
+}
+
+cbool lf_modifier_plan_apply_geometry_distortion_planar (
+    const lfModifierPlan *plan, float xu, float yu, int width, int height,
+    float *res_x, float *res_y, int row_stride)
+{
+    return plan->ApplyGeometryDistortion (xu, yu, width, height, res_x, res_y, row_stride);
+}
+
+cbool lf_modifier_plan_apply_geometry_distortion_jacobian (
+    const lfModifierPlan *plan, float xu, float yu, int width, int height,
+    float *res, float *jacobian, float *scratch)
+{
+    return plan->ApplyGeometryDistortionJacobian (xu, yu, width, height, res, jacobian, scratch);
+}
+
+cbool lf_modifier_plan_apply_geometry_distortion_mask (
+    const lfModifierPlan *plan, float xu, float yu, int width, int height,
+    float *res, lf_u32 *mask)
+{
+    return plan->ApplyGeometryDistortionMask (xu, yu, width, height, res, mask);
+}
+
+cbool lf_modifier_plan_apply_subpixel_distortion (
+    const lfModifierPlan *plan, float xu, float yu, int width, int height, float *res)
+{
+    return plan->ApplySubpixelDistortion (xu, yu, width, height, res);
+}
+
+cbool lf_modifier_plan_apply_subpixel_geometry_distortion (
+    const lfModifierPlan *plan, float xu, float yu, int width, int height, float *res)
+{
+    return plan->ApplySubpixelGeometryDistortion (xu, yu, width, height, res);
+}
+
+cbool lf_modifier_plan_apply_subpixel_distortion_planar (
+    const lfModifierPlan *plan, float xu, float yu, int width, int height,
+    float *const *res_x, float *const *res_y, int row_stride)
+{
+    return plan->ApplySubpixelDistortion (xu, yu, width, height, res_x, res_y, row_stride);
+}
+
+cbool lf_modifier_plan_apply_subpixel_geometry_distortion_planar (
+    const lfModifierPlan *plan, float xu, float yu, int width, int height,
+    float *const *res_x, float *const *res_y, int row_stride)
+{
+    return plan->ApplySubpixelGeometryDistortion (xu, yu, width, height,
+                                                  res_x, res_y, row_stride);
+}
+
+cbool lf_modifier_plan_apply_subpixel_distortion_channels (
+    const lfModifierPlan *plan, float xu, float yu, int width, int height,
+    float *const *res, int row_stride)
+{
+    return plan->ApplySubpixelDistortion (xu, yu, width, height, res, row_stride);
+}
+
+cbool lf_modifier_plan_apply_subpixel_geometry_distortion_channels (
+    const lfModifierPlan *plan, float xu, float yu, int width, int height,
+    float *const *res, int row_stride)
+{
+    return plan->ApplySubpixelGeometryDistortion (xu, yu, width, height, res, row_stride);
+}
+
+cbool lf_modifier_plan_apply_subpixel_distortion_cfa (
+    const lfModifierPlan *plan, float xu, float yu, int width, int height,
+    const unsigned char *cfa, int cfa_size, float *res)
+{
+    return plan->ApplySubpixelDistortionCFA (xu, yu, width, height, cfa, cfa_size, res);
+}
+
+cbool lf_modifier_plan_apply_subpixel_geometry_distortion_cfa (
+    const lfModifierPlan *plan, float xu, float yu, int width, int height,
+    const unsigned char *cfa, int cfa_size, float *res)
+{
+    return plan->ApplySubpixelGeometryDistortionCFA (xu, yu, width, height, cfa, cfa_size, res);
+}
@@ -4,6 +4,8 @@
 #define _USE_MATH_DEFINES
 #endif
 #include <cmath>
+#include <vector>
+#include <algorithm>
 #include "lensfun.h"
 
 typedef struct {
@@ -122,6 +124,184 @@ void test_mod_projection_borders(lfFixture* lfFix, gconstpointer data)
     }
 }
 
+// the direct conversions between rectilinear and fisheye-like projections
+// have to agree with the way via equirectangular
+void test_mod_projection_direct(lfFixture* lfFix, gconstpointer data)
+{
+    (void)data;
+    lfLensType geom_types [] = {LF_FISHEYE_ORTHOGRAPHIC, LF_FISHEYE_STEREOGRAPHIC, LF_FISHEYE_EQUISOLID, LF_FISHEYE_THOBY, LF_UNKNOWN};
+    for (int j = 0; geom_types[j] != LF_UNKNOWN; j++) {
+        for (int to_rect = 0; to_rect < 2; to_rect++) {
+            const lfLensType source = to_rect ? geom_types[j] : LF_RECTILINEAR;
+            const lfLensType target = to_rect ? LF_RECTILINEAR : geom_types[j];
+
+            lfFix->lens->Type = source;
+            lfModifier direct (lfFix->lens, 12.0f, 1.0f, lfFix->img_width, lfFix->img_height, LF_PF_U8, false);
+            direct.EnableProjectionTransform(target);
+
+            // target -> equirectangular, then equirectangular -> source
+            lfFix->lens->Type = LF_EQUIRECTANGULAR;
+            lfModifier first (lfFix->lens, 12.0f, 1.0f, lfFix->img_width, lfFix->img_height, LF_PF_U8, false);
+            first.EnableProjectionTransform(target);
+            lfFix->lens->Type = source;
+            lfModifier second (lfFix->lens, 12.0f, 1.0f, lfFix->img_width, lfFix->img_height, LF_PF_U8, false);
+            second.EnableProjectionTransform(LF_EQUIRECTANGULAR);
+
+            for (size_t y = 0; y < lfFix->img_height; y += 5) {
+                for (size_t x = 0; x < lfFix->img_width; x += 5) {
+                    float res[2], erect[2], ref[2];
+                    g_assert_true(direct.ApplyGeometryDistortion(x, y, 1, 1, res));
+                    g_assert_true(first.ApplyGeometryDistortion(x, y, 1, 1, erect));
+                    g_assert_true(second.ApplyGeometryDistortion(erect[0], erect[1], 1, 1, ref));
+                    // skip points without a counterpart in the other projection,
+                    // and the centre of the stereographic projection, which
+                    // the way via equirectangular doesn't handle
+                    if (fabs(res[0]) > 1e4 || fabs(res[1]) > 1e4 || fabs(ref[0]) > 1e4 || fabs(ref[1]) > 1e4 ||
+                        fabs(erect[0]) > 1e4 || fabs(erect[1]) > 1e4)
+                        continue;
+                    for (int i = 0; i < 2; i++)
+                        g_assert_cmpfloat(fabs(res[i] - ref[i]), <=, 2e-3 + 2e-5 * fabs(ref[i]));
+                }
+            }
+        }
+    }
+}
+
+// a plan gives the same coordinates as the modifier it was compiled from,
+// also tile by tile with one scratch buffer for all tiles
+void test_mod_plan(lfFixture* lfFix, gconstpointer data)
+{
+    (void)data;
+    const int width = lfFix->img_width, height = lfFix->img_height;
+    lfModifier ref (lfFix->lens, 12.0f, 1.0f, width, height, LF_PF_U8, false);
+    ref.EnableDistortionCorrection();
+    ref.EnableScaling(1.1f);
+
+    lfModifier *mod = new lfModifier (lfFix->lens, 12.0f, 1.0f, width, height, LF_PF_U8, false);
+    mod->EnableDistortionCorrection();
+    mod->EnableScaling(1.1f);
+    const lfModifierPlan plan (mod);
+    g_assert_cmpint(plan.GetModFlags(), ==, ref.GetModFlags());
+
+    std::vector<float> expected (size_t (width) * height * 2), expected_jac (size_t (width) * height * 4);
+    g_assert_true(ref.ApplyGeometryDistortionJacobian(0, 0, width, height, &expected[0], &expected_jac[0]));
+
+    const int tile = 64;
+    std::vector<float> scratch (lfModifierPlan::GetJacobianScratchSize(tile, tile));
+    std::vector<float> res (tile * tile * 2), jac (tile * tile * 4);
+    for (int ty = 0; ty < height; ty += tile) {
+        for (int tx = 0; tx < width; tx += tile) {
+            const int tw = std::min(tile, width - tx), th = std::min(tile, height - ty);
+            g_assert_true(plan.ApplyGeometryDistortionJacobian(tx, ty, tw, th, &res[0], &jac[0], &scratch[0]));
+            for (int y = 0; y < th; y++) {
+                for (int x = 0; x < tw; x++) {
+                    const size_t i = size_t (y) * tw + x, k = size_t (ty + y) * width + tx + x;
+                    for (int c = 0; c < 2; c++)
+                        g_assert_cmpfloat(fabs(res[i * 2 + c] - expected[k * 2 + c]), <=, 1e-3);
+                    for (int c = 0; c < 4; c++)
+                        g_assert_cmpfloat(fabs(jac[i * 4 + c] - expected_jac[k * 4 + c]), <=, 1e-3);
+                }
+            }
+        }
+    }
+}
+
+// one thread's share of the tiles in test_mod_plan_threads
+typedef struct {
+    const lfModifierPlan *plan;
+    int width, height, tile, first, step;
+    float *geom_x, *geom_y, *subpix[3], *subpix_x[3], *subpix_y[3];
+    bool ok;
+} lfPlanThread;
+
+static gpointer apply_plan_tiles(gpointer data)
+{
+    lfPlanThread *t = (lfPlanThread *)data;
+    const int tiles_x = (t->width + t->tile - 1) / t->tile, tiles_y = (t->height + t->tile - 1) / t->tile;
+    const int plane_stride = t->width * sizeof(float), map_stride = 2 * plane_stride;
+    t->ok = true;
+    for (int n = t->first; n < tiles_x * tiles_y; n += t->step) {
+        const int tx = n % tiles_x * t->tile, ty = n / tiles_x * t->tile;
+        const int tw = std::min(t->tile, t->width - tx), th = std::min(t->tile, t->height - ty);
+        const size_t k = size_t (ty) * t->width + tx;
+        float *maps[3], *planes_x[3], *planes_y[3];
+        for (int c = 0; c < 3; c++) {
+            maps[c] = t->subpix[c] + 2 * k;
+            planes_x[c] = t->subpix_x[c] + k;
+            planes_y[c] = t->subpix_y[c] + k;
+        }
+        t->ok = t->ok && t->plan->ApplyGeometryDistortion(tx, ty, tw, th, t->geom_x + k, t->geom_y + k, plane_stride);
+        t->ok = t->ok && t->plan->ApplySubpixelGeometryDistortion(tx, ty, tw, th, maps, map_stride);
+        t->ok = t->ok && lf_modifier_plan_apply_subpixel_distortion_planar(t->plan, tx, ty, tw, th,
+                                                                           planes_x, planes_y, plane_stride);
+    }
+    return NULL;
+}
+
+// several threads apply one plan to their own tiles at the same time, and
+// write into shared maps; together they give the same maps as the modifier
+// the plan was compiled from
+void test_mod_plan_threads(lfFixture* lfFix, gconstpointer data)
+{
+    (void)data;
+    const int width = lfFix->img_width, height = lfFix->img_height;
+    lfLensCalibAttributes lensSetting = { 1.0, 1.0 };
+    lfLensCalibTCA lensCalibTCA = {LF_TCA_MODEL_LINEAR, 12.0f, {1.0003f, 0.9997f}, lensSetting};
+    lfFix->lens->AddCalibTCA(&lensCalibTCA);
+
+    lfModifier ref (lfFix->lens, 12.0f, 1.0f, width, height, LF_PF_U8, false);
+    ref.EnableDistortionCorrection();
+    ref.EnableTCACorrection();
+    ref.EnableScaling(1.1f);
+
+    lfModifier *mod = new lfModifier (lfFix->lens, 12.0f, 1.0f, width, height, LF_PF_U8, false);
+    mod->EnableDistortionCorrection();
+    mod->EnableTCACorrection();
+    mod->EnableScaling(1.1f);
+    const lfModifierPlan plan (mod);
+
+    const size_t pixels = size_t (width) * height;
+    std::vector<float> expected (pixels * 2), expected_subpix (pixels * 6), expected_tca (pixels * 6);
+    g_assert_true(ref.ApplyGeometryDistortion(0, 0, width, height, &expected[0]));
+    g_assert_true(ref.ApplySubpixelGeometryDistortion(0, 0, width, height, &expected_subpix[0]));
+    g_assert_true(ref.ApplySubpixelDistortion(0, 0, width, height, &expected_tca[0]));
+
+    std::vector<float> geom (pixels * 2), subpix (pixels * 6), subpix_planes (pixels * 6);
+    const int threads = 4;
+    lfPlanThread work[threads];
+    GThread *thread[threads];
+    for (int i = 0; i < threads; i++) {
+        work[i].plan = &plan;
+        work[i].width = width;
+        work[i].height = height;
+        work[i].tile = 32;
+        work[i].first = i;
+        work[i].step = threads;
+        work[i].geom_x = &geom[0];
+        work[i].geom_y = &geom[pixels];
+        for (int c = 0; c < 3; c++) {
+            work[i].subpix[c] = &subpix[pixels * 2 * c];
+            work[i].subpix_x[c] = &subpix_planes[pixels * 2 * c];
+            work[i].subpix_y[c] = &subpix_planes[pixels * (2 * c + 1)];
+        }
+        thread[i] = g_thread_new("plan", apply_plan_tiles, &work[i]);
+    }
+    for (int i = 0; i < threads; i++) {
+        g_thread_join(thread[i]);
+        g_assert_true(work[i].ok);
+    }
+
+    for (size_t k = 0; k < pixels; k++) {
+        g_assert_cmpfloat(fabs(geom[k] - expected[k * 2]), <=, 1e-3);
+        g_assert_cmpfloat(fabs(geom[pixels + k] - expected[k * 2 + 1]), <=, 1e-3);
+        for (int c = 0; c < 3; c++)
+            for (int i = 0; i < 2; i++) {
+                g_assert_cmpfloat(fabs(subpix[pixels * 2 * c + k * 2 + i] - expected_subpix[k * 6 + c * 2 + i]), <=, 1e-3);
+                g_assert_cmpfloat(fabs(subpix_planes[pixels * (2 * c + i) + k] - expected_tca[k * 6 + c * 2 + i]), <=, 1e-3);
+            }
+    }
+}
+
 
 int main (int argc, char **argv)
 {
@@ -132,6 +312,9 @@ int main (int argc, char **argv)
 
     g_test_add("/modifier/projection center", lfFixture, NULL, mod_setup, test_mod_projection_center, mod_teardown);
     g_test_add("/modifier/projection borders", lfFixture, NULL, mod_setup, test_mod_projection_borders, mod_teardown);
+    g_test_add("/modifier/projection direct", lfFixture, NULL, mod_setup, test_mod_projection_direct, mod_teardown);
+    g_test_add("/modifier/plan", lfFixture, NULL, mod_setup, test_mod_plan, mod_teardown);
+    g_test_add("/modifier/plan threads", lfFixture, NULL, mod_setup, test_mod_plan_threads, mod_teardown);
 
     return g_test_run();
 }
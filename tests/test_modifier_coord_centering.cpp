@@ -82,10 +82,10 @@ void test_mod_coord_distortion (lfFixture *lfFix, gconstpointer data)
     lfFix->mod->EnableDistortionCorrection();
 
     const float epsilon = 1e-3f;
-    float expected_x[] = {-2.2818394f, 98.536278f, 199.12755f, 299.52982f, 400.0f,
-                          500.0f, 600.0f, 700.0f, 800.0f, 900.0f};
-    float expected_y[] = {-1.5687886f, 99.059074f, 199.49104f, 299.76492f, 400.0f,
-                          500.0f, 600.0f, 700.0f, 800.0f, 900.0f};
+    float expected_x[] = {-2.2818394f, 98.536278f, 199.12755f, 299.52982f, 399.78061f,
+                          499.91666f, 599.97449f, 699.99023f, 800.0f, 900.03980f};
+    float expected_y[] = {-1.5688280f, 99.059036f, 199.49104f, 299.76492f, 399.91773f,
+                          499.98612f, 600.00635f, 700.01465f, 800.04694f, 900.13934f};
     std::vector<float> coords (2);
     for (int i = 0; i < 10; i++)
     {
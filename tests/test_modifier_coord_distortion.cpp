@@ -11,6 +11,7 @@
 #include <cmath>
 
 #include "lensfun.h"
+#include "../libs/lensfun/lensfunprv.h"
 
 #include "common_code.hpp"
 
@@ -84,6 +85,498 @@ void test_mod_coord_distortion(lfFixture *lfFix, gconstpointer data)
   }
 }
 
+// Whole rows take the vectorized code paths, single pixels only the plain
+// code which handles the remainder of the rows.  Both must agree; the
+// tolerance is dominated by the plain Newton iterations, which stop as soon as
+// the residual is below NEWTON_EPS in normalized coordinates.
+void test_mod_coord_distortion_vectorized(lfFixture *lfFix, gconstpointer data)
+{
+  (void)data;
+  for(size_t y = 0; y < lfFix->img_height; y++)
+  {
+    float *coordData = (float *)lfFix->coordBuff + (size_t)2 * y * lfFix->img_width;
+
+    g_assert_true(
+      lfFix->mod->ApplyGeometryDistortion(0.0, y, lfFix->img_width, 1, coordData)
+    );
+
+    for(size_t x = 0; x < lfFix->img_width; x++)
+    {
+      float ref[2];
+      g_assert_true(lfFix->mod->ApplyGeometryDistortion(x, y, 1, 1, ref));
+
+      for(int i = 0; i < 2; i++)
+      {
+        if(std::isnan(ref[i]))
+          g_assert_true(std::isnan(coordData[2 * x + i]));
+        else
+          g_assert_cmpfloat(fabs(coordData[2 * x + i] - ref[i]), <=, 1e-2);
+      }
+    }
+  }
+}
+
+// Distortion, projection, and scaling may run as a single fused pass in
+// ApplyGeometryDistortion, while ApplySubpixelGeometryDistortion always runs
+// the callbacks one after another.  Without TCA correction, all three
+// subpixel coordinates must match the fused result.
+void test_mod_coord_distortion_fused(lfFixture *lfFix, gconstpointer data)
+{
+  lfTestParams *p = (lfTestParams *)data;
+
+  // Without a projection change, a single stage; the others make chains of
+  // stages, see ModifyCoordRow_AVX2
+  const lfLensType projections[] = { LF_RECTILINEAR, LF_EQUIRECTANGULAR, LF_PANORAMIC };
+  for(lfLensType projection : projections)
+  {
+    lfModifier mod(lfFix->lens, 24.0f, 1.0f, lfFix->img_width, lfFix->img_height, LF_PF_F32, p->reverse);
+    mod.EnableDistortionCorrection();
+    if(projection != LF_RECTILINEAR)
+      mod.EnableProjectionTransform(projection);
+    mod.EnableScaling(p->reverse ? 0.9f : 1.1f);
+
+    std::vector<float> subpix(6 * lfFix->img_width);
+    for(size_t y = 0; y < lfFix->img_height; y++)
+    {
+      float *coordData = (float *)lfFix->coordBuff + (size_t)2 * y * lfFix->img_width;
+
+      g_assert_true(mod.ApplyGeometryDistortion(0.0, y, lfFix->img_width, 1, coordData));
+      g_assert_true(mod.ApplySubpixelGeometryDistortion(0.0, y, lfFix->img_width, 1, &subpix[0]));
+
+      for(size_t x = 0; x < lfFix->img_width; x++)
+      {
+        // The projections lead some points through huge radii, which
+        // magnify the rounding differences, so they get a larger tolerance,
+        // and far outside of the image, nothing is compared at all.
+        const float *c = &subpix[6 * x];
+        const float w = lfFix->img_width, h = lfFix->img_height;
+        const bool near = c[0] > -w && c[0] < 2 * w && c[1] > -h && c[1] < 2 * h;
+        for(int i = 0; i < 6; i++)
+        {
+          const float ref = subpix[6 * x + i];
+          if(std::isnan(ref))
+            g_assert_true(std::isnan(coordData[2 * x + i % 2]));
+          else if(projection == LF_RECTILINEAR)
+            g_assert_cmpfloat(fabs(coordData[2 * x + i % 2] - ref), <=, 1e-2);
+          else if(near)
+            g_assert_cmpfloat(fabs(coordData[2 * x + i % 2] - ref), <=, 5e-2);
+        }
+      }
+    }
+  }
+}
+
+// The sparse grid must stay within the error it estimates, which holds for
+// the smooth distortion models here although it is not a guaranteed bound.
+void test_mod_coord_distortion_grid(lfFixture *lfFix, gconstpointer data)
+{
+  lfTestParams *p = (lfTestParams *)data;
+
+  lfModifier mod(lfFix->lens, 24.0f, 1.0f, lfFix->img_width, lfFix->img_height, LF_PF_F32, p->reverse);
+  mod.EnableDistortionCorrection();
+
+  const float max_error = 0.05f;
+  const float error = mod.EnableGridInterpolation(max_error);
+  g_assert_cmpfloat(error, >=, 0.0f);
+  g_assert_cmpfloat(error, <=, max_error);
+
+  std::vector<float> ref(2 * lfFix->img_width);
+  for(size_t y = 0; y < lfFix->img_height; y++)
+  {
+    float *coordData = (float *)lfFix->coordBuff + (size_t)2 * y * lfFix->img_width;
+
+    g_assert_true(mod.ApplyGeometryDistortion(0.0, y, lfFix->img_width, 1, coordData));
+    g_assert_true(lfFix->mod->ApplyGeometryDistortion(0.0, y, lfFix->img_width, 1, &ref[0]));
+
+    for(size_t x = 0; x < lfFix->img_width; x++)
+    {
+      if(std::isnan(ref[2 * x]))
+        g_assert_true(std::isnan(coordData[2 * x]));
+      else
+        g_assert_cmpfloat(hypot(coordData[2 * x] - ref[2 * x], coordData[2 * x + 1] - ref[2 * x + 1]),
+                          <=, error + 1e-3);
+    }
+  }
+}
+
+// The planar variant must give the same coordinates as the interleaved one,
+// with the fused kernel, the plain callbacks and the sparse grid.  The planes
+// are padded to check the row stride.
+void test_mod_coord_distortion_planar(lfFixture *lfFix, gconstpointer data)
+{
+  lfTestParams *p = (lfTestParams *)data;
+
+  lfModifier fused(lfFix->lens, 24.0f, 1.0f, lfFix->img_width, lfFix->img_height, LF_PF_F32, p->reverse);
+  fused.EnableDistortionCorrection();
+  fused.EnableScaling(p->reverse ? 0.9f : 1.1f);
+
+  lfModifier grid(lfFix->lens, 24.0f, 1.0f, lfFix->img_width, lfFix->img_height, LF_PF_F32, p->reverse);
+  grid.EnableDistortionCorrection();
+  grid.EnableGridInterpolation(0.05f);
+
+  const lfModifier *mods[] = { lfFix->mod, &fused, &grid };
+  const size_t stride = lfFix->img_width + 5;
+  std::vector<float> planes(2 * stride * lfFix->img_height);
+  float *res_x = &planes[0], *res_y = &planes[stride * lfFix->img_height];
+
+  for(int m = 0; m < 3; m++)
+  {
+    g_assert_true(mods[m]->ApplyGeometryDistortion(0.0, 0.0, lfFix->img_width, lfFix->img_height,
+                                                   (float *)lfFix->coordBuff));
+    g_assert_true(mods[m]->ApplyGeometryDistortion(0.0, 0.0, lfFix->img_width, lfFix->img_height,
+                                                   res_x, res_y, stride * sizeof(float)));
+
+    for(size_t y = 0; y < lfFix->img_height; y++)
+    {
+      const float *coordData = (float *)lfFix->coordBuff + (size_t)2 * y * lfFix->img_width;
+      for(size_t x = 0; x < lfFix->img_width; x++)
+      {
+        const float planar[2] = { res_x[y * stride + x], res_y[y * stride + x] };
+        for(int i = 0; i < 2; i++)
+        {
+          if(std::isnan(coordData[2 * x + i]))
+            g_assert_true(std::isnan(planar[i]));
+          else
+            g_assert_cmpfloat(planar[i], ==, coordData[2 * x + i]);
+        }
+      }
+    }
+  }
+}
+
+// The Jacobian variant must give the same coordinates as the plain one, and
+// derivatives which agree with differences of single pixels half a pixel
+// apart.  Tiles exercise the bands and the borders.
+void test_mod_coord_distortion_jacobian(lfFixture *lfFix, gconstpointer data)
+{
+  (void)data;
+  const int tiles[][4] = { { 0, 0, (int)lfFix->img_width, (int)lfFix->img_height }, { 101, 37, 95, 23 } };
+  for(auto &tile : tiles)
+  {
+    const size_t count = (size_t)tile[2] * tile[3];
+    std::vector<float> res(2 * count), jacobian(4 * count);
+    float *coordData = (float *)lfFix->coordBuff;
+    g_assert_true(lfFix->mod->ApplyGeometryDistortion(tile[0], tile[1], tile[2], tile[3], coordData));
+    g_assert_true(lfFix->mod->ApplyGeometryDistortionJacobian(tile[0], tile[1], tile[2], tile[3],
+                                                              &res[0], &jacobian[0]));
+
+    for(int y = 0; y < tile[3]; y += 3)
+      for(int x = 0; x < tile[2]; x += 3)
+      {
+        const size_t i = (size_t)y * tile[2] + x;
+        if(std::isnan(coordData[2 * i]) || std::isnan(coordData[2 * i + 1]))
+          continue;
+        g_assert_cmpfloat(fabs(res[2 * i] - coordData[2 * i]), <=, 1e-3);
+        g_assert_cmpfloat(fabs(res[2 * i + 1] - coordData[2 * i + 1]), <=, 1e-3);
+
+        float ref[4][2];
+        const float offsets[4][2] = { { 0.25f, 0 }, { -0.25f, 0 }, { 0, 0.25f }, { 0, -0.25f } };
+        for(int k = 0; k < 4; k++)
+          g_assert_true(lfFix->mod->ApplyGeometryDistortion(tile[0] + x + offsets[k][0],
+                                                            tile[1] + y + offsets[k][1], 1, 1, ref[k]));
+        const float expected[4] = { 2 * (ref[0][0] - ref[1][0]), 2 * (ref[2][0] - ref[3][0]),
+                                    2 * (ref[0][1] - ref[1][1]), 2 * (ref[2][1] - ref[3][1]) };
+        for(int k = 0; k < 4; k++)
+          if(!std::isnan(jacobian[4 * i + k]) && !std::isnan(expected[k]))
+            g_assert_cmpfloat(fabs(jacobian[4 * i + k] - expected[k]), <=, 1e-2);
+      }
+  }
+}
+
+// The mask must mark exactly the pixels with coordinates in the image, and
+// the coordinates must agree with the plain variant.  The scaled modifier
+// maps parts of the image outside.
+void test_mod_coord_distortion_mask(lfFixture *lfFix, gconstpointer data)
+{
+  lfTestParams *p = (lfTestParams *)data;
+
+  lfModifier scaled(lfFix->lens, 24.0f, 1.0f, lfFix->img_width, lfFix->img_height, LF_PF_F32, p->reverse);
+  scaled.EnableDistortionCorrection();
+  scaled.EnableScaling(p->reverse ? 1.3f : 0.7f);
+
+  const lfModifier *mods[] = { lfFix->mod, &scaled };
+  const size_t words = (lfFix->img_width + 31) / 32;
+  std::vector<lf_u32> mask(words * lfFix->img_height);
+  std::vector<float> res(2 * lfFix->img_width * lfFix->img_height);
+  for(int m = 0; m < 2; m++)
+  {
+    float *coordData = (float *)lfFix->coordBuff;
+    g_assert_true(mods[m]->ApplyGeometryDistortion(0.0, 0.0, lfFix->img_width, lfFix->img_height, coordData));
+    g_assert_true(mods[m]->ApplyGeometryDistortionMask(0.0, 0.0, lfFix->img_width, lfFix->img_height,
+                                                       &res[0], &mask[0]));
+
+    size_t valid = 0;
+    for(size_t y = 0; y < lfFix->img_height; y++)
+      for(size_t x = 0; x < lfFix->img_width; x++)
+      {
+        const size_t i = y * lfFix->img_width + x;
+        const float cx = res[2 * i], cy = res[2 * i + 1];
+        const bool inside = cx >= 0 && cx <= lfFix->img_width - 1 && cy >= 0 && cy <= lfFix->img_height - 1;
+        const bool bit = (mask[y * words + x / 32] >> (x % 32)) & 1;
+        g_assert_cmpint(bit, ==, inside);
+        valid += bit;
+        if(std::isnan(coordData[2 * i]))
+          g_assert_true(std::isnan(cx));
+        else
+          g_assert_cmpfloat(cx, ==, coordData[2 * i]);
+      }
+    if(m == 1)
+      g_assert_cmpint(valid, <, lfFix->img_width * lfFix->img_height);
+  }
+}
+
+// The source region of a tile must hold the coordinates of all of its
+// pixels, and the target region of a rectangle all pixels whose coordinates
+// lie in it.  Both may only be a little larger than necessary.  The target
+// region consists of whole pixels of the image, also where the rectangle
+// reaches outside of it, exactly like the search through all pixels.
+// Interpolation on a grid must be taken into account.
+void test_mod_coord_distortion_region(lfFixture *lfFix, gconstpointer data)
+{
+  (void)data;
+  const int width = lfFix->img_width, height = lfFix->img_height;
+  const float last[2] = { (float)width - 1, (float)height - 1 };
+  float *coordData = (float *)lfFix->coordBuff;
+
+  for(int grid = 0; grid < 2; grid++)
+  {
+    if(grid && lfFix->mod->EnableGridInterpolation(0.05f) < 0.0f)
+      break;
+    g_assert_true(lfFix->mod->ApplyGeometryDistortion(0.0, 0.0, width, height, coordData));
+
+    const int tiles[][4] = { { 0, 0, width, height }, { 101, 37, 95, 23 }, { 250, 3, 40, 40 },
+                             { -30, 120, 80, 60 }, { 240, -40, 100, 90 } };
+    for(auto &tile : tiles)
+    {
+      float region[4], bounds[4] = { INFINITY, INFINITY, -INFINITY, -INFINITY };
+      const bool inside = tile[0] >= 0 && tile[1] >= 0 &&
+                          tile[0] + tile[2] <= width && tile[1] + tile[3] <= height;
+      for(int y = tile[1]; inside && y < tile[1] + tile[3]; y++)
+        for(int x = tile[0]; x < tile[0] + tile[2]; x++)
+        {
+          const float *c = coordData + 2 * (y * width + x);
+          if(std::isnan(c[0]) || std::isnan(c[1]))
+            continue;
+          bounds[0] = std::min(bounds[0], c[0]);
+          bounds[1] = std::min(bounds[1], c[1]);
+          bounds[2] = std::max(bounds[2], c[0]);
+          bounds[3] = std::max(bounds[3], c[1]);
+        }
+      if(inside)
+      {
+        g_assert_true(lfFix->mod->GetSourceRegion(tile[0], tile[1], tile[2], tile[3], region));
+        for(int i = 0; i < 2; i++)
+        {
+          g_assert_cmpfloat(region[i], <=, bounds[i] + 1e-3);
+          g_assert_cmpfloat(region[i + 2], >=, bounds[i + 2] - 1e-3);
+          g_assert_cmpfloat(region[i], >=, bounds[i] - 1);
+          g_assert_cmpfloat(region[i + 2], <=, bounds[i + 2] + 1);
+        }
+      }
+
+      const float x1 = tile[0] + tile[2] - 1, y1 = tile[1] + tile[3] - 1;
+      bool found = false;
+      for(int i = 0; i < 4; i++)
+        bounds[i] = i < 2 ? INFINITY : -INFINITY;
+      for(int y = 0; y < height; y++)
+        for(int x = 0; x < width; x++)
+        {
+          const float *c = coordData + 2 * (y * width + x);
+          if(c[0] >= tile[0] && c[0] <= x1 && c[1] >= tile[1] && c[1] <= y1)
+          {
+            bounds[0] = std::min(bounds[0], (float)x);
+            bounds[1] = std::min(bounds[1], (float)y);
+            bounds[2] = std::max(bounds[2], (float)x);
+            bounds[3] = std::max(bounds[3], (float)y);
+            found = true;
+          }
+        }
+      g_assert_cmpint(lfFix->mod->GetTargetRegion(tile[0], tile[1], tile[2], tile[3], region), ==, found);
+      if(found)
+        for(int i = 0; i < 2; i++)
+        {
+          g_assert_cmpfloat(region[i], ==, floorf(region[i]));
+          g_assert_cmpfloat(region[i + 2], ==, floorf(region[i + 2]));
+          g_assert_cmpfloat(region[i], >=, 0.0f);
+          g_assert_cmpfloat(region[i + 2], <=, last[i]);
+          g_assert_cmpfloat(region[i], <=, bounds[i]);
+          g_assert_cmpfloat(region[i + 2], >=, bounds[i + 2]);
+          g_assert_cmpfloat(region[i], >=, bounds[i] - 2);
+          g_assert_cmpfloat(region[i + 2], <=, bounds[i + 2] + 2);
+        }
+    }
+  }
+}
+
+// Every pixel of the crop must have a source pixel, and a slightly larger
+// crop must not
+static void check_crop(const lfModifier *mod, const float *last, float aspect, float *crop)
+{
+  g_assert_true(mod->GetAutoCrop(aspect, crop));
+  const float expected = aspect > 0.0f ? aspect : last[0] / last[1];
+  g_assert_cmpfloat(fabs((crop[2] - crop[0]) / (crop[3] - crop[1]) - expected), <=, 1e-3);
+
+  for(int grow = 0; grow < 2; grow++)
+  {
+    const int x0 = (int)ceil(crop[0]) - 2 * grow, y0 = (int)ceil(crop[1]) - 2 * grow;
+    const int w = (int)floor(crop[2]) + 2 * grow - x0 + 1, h = (int)floor(crop[3]) + 2 * grow - y0 + 1;
+    std::vector<float> coords(2 * (size_t)w * h);
+    g_assert_true(mod->ApplyGeometryDistortion(x0, y0, w, h, &coords[0]));
+    bool valid = true;
+    for(size_t i = 0; i < coords.size(); i += 2)
+      valid &= coords[i] >= 0.0f && coords[i] <= last[0] && coords[i + 1] >= 0.0f && coords[i + 1] <= last[1];
+    g_assert_cmpint(valid, ==, !grow);
+  }
+}
+
+void test_mod_coord_distortion_crop(lfFixture *lfFix, gconstpointer data)
+{
+  lfTestParams *p = (lfTestParams *)data;
+  const float last[2] = { (float)lfFix->img_width - 1, (float)lfFix->img_height - 1 };
+  const float aspects[] = { 0.0f, 1.0f, 2.5f, 0.4f };
+  float crop[4];
+  for(float aspect : aspects)
+    check_crop(lfFix->mod, last, aspect, crop);
+
+  // With the centre of distortion off the image centre, the outline is
+  // lopsided, and the crop must follow it
+  lfLens lens(*lfFix->lens);
+  lens.CenterX = 0.1f;
+  lens.CenterY = -0.05f;
+  lfModifier mod(&lens, 24.0f, 1.0f, lfFix->img_width, lfFix->img_height, LF_PF_F32, p->reverse);
+  mod.EnableDistortionCorrection();
+  for(float aspect : aspects)
+    check_crop(&mod, last, aspect, crop);
+
+  std::vector<float> outline(2 * 64);
+  g_assert_true(lfFix->mod->GetValidOutline(64, &outline[0]));
+  for(int i = 0; i < 64; i++)
+  {
+    float inside[2], outside[2];
+    for(int j = 0; j < 2; j++)
+    {
+      const float centre = last[j] / 2;
+      inside[j] = centre + (outline[i * 2 + j] - centre) * 0.999f;
+      outside[j] = centre + (outline[i * 2 + j] - centre) * 1.01f;
+    }
+    lfFix->mod->ApplyGeometryDistortion(inside[0], inside[1], 1, 1, inside);
+    lfFix->mod->ApplyGeometryDistortion(outside[0], outside[1], 1, 1, outside);
+    g_assert_true(inside[0] >= 0.0f && inside[0] <= last[0] && inside[1] >= 0.0f && inside[1] <= last[1]);
+    g_assert_false(outside[0] >= 0.0f && outside[0] <= last[0] && outside[1] >= 0.0f && outside[1] <= last[1]);
+  }
+}
+
+// Radial chains may reflect the results for pixels which mirror others about
+// the lens centre.  Whole images and odd tiles must agree with single pixels,
+// also for an off-centre lens where there are no mirror images.
+void test_mod_coord_distortion_symmetry(lfFixture *lfFix, gconstpointer data)
+{
+  lfTestParams *p = (lfTestParams *)data;
+
+  lfLens lens(*lfFix->lens);
+  for(int centered = 0; centered < 2; centered++)
+  {
+    lens.CenterX = centered ? 0.0f : 0.013f;
+    lens.CenterY = centered ? 0.0f : -0.021f;
+    lfModifier mod(&lens, 24.0f, 1.0f, lfFix->img_width, lfFix->img_height, LF_PF_F32, p->reverse);
+    mod.EnableDistortionCorrection();
+
+    const int tiles[][4] = { { 0, 0, (int)lfFix->img_width, (int)lfFix->img_height }, { 101, 37, 95, 123 } };
+    for(auto &tile : tiles)
+    {
+      float *coordData = (float *)lfFix->coordBuff;
+      g_assert_true(mod.ApplyGeometryDistortion(tile[0], tile[1], tile[2], tile[3], coordData));
+
+      for(int y = 0; y < tile[3]; y++)
+        for(int x = 0; x < tile[2]; x++)
+        {
+          float ref[2];
+          g_assert_true(mod.ApplyGeometryDistortion(tile[0] + x, tile[1] + y, 1, 1, ref));
+          for(int i = 0; i < 2; i++)
+          {
+            const float value = coordData[2 * (y * tile[2] + x) + i];
+            if(std::isnan(ref[i]))
+              g_assert_true(std::isnan(value));
+            else
+              g_assert_cmpfloat(fabs(value - ref[i]), <=, 1e-2);
+          }
+        }
+    }
+  }
+}
+
+// The plain row kernels, ModifyCoordRow_Dist and ModifyCoordRow_Radial, only
+// run without vector units, so the CPU features are hidden here.  They must
+// agree with the callbacks run one after another, and with the default
+// kernels.  The odd tile has no mirror images.
+void test_mod_coord_distortion_scalar(lfFixture *lfFix, gconstpointer data)
+{
+  lfTestParams *p = (lfTestParams *)data;
+
+  _lf_mask_cpu_features(0);
+  lfModifier mod(lfFix->lens, 24.0f, 1.0f, lfFix->img_width, lfFix->img_height, LF_PF_F32, p->reverse);
+  mod.EnableDistortionCorrection();
+
+  const int tiles[][4] = { { 0, 0, (int)lfFix->img_width, (int)lfFix->img_height }, { 101, 37, 95, 123 } };
+  for(auto &tile : tiles)
+  {
+    float *coordData = (float *)lfFix->coordBuff;
+    std::vector<float> ref(2 * tile[2] * tile[3]), subpix(6 * tile[2] * tile[3]);
+    g_assert_true(mod.ApplyGeometryDistortion(tile[0], tile[1], tile[2], tile[3], coordData));
+    g_assert_true(mod.ApplySubpixelGeometryDistortion(tile[0], tile[1], tile[2], tile[3], &subpix[0]));
+    g_assert_true(lfFix->mod->ApplyGeometryDistortion(tile[0], tile[1], tile[2], tile[3], &ref[0]));
+
+    for(int k = 0; k < tile[2] * tile[3]; k++)
+      for(int i = 0; i < 2; i++)
+      {
+        const float value = coordData[2 * k + i];
+        if(std::isnan(subpix[6 * k + i]))
+          g_assert_true(std::isnan(value));
+        else
+          g_assert_cmpfloat(fabs(value - subpix[6 * k + i]), <=, 1e-2);
+        if(std::isnan(ref[2 * k + i]))
+          g_assert_true(std::isnan(value));
+        else
+          g_assert_cmpfloat(fabs(value - ref[2 * k + i]), <=, 1e-2);
+      }
+  }
+  _lf_mask_cpu_features(~0u);
+}
+
+// The Newton inversion of the ACM model converges for all the calibrations
+// above, but not near the corners of a strongly distorted lens.  Every point
+// which fails is counted once, also when it is a single pixel.
+void test_mod_coord_distortion_unconverged(lfFixture *lfFix, gconstpointer data)
+{
+  lfTestParams *p = (lfTestParams *)data;
+
+  float *coordData = (float *)lfFix->coordBuff;
+  g_assert_true(lfFix->mod->ApplyGeometryDistortion(0, 0, lfFix->img_width, lfFix->img_height, coordData));
+  g_assert_cmpuint(lfFix->mod->GetUnconvergedCount(), ==, 0);
+
+  if(!p->reverse || p->calib.Model != LF_DIST_MODEL_ACM)
+    return;
+
+  lfLensCalibDistortion calib = p->calib;
+  calib.Terms[0] = -0.5f;
+  lfLens lens;
+  lens.Type = LF_RECTILINEAR;
+  lens.AddCalibDistortion(&calib);
+  lfModifier mod(&lens, calib.Focal, 1.0f, lfFix->img_width, lfFix->img_height, LF_PF_F32, true);
+  mod.EnableDistortionCorrection();
+
+  g_assert_true(mod.ApplyGeometryDistortion(0, 0, 1, 1, coordData));
+  g_assert_cmpuint(mod.GetUnconvergedCount(), ==, 1);
+  g_assert_true(mod.ApplyGeometryDistortion(lfFix->img_width / 2, lfFix->img_height / 2, 1, 1, coordData));
+  g_assert_cmpuint(mod.GetUnconvergedCount(), ==, 1);
+
+  g_assert_true(mod.ApplyGeometryDistortion(0, 0, lfFix->img_width, lfFix->img_height, coordData));
+  const unsigned long count = mod.GetUnconvergedCount() - 1;
+  g_assert_cmpuint(count, >, 0);
+  g_assert_cmpuint(count, <, lfFix->img_width * lfFix->img_height);
+  g_assert_cmpuint(lf_modifier_get_unconverged_count(&mod), ==, count + 1);
+}
+
 #ifdef _OPENMP
 void test_mod_coord_distortion_parallel(lfFixture *lfFix, gconstpointer data)
 {
@@ -123,6 +616,61 @@ void add_set_item(lfTestParams *p)
   g_free(desc);
   desc = NULL;
 
+  desc = describe(p, "modifier/coord/vectorized");
+  g_test_add(desc, lfFixture, p, mod_setup, test_mod_coord_distortion_vectorized, mod_teardown);
+  g_free(desc);
+  desc = NULL;
+
+  desc = describe(p, "modifier/coord/fused");
+  g_test_add(desc, lfFixture, p, mod_setup, test_mod_coord_distortion_fused, mod_teardown);
+  g_free(desc);
+  desc = NULL;
+
+  desc = describe(p, "modifier/coord/grid");
+  g_test_add(desc, lfFixture, p, mod_setup, test_mod_coord_distortion_grid, mod_teardown);
+  g_free(desc);
+  desc = NULL;
+
+  desc = describe(p, "modifier/coord/jacobian");
+  g_test_add(desc, lfFixture, p, mod_setup, test_mod_coord_distortion_jacobian, mod_teardown);
+  g_free(desc);
+  desc = NULL;
+
+  desc = describe(p, "modifier/coord/mask");
+  g_test_add(desc, lfFixture, p, mod_setup, test_mod_coord_distortion_mask, mod_teardown);
+  g_free(desc);
+  desc = NULL;
+
+  desc = describe(p, "modifier/coord/region");
+  g_test_add(desc, lfFixture, p, mod_setup, test_mod_coord_distortion_region, mod_teardown);
+  g_free(desc);
+  desc = NULL;
+
+  desc = describe(p, "modifier/coord/crop");
+  g_test_add(desc, lfFixture, p, mod_setup, test_mod_coord_distortion_crop, mod_teardown);
+  g_free(desc);
+  desc = NULL;
+
+  desc = describe(p, "modifier/coord/planar");
+  g_test_add(desc, lfFixture, p, mod_setup, test_mod_coord_distortion_planar, mod_teardown);
+  g_free(desc);
+  desc = NULL;
+
+  desc = describe(p, "modifier/coord/symmetry");
+  g_test_add(desc, lfFixture, p, mod_setup, test_mod_coord_distortion_symmetry, mod_teardown);
+  g_free(desc);
+  desc = NULL;
+
+  desc = describe(p, "modifier/coord/scalar");
+  g_test_add(desc, lfFixture, p, mod_setup, test_mod_coord_distortion_scalar, mod_teardown);
+  g_free(desc);
+  desc = NULL;
+
+  desc = describe(p, "modifier/coord/unconverged");
+  g_test_add(desc, lfFixture, p, mod_setup, test_mod_coord_distortion_unconverged, mod_teardown);
+  g_free(desc);
+  desc = NULL;
+
 #ifdef _OPENMP
   desc = describe(p, "modifier/coord/parallelFor");
   g_test_add(desc, lfFixture, p, mod_setup, test_mod_coord_distortion_parallel, mod_teardown);
@@ -172,13 +720,17 @@ int main(int argc, char **argv)
     {
       LF_DIST_MODEL_PTLENS, 24.0f, 24.46704f, false, {0.02964f, -0.07853f, 0.02943f}, cs
     };
+    distortCalib["LF_DIST_MODEL_ACM"] = lfLensCalibDistortion
+    {
+      LF_DIST_MODEL_ACM, 24.0f, 24.0f, false, {-0.0385f, 0.0061f, -0.0003f, 0.0012f, -0.0007f}, cs
+    };
 
     for(std::map<std::string, lfLensCalibDistortion>::iterator it_distortCalib = distortCalib.begin(); it_distortCalib != distortCalib.end(); ++it_distortCalib)
     {
       std::vector<size_t> align;
       align.push_back(0);
       align.push_back(4  * sizeof(float)); // SSE
-      //align.push_back(8  * sizeof(float)); // AVX
+      align.push_back(8  * sizeof(float)); // AVX
       //align.push_back(16 * sizeof(float)); // AVX512
 
       for(std::vector<size_t>::iterator it_align = align.begin(); it_align != align.end(); ++it_align)
@@ -11,6 +11,7 @@
 #include <cmath>
 
 #include "lensfun.h"
+#include "../libs/lensfun/lensfunprv.h"
 
 #include "common_code.hpp"
 
@@ -100,6 +101,49 @@ void test_mod_coord_geometry_parallel(lfFixture *lfFix, gconstpointer data)
 }
 #endif
 
+// Whole rows go through the vectorized callbacks (if the CPU has them),
+// single pixels through the plain code for the remainder
+void check_vectorized(lfFixture *lfFix, lfModifier *mod)
+{
+  float *coordData = (float *)lfFix->coordBuff;
+  float ref[6];
+  for(size_t y = 0; y < lfFix->img_height; y += 3)
+  {
+    g_assert_true(mod->ApplyGeometryDistortion(0.0, y, lfFix->img_width, 1, coordData));
+    for(size_t x = 0; x < lfFix->img_width; x++)
+    {
+      g_assert_true(mod->ApplySubpixelGeometryDistortion(x, y, 1, 1, ref));
+      for(int i = 0; i < 2; i++)
+      {
+        const float res = coordData[2 * x + i];
+        // Beyond the valid range of the projections, the results are
+        // arbitrary large numbers, or NaN
+        if(std::isnan(ref[i]) || fabs(ref[i]) > 1e5)
+          continue;
+        g_assert_cmpfloat(fabs(res - ref[i]), <=, 1e-3 + 1e-5 * fabs(ref[i]));
+      }
+    }
+  }
+}
+
+void test_mod_coord_geometry_vectorized(lfFixture *lfFix, gconstpointer data)
+{
+  (void)data;
+  check_vectorized(lfFix, lfFix->mod);
+}
+
+// The SSE2 callbacks are only used without AVX2, so it is hidden here
+void test_mod_coord_geometry_sse2(lfFixture *lfFix, gconstpointer data)
+{
+  lfTestParams *p = (lfTestParams *)data;
+
+  _lf_mask_cpu_features(~(guint)(LF_CPU_FLAG_AVX2 | LF_CPU_FLAG_FMA));
+  lfModifier mod(lfFix->lens, 24.0f, 1.0f, lfFix->img_width, lfFix->img_height, LF_PF_F32, p->reverse);
+  mod.EnableProjectionTransform(p->targetLensType);
+  check_vectorized(lfFix, &mod);
+  _lf_mask_cpu_features(~0u);
+}
+
 gchar *describe(lfTestParams *p, const char *prefix)
 {
   gchar alignment[32] = "";
@@ -124,6 +168,19 @@ void add_set_item(lfTestParams *p)
   g_free(desc);
   desc = NULL;
 
+  if(p->alignment == 0)
+  {
+    desc = describe(p, "modifier/coord/vectorized");
+    g_test_add(desc, lfFixture, p, mod_setup, test_mod_coord_geometry_vectorized, mod_teardown);
+    g_free(desc);
+    desc = NULL;
+
+    desc = describe(p, "modifier/coord/vectorizedSSE2");
+    g_test_add(desc, lfFixture, p, mod_setup, test_mod_coord_geometry_sse2, mod_teardown);
+    g_free(desc);
+    desc = NULL;
+  }
+
 #ifdef _OPENMP
   desc = describe(p, "modifier/coord/parallelFor");
   g_test_add(desc, lfFixture, p, mod_setup, test_mod_coord_geometry_parallel, mod_teardown);
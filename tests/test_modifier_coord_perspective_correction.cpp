@@ -1,4 +1,5 @@
 #include <string>
+#include <vector>
 #include <limits>
 #include <cmath>
 #include <locale>
@@ -226,6 +227,152 @@ void test_mod_coord_pc_7_points (lfFixture *lfFix, gconstpointer data)
     }
 }
 
+void test_mod_coord_pc_solution (lfFixture *lfFix, gconstpointer data)
+{
+    (void)data;
+    float x[] = {503, 1063, 509, 1066};
+    float y[] = {150, 197, 860, 759};
+    lfPerspectiveSolution solution;
+    g_assert_true (lfFix->mod->SolvePerspectiveCorrection (x, y, 4, &solution));
+    g_assert_false (lfFix->mod->GetModFlags () & LF_MODIFY_PERSPECTIVE);
+
+    // Moving the slider updates the correction, and gives the same result as
+    // solving from scratch
+    const float strengths[] = {0.0f, -0.5f, 0.7f};
+    for (float d : strengths)
+    {
+        g_assert_true (lfFix->mod->EnablePerspectiveCorrection (&solution, d) & LF_MODIFY_PERSPECTIVE);
+        lfModifier mod (lfFix->lens, lfFix->focal, 1.534f, lfFix->img_width, lfFix->img_height, LF_PF_F32, false);
+        g_assert_true (mod.EnablePerspectiveCorrection (x, y, 4, d) & LF_MODIFY_PERSPECTIVE);
+        for (int i = 0; i < 10; i++)
+        {
+            float coords [2], expected [2];
+            g_assert_true (lfFix->mod->ApplyGeometryDistortion (100.0f * i, 100.0f * i, 1, 1, coords));
+            g_assert_true (mod.ApplyGeometryDistortion (100.0f * i, 100.0f * i, 1, 1, expected));
+            g_assert_cmpfloat (coords [0], ==, expected [0]);
+            g_assert_cmpfloat (coords [1], ==, expected [1]);
+        }
+    }
+
+    // The solution also fits the image in half the size, apart from the half
+    // pixel by which the pixel centres shift
+    lfModifier half (lfFix->lens, lfFix->focal, 1.534f, lfFix->img_width / 2, lfFix->img_height / 2, LF_PF_F32, false);
+    g_assert_true (half.EnablePerspectiveCorrection (&solution, 0.0f) & LF_MODIFY_PERSPECTIVE);
+    g_assert_true (lfFix->mod->EnablePerspectiveCorrection (&solution, 0.0f) & LF_MODIFY_PERSPECTIVE);
+    for (int i = 0; i < 10; i++)
+    {
+        float coords [2], expected [2];
+        g_assert_true (half.ApplyGeometryDistortion (50.0f * i, 50.0f * i, 1, 1, coords));
+        g_assert_true (lfFix->mod->ApplyGeometryDistortion (100.0f * i, 100.0f * i, 1, 1, expected));
+        g_assert_cmpfloat (fabs (coords [0] - expected [0] / 2), <=, 0.5f);
+        g_assert_cmpfloat (fabs (coords [1] - expected [1] / 2), <=, 0.5f);
+    }
+}
+
+// Moving the slider also recomputes an automatic scale and the grid of the
+// interpolation, so the result is the same as enabling them from scratch
+void test_mod_coord_pc_solution_update (lfFixture *lfFix, gconstpointer data)
+{
+    (void)data;
+    float x[] = {503, 1063, 509, 1066};
+    float y[] = {150, 197, 860, 759};
+    const int width = lfFix->img_width, height = lfFix->img_height;
+    lfPerspectiveSolution solution;
+    g_assert_true (lfFix->mod->SolvePerspectiveCorrection (x, y, 4, &solution));
+    g_assert_true (lfFix->mod->EnablePerspectiveCorrection (&solution, 1.0f) & LF_MODIFY_PERSPECTIVE);
+    g_assert_true (lfFix->mod->EnableScaling (0.0f) & LF_MODIFY_SCALE);
+    // Asking for the automatic scale again does not scale twice
+    g_assert_true (lfFix->mod->EnableScaling (0.0f) & LF_MODIFY_SCALE);
+    g_assert_cmpfloat (lfFix->mod->EnableGridInterpolation (0.1f), >=, 0.0f);
+
+    g_assert_true (lfFix->mod->EnablePerspectiveCorrection (&solution, -0.8f) & LF_MODIFY_PERSPECTIVE);
+    lfModifier mod (lfFix->lens, lfFix->focal, 1.534f, width, height, LF_PF_F32, false);
+    g_assert_true (mod.EnablePerspectiveCorrection (x, y, 4, -0.8f) & LF_MODIFY_PERSPECTIVE);
+    g_assert_true (mod.EnableScaling (0.0f) & LF_MODIFY_SCALE);
+    g_assert_cmpfloat (mod.EnableGridInterpolation (0.1f), >=, 0.0f);
+
+    std::vector<float> coords (2 * width * height), expected (2 * width * height);
+    g_assert_true (lfFix->mod->ApplyGeometryDistortion (0, 0, width, height, &coords [0]));
+    g_assert_true (mod.ApplyGeometryDistortion (0, 0, width, height, &expected [0]));
+    for (size_t i = 0; i < coords.size (); i++)
+        g_assert_cmpfloat (coords [i], ==, expected [i]);
+}
+
+// A solution which is not valid for d switches a previous correction off
+void test_mod_coord_pc_solution_invalid (lfFixture *lfFix, gconstpointer data)
+{
+    (void)data;
+    float x[] = {503, 1063, 509, 1066};
+    float y[] = {150, 197, 860, 759};
+    lfPerspectiveSolution solution;
+    g_assert_true (lfFix->mod->SolvePerspectiveCorrection (x, y, 4, &solution));
+    g_assert_true (lfFix->mod->EnablePerspectiveCorrection (&solution, 0.5f) & LF_MODIFY_PERSPECTIVE);
+
+    // The image centre is at infinity, and so is the centre of the control
+    // points
+    lfPerspectiveSolution invalid = solution;
+    invalid.Focal = invalid.CenterX = invalid.CenterY = 0.0;
+    g_assert_false (lfFix->mod->EnablePerspectiveCorrection (&invalid, 0.5f) & LF_MODIFY_PERSPECTIVE);
+    for (int i = 0; i < 10; i++)
+    {
+        float coords [2];
+        g_assert_true (lfFix->mod->ApplyGeometryDistortion (100.0f * i, 100.0f * i, 1, 1, coords));
+        g_assert_cmpfloat (fabs (coords [0] - 100.0f * i), <=, 1e-3f);
+        g_assert_cmpfloat (fabs (coords [1] - 100.0f * i), <=, 1e-3f);
+    }
+
+    // A valid d switches it on again
+    g_assert_true (lfFix->mod->EnablePerspectiveCorrection (&solution, 0.5f) & LF_MODIFY_PERSPECTIVE);
+    lfModifier mod (lfFix->lens, lfFix->focal, 1.534f, lfFix->img_width, lfFix->img_height, LF_PF_F32, false);
+    g_assert_true (mod.EnablePerspectiveCorrection (x, y, 4, 0.5f) & LF_MODIFY_PERSPECTIVE);
+    for (int i = 0; i < 10; i++)
+    {
+        float coords [2], expected [2];
+        g_assert_true (lfFix->mod->ApplyGeometryDistortion (100.0f * i, 100.0f * i, 1, 1, coords));
+        g_assert_true (mod.ApplyGeometryDistortion (100.0f * i, 100.0f * i, 1, 1, expected));
+        g_assert_cmpfloat (coords [0], ==, expected [0]);
+        g_assert_cmpfloat (coords [1], ==, expected [1]);
+    }
+}
+
+// Perspective and scaling alone run as a single pass over every row.  An
+// additional distortion without effect makes the reference run callback by
+// callback.
+void test_mod_coord_pc_rows (lfFixture *lfFix, gconstpointer data)
+{
+    (void)data;
+    float x[] = {503, 1063, 509, 1066};
+    float y[] = {150, 197, 860, 759};
+    lfLensCalibDistortion identity = {LF_DIST_MODEL_POLY5, lfFix->focal, lfFix->focal, false,
+                                      {0.0f, 0.0f}, {1.534f, 1.5f}};
+    const int width = lfFix->img_width, height = lfFix->img_height;
+
+    for (int reverse = 0; reverse < 2; reverse++)
+        for (float scale : {1.0f, 1.3f})
+        {
+            lfModifier mod (lfFix->lens, lfFix->focal, 1.534f, width, height, LF_PF_F32, reverse);
+            lfModifier ref (lfFix->lens, lfFix->focal, 1.534f, width, height, LF_PF_F32, reverse);
+            g_assert_true (mod.EnablePerspectiveCorrection (x, y, 4, -0.2f) & LF_MODIFY_PERSPECTIVE);
+            g_assert_true (ref.EnablePerspectiveCorrection (x, y, 4, -0.2f) & LF_MODIFY_PERSPECTIVE);
+            mod.EnableScaling (scale);
+            ref.EnableScaling (scale);
+            g_assert_true (ref.EnableDistortionCorrection (identity) & LF_MODIFY_DISTORTION);
+
+            std::vector<float> coords (2 * width * height), expected (2 * width * height);
+            std::vector<float> planes (2 * width * height);
+            g_assert_true (mod.ApplyGeometryDistortion (0, 0, width, height, &coords [0]));
+            g_assert_true (ref.ApplyGeometryDistortion (0, 0, width, height, &expected [0]));
+            g_assert_true (mod.ApplyGeometryDistortion (0, 0, width, height, &planes [0],
+                                                        &planes [width * height], width * sizeof (float)));
+            for (int i = 0; i < width * height; i++)
+                for (int j = 0; j < 2; j++)
+                {
+                    const float tolerance = 1e-3f + 1e-6f * fabs (expected [i * 2 + j]);
+                    g_assert_cmpfloat (fabs (coords [i * 2 + j] - expected [i * 2 + j]), <=, tolerance);
+                    g_assert_cmpfloat (planes [j * width * height + i], ==, coords [i * 2 + j]);
+                }
+        }
+}
 
 int main (int argc, char **argv)
 {
@@ -247,6 +394,14 @@ int main (int argc, char **argv)
               mod_setup, test_mod_coord_pc_5_points, mod_teardown);
   g_test_add ("/modifier/coord/pc/7 points", lfFixture, NULL,
               mod_setup, test_mod_coord_pc_7_points, mod_teardown);
+  g_test_add ("/modifier/coord/pc/solution", lfFixture, NULL,
+              mod_setup, test_mod_coord_pc_solution, mod_teardown);
+  g_test_add ("/modifier/coord/pc/solution update", lfFixture, NULL,
+              mod_setup, test_mod_coord_pc_solution_update, mod_teardown);
+  g_test_add ("/modifier/coord/pc/solution invalid", lfFixture, NULL,
+              mod_setup, test_mod_coord_pc_solution_invalid, mod_teardown);
+  g_test_add ("/modifier/coord/pc/rows", lfFixture, NULL,
+              mod_setup, test_mod_coord_pc_rows, mod_teardown);
 
   return g_test_run();
 }
@@ -96,6 +96,85 @@ void test_mod_coord_scale_parallel(lfFixture *lfFix, gconstpointer data)
 }
 #endif
 
+// Modifiers with the same settings share the automatic scale; any difference
+// in the geometry or the corrections must compute it again.
+void test_mod_coord_scale_cache(void)
+{
+  lfLensCalibAttributes cs = {1.0f, 1.5f};
+  lfLensCalibDistortion dc = {LF_DIST_MODEL_PTLENS, 24.0f, 24.0f, false, {0.01f, -0.03f, 0.02f}, cs};
+  lfLensCalibDistortion dc2 = {LF_DIST_MODEL_PTLENS, 50.0f, 50.0f, false, {0.0f, 0.01f, -0.02f}, cs};
+  lfLens lens;
+  lens.Type = LF_RECTILINEAR;
+  lens.AddCalibDistortion(&dc);
+  lens.AddCalibDistortion(&dc2);
+
+  struct Settings
+  {
+    float focal;
+    int width;
+    bool reverse, fisheye, hit;
+  } settings[] = {
+    { 24.0f, 300, false, false, false },
+    { 24.0f, 300, false, false, true },
+    { 35.0f, 300, false, false, false },
+    { 24.0f, 301, false, false, false },
+    { 24.0f, 300, true, false, false },
+    { 24.0f, 300, false, true, false },
+    { 35.0f, 300, false, false, true },
+    { 24.0f, 300, true, false, true },
+  };
+
+  auto auto_scale = [&lens](const Settings &s)
+  {
+    lfModifier mod(&lens, s.focal, 1.0f, s.width, 200, LF_PF_F32, s.reverse);
+    mod.EnableDistortionCorrection();
+    if(s.fisheye)
+      mod.EnableProjectionTransform(LF_FISHEYE);
+    return mod.GetAutoScale(s.reverse);
+  };
+
+  std::vector<float> expected;
+  for(auto &s : settings)
+  {
+    lfModifier::ClearAutoScaleCache();
+    expected.push_back(auto_scale(s));
+  }
+
+  lfModifier::ClearAutoScaleCache();
+  unsigned long hits = 0, misses = 0;
+  for(size_t i = 0; i < expected.size(); i++)
+  {
+    g_assert_cmpfloat(auto_scale(settings[i]), ==, expected[i]);
+    settings[i].hit ? hits++ : misses++;
+
+    unsigned long cache_hits, cache_misses;
+    lfModifier::GetAutoScaleCacheStats(&cache_hits, &cache_misses);
+    g_assert_cmpint(cache_hits, ==, hits);
+    g_assert_cmpint(cache_misses, ==, misses);
+  }
+  g_assert_cmpfloat(expected[0], !=, expected[2]);
+  g_assert_cmpfloat(expected[0], !=, expected[5]);
+}
+
+// Many callbacks overflow the storage inside the modifier; they must still
+// all be applied.
+void test_mod_coord_scale_many(void)
+{
+  lfLens lens;
+  lfModifier mod(&lens, 24.0f, 1.0f, 300, 200, LF_PF_F32, false);
+  lfModifier ref(&lens, 24.0f, 1.0f, 300, 200, LF_PF_F32, false);
+  const int count = 40;
+  for(int i = 0; i < count; i++)
+    mod.EnableScaling(1.01f);
+  ref.EnableScaling(pow(1.01f, count));
+
+  std::vector<float> coords(2 * 300 * 200), expected(2 * 300 * 200);
+  g_assert_true(mod.ApplyGeometryDistortion(0, 0, 300, 200, &coords[0]));
+  g_assert_true(ref.ApplyGeometryDistortion(0, 0, 300, 200, &expected[0]));
+  for(size_t i = 0; i < coords.size(); i++)
+    g_assert_cmpfloat(fabs(coords[i] - expected[i]), <=, 1e-3);
+}
+
 gchar *describe(lfTestParams *p, const char *prefix)
 {
   gchar alignment[32] = "";
@@ -168,6 +247,9 @@ int main(int argc, char **argv)
     }
   }
 
+  g_test_add_func("/modifier/coord/scale/cache", test_mod_coord_scale_cache);
+  g_test_add_func("/modifier/coord/scale/many", test_mod_coord_scale_many);
+
   const int res = g_test_run();
 
   g_slist_free_full(slist, (GDestroyNotify)g_free);
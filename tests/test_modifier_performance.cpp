@@ -93,6 +93,37 @@ void test_perf_dist_ptlens (lfFixture *lfFix, gconstpointer data)
     lf_free (lenses);
 }
 
+// setting up a modifier for another image of a batch must be cheap: the
+// automatic scale and the fitted inverse distortion come from the caches,
+// and nothing else is precomputed
+void test_perf_setup (lfFixture *lfFix, gconstpointer data)
+{
+    (void)data;
+    const lfLens** lenses = lfFix->db->FindLenses (NULL, NULL, "PENTAX-F 28-80mm");
+    g_assert_nonnull(lenses);
+
+    lfModifier::ClearAutoScaleCache ();
+    const int count = 1000;
+    clock_t start_time = clock();
+    for (int i = 0; i < count; i++)
+    {
+        lfModifier mod (lenses[0], 30.89f, 1.534f, lfFix->img_width, lfFix->img_height, LF_PF_F32, i & 1);
+        mod.EnableDistortionCorrection();
+        mod.EnableTCACorrection();
+        mod.EnableProjectionTransform(LF_FISHEYE);
+        mod.EnableScaling(0.0f);
+    }
+    float run_time = ((float)(clock() - start_time)) / CLOCKS_PER_SEC;
+    g_print("time per modifier : %.2fus,  ", run_time / count * 1e6);
+
+    unsigned long hits, misses;
+    lfModifier::GetAutoScaleCacheStats (&hits, &misses);
+    g_assert_cmpint(misses, ==, 2);
+    g_assert_cmpint(hits, ==, count - 2);
+
+    lf_free (lenses);
+}
+
 int main (int argc, char **argv)
 {
   setlocale (LC_ALL, "");
@@ -102,6 +133,8 @@ int main (int argc, char **argv)
 
   g_test_add ("/modifier/performance/dist/ptlens", lfFixture, NULL,
               mod_setup, test_perf_dist_ptlens, mod_teardown);
+  g_test_add ("/modifier/performance/setup", lfFixture, NULL,
+              mod_setup, test_perf_setup, mod_teardown);
 
   return g_test_run();
 }
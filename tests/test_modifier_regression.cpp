@@ -1,4 +1,5 @@
 #include <string>
+#include <vector>
 #include <limits>
 #include <map>
 #include <cmath>
@@ -86,6 +87,61 @@ void test_verify_dist_poly3 (lfFixture *lfFix, gconstpointer data)
     lf_free (lenses);
 }
 
+// Re-distorting the results of test_verify_dist_poly3 must lead back to the
+// original points.  Every point is also computed as the first pixel of a row
+// of eight, so that the vectorized code paths are checked as well.
+void test_verify_undist_poly3 (lfFixture *lfFix, gconstpointer data)
+{
+    (void)data;
+    const lfLens** lenses = lfFix->db->FindLenses (NULL, NULL, "pEntax 50-200 ED");
+    g_assert_nonnull(lenses);
+
+    lfModifier* mod = new lfModifier (lenses[0], 80.89f, 1.534f, lfFix->img_width, lfFix->img_height, LF_PF_F32, true);
+    mod->EnableDistortionCorrection();
+
+    float x[] = {-14.016061f, 751.0f, 810.27203f, 1275.1655f};
+    float y[] = {-9.3409109f, 497.0f, 938.96729f, 96.035286f};
+
+    float expected_x[] = {0, 751, 810, 1270};
+    float expected_y[] = {0, 497, 937, 100};
+
+    float coords [16];
+    for (unsigned int i = 0; i < sizeof(x) / sizeof(float); i++)
+    {
+        g_assert_true(mod->ApplyGeometryDistortion (x[i], y[i], 1, 1, coords));
+        g_assert_cmpfloat (fabs (coords [0] - expected_x [i]), <=, 1e-3);
+        g_assert_cmpfloat (fabs (coords [1] - expected_y [i]), <=, 1e-3);
+
+        g_assert_true(mod->ApplyGeometryDistortion (x[i], y[i], 8, 1, coords));
+        g_assert_cmpfloat (fabs (coords [0] - expected_x [i]), <=, 1e-3);
+        g_assert_cmpfloat (fabs (coords [1] - expected_y [i]), <=, 1e-3);
+    }
+
+    delete mod;
+
+    // Strong barrel distortion: there is no undistorted point for the corners
+    lfLensCalibAttributes cs = {1.534f, 1.5f};
+    lfLensCalibDistortion lensCalibDist = {LF_DIST_MODEL_POLY3, 80.89f, 80.89f, false, {-0.1f}, cs};
+    lfLens* lens = new lfLens();
+    lens->AddCalibDistortion(&lensCalibDist);
+
+    mod = new lfModifier (lens, 80.89f, 1.534f, lfFix->img_width, lfFix->img_height, LF_PF_F32, true);
+    mod->EnableDistortionCorrection();
+
+    g_assert_true(mod->ApplyGeometryDistortion (0, 0, 1, 1, coords));
+    g_assert_true(std::isnan (coords [0]) && std::isnan (coords [1]));
+    g_assert_true(mod->ApplyGeometryDistortion (0, 0, 8, 1, coords));
+    g_assert_true(std::isnan (coords [0]) && std::isnan (coords [1]));
+
+    g_assert_true(mod->ApplyGeometryDistortion (751, 497, 8, 1, coords));
+    g_assert_false(std::isnan (coords [0]) || std::isnan (coords [1]));
+
+    delete mod;
+    delete lens;
+
+    lf_free (lenses);
+}
+
 void test_verify_dist_poly5 (lfFixture *lfFix, gconstpointer data)
 {
     (void)data;
@@ -150,6 +206,90 @@ void test_verify_dist_ptlens (lfFixture *lfFix, gconstpointer data)
     lf_free (lenses);
 }
 
+// The inverse of the poly5 and ptlens models is fitted when the reverse
+// modifier is set up; re-distorting the results of test_verify_dist_poly5 and
+// test_verify_dist_ptlens must lead back to the original points.
+void test_verify_undist_fit (lfFixture *lfFix, gconstpointer data)
+{
+    (void)data;
+    const char *lens_names[] = {"Canon PowerShot G12", "PENTAX-F 28-80mm"};
+    const float focal[] = {10.89f, 30.89f};
+    const float crop[] = {4.6f, 1.534f};
+
+    float x[][4] = {{28.805828f, 751.0f, 809.50531f, 1260.1396f},
+                    {29.019449f, 750.99969f, 808.74231f, 1255.1388f}};
+    float y[][4] = {{19.197506f, 497.0f, 933.42279f, 107.56808f},
+                    {19.339846f, 497.00046f, 927.90521f, 111.40639f}};
+
+    float expected_x[] = {0, 751, 810, 1270};
+    float expected_y[] = {0, 497, 937, 100};
+
+    for (int l = 0; l < 2; l++)
+    {
+        const lfLens** lenses = lfFix->db->FindLenses (NULL, NULL, lens_names[l]);
+        g_assert_nonnull(lenses);
+
+        lfModifier* mod = new lfModifier (lenses[0], focal[l], crop[l], lfFix->img_width, lfFix->img_height, LF_PF_F32, true);
+        g_assert_cmpfloat (mod->GetDistortionFitResidual (), <, 0.0f);
+        mod->EnableDistortionCorrection();
+        g_assert_cmpfloat (mod->GetDistortionFitResidual (), >=, 0.0f);
+        g_assert_cmpfloat (mod->GetDistortionFitResidual (), <=, 1e-3);
+
+        float coords [16];
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            g_assert_true(mod->ApplyGeometryDistortion (x[l][i], y[l][i], 1, 1, coords));
+            g_assert_cmpfloat (fabs (coords [0] - expected_x [i]), <=, 1e-3);
+            g_assert_cmpfloat (fabs (coords [1] - expected_y [i]), <=, 1e-3);
+
+            g_assert_true(mod->ApplyGeometryDistortion (x[l][i], y[l][i], 8, 1, coords));
+            g_assert_cmpfloat (fabs (coords [0] - expected_x [i]), <=, 1e-3);
+            g_assert_cmpfloat (fabs (coords [1] - expected_y [i]), <=, 1e-3);
+        }
+
+        delete mod;
+        lf_free (lenses);
+    }
+}
+
+void test_verify_undist_acm (lfFixture *lfFix, gconstpointer data)
+{
+    (void)data;
+    lfLensCalibAttributes cs = {1.534f, 1.5f};
+    lfLensCalibDistortion lensCalibDist = {LF_DIST_MODEL_ACM, 24.0f, 24.0f, false,
+                                           {-0.0385f, 0.0061f, -0.0003f, 0.0012f, -0.0007f}, cs};
+    lfLens* lens = new lfLens();
+    lens->AddCalibDistortion(&lensCalibDist);
+
+    lfModifier* mod = new lfModifier (lens, 24.0f, 1.534f, lfFix->img_width, lfFix->img_height, LF_PF_F32, false);
+    lfModifier* mod_reverse = new lfModifier (lens, 24.0f, 1.534f, lfFix->img_width, lfFix->img_height, LF_PF_F32, true);
+    mod->EnableDistortionCorrection();
+    mod_reverse->EnableDistortionCorrection();
+
+    float x[] = {0, 751, 810, 1270};
+    float y[] = {0, 497, 937, 100};
+
+    float coords [16], roundtrip [16];
+    for (unsigned int i = 0; i < sizeof(x) / sizeof(float); i++)
+    {
+        g_assert_true(mod->ApplyGeometryDistortion (x[i], y[i], 8, 1, coords));
+        for (int j = 0; j < 8; j++)
+        {
+            g_assert_true(mod_reverse->ApplyGeometryDistortion (coords [2 * j], coords [2 * j + 1], 1, 1, roundtrip));
+            g_assert_cmpfloat (fabs (roundtrip [0] - (x[i] + j)), <=, 1e-2);
+            g_assert_cmpfloat (fabs (roundtrip [1] - y[i]), <=, 1e-2);
+        }
+
+        g_assert_true(mod_reverse->ApplyGeometryDistortion (coords [0], coords [1], 8, 1, roundtrip));
+        g_assert_cmpfloat (fabs (roundtrip [0] - x[i]), <=, 1e-2);
+        g_assert_cmpfloat (fabs (roundtrip [1] - y[i]), <=, 1e-2);
+    }
+
+    delete mod;
+    delete mod_reverse;
+    delete lens;
+}
+
 void test_verify_vignetting_pa (lfFixture *lfFix, gconstpointer data)
 {
     (void)data;
@@ -332,6 +472,48 @@ void test_verify_geom_fisheye_rectlinear (lfFixture *lfFix, gconstpointer data)
     lf_free (lenses);
 }
 
+// Distortion plus a projection change is a purely radial chain, which
+// ApplyGeometryDistortion looks up in a table.  Compare with single pixels of
+// ApplySubpixelGeometryDistortion, which always runs the callbacks.  Far
+// outside the frame both paths are limited by float precision, hence the
+// relative part of the tolerance.
+void test_verify_radial_table (lfFixture *lfFix, gconstpointer data)
+{
+    (void)data;
+    const lfLens** lenses = lfFix->db->FindLenses (NULL, NULL, "M.Zuiko Digital ED 8mm f/1.8 Fisheye");
+    g_assert_nonnull(lenses);
+
+    for (int reverse = 0; reverse < 2; reverse++)
+    {
+        lfModifier* mod = new lfModifier (lenses[0], 8.0f, 2.0f, lfFix->img_width, lfFix->img_height, LF_PF_U16, reverse);
+        mod->EnableDistortionCorrection();
+        mod->EnableProjectionTransform(LF_RECTILINEAR);
+        mod->EnableScaling(reverse ? 2.0f : 0.5f);
+
+        std::vector<float> coords (2 * lfFix->img_width);
+        float ref [6];
+        for (size_t y = 0; y < lfFix->img_height; y += 7)
+        {
+            g_assert_true(mod->ApplyGeometryDistortion (0, y, lfFix->img_width, 1, &coords [0]));
+            for (size_t x = 0; x < lfFix->img_width; x += 7)
+            {
+                g_assert_true(mod->ApplySubpixelGeometryDistortion (x, y, 1, 1, ref));
+                for (int i = 0; i < 2; i++)
+                {
+                    if (std::isnan (ref [i]))
+                        g_assert_true(std::isnan (coords [2 * x + i]));
+                    else if (fabs (ref [i]) < 1e5)
+                        g_assert_cmpfloat (fabs (coords [2 * x + i] - ref [i]), <=, 2e-3 + 2e-5 * fabs (ref [i]));
+                }
+            }
+        }
+
+        delete mod;
+    }
+
+    lf_free (lenses);
+}
+
 
 int main (int argc, char **argv)
 {
@@ -343,15 +525,27 @@ int main (int argc, char **argv)
   g_test_add ("/modifier/coord/dist/verify_poly3", lfFixture, NULL,
               mod_setup, test_verify_dist_poly3, mod_teardown);
 
+  g_test_add ("/modifier/coord/dist/verify_undist_poly3", lfFixture, NULL,
+              mod_setup, test_verify_undist_poly3, mod_teardown);
+
   g_test_add ("/modifier/coord/dist/verify_ptlens", lfFixture, NULL,
               mod_setup, test_verify_dist_ptlens, mod_teardown);
 
   g_test_add ("/modifier/coord/dist/verify_poly5", lfFixture, NULL,
               mod_setup, test_verify_dist_poly5, mod_teardown);
 
+  g_test_add ("/modifier/coord/dist/verify_undist_fit", lfFixture, NULL,
+              mod_setup, test_verify_undist_fit, mod_teardown);
+
+  g_test_add ("/modifier/coord/dist/verify_undist_acm", lfFixture, NULL,
+              mod_setup, test_verify_undist_acm, mod_teardown);
+
   g_test_add ("/modifier/coord/geom/verify_equisolid_linrect", lfFixture, NULL,
               mod_setup, test_verify_geom_fisheye_rectlinear, mod_teardown);
 
+  g_test_add ("/modifier/coord/geom/verify_radial_table", lfFixture, NULL,
+              mod_setup, test_verify_radial_table, mod_teardown);
+
   g_test_add ("/modifier/color/vignetting/verify_pa", lfFixture, NULL,
               mod_setup, test_verify_vignetting_pa, mod_teardown);
 
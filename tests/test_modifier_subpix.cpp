@@ -84,6 +84,149 @@ void test_mod_subpix(lfFixture *lfFix, gconstpointer data)
   }
 }
 
+// The planar variants must give the same coordinates as the interleaved ones
+void test_mod_subpix_planar(lfFixture *lfFix, gconstpointer data)
+{
+  (void)data;
+  const size_t stride = lfFix->img_width + 3;
+  std::vector<float> planes(6 * stride * lfFix->img_height);
+  float *res_x[3], *res_y[3];
+  for(int c = 0; c < 3; c++)
+  {
+    res_x[c] = &planes[2 * c * stride * lfFix->img_height];
+    res_y[c] = res_x[c] + stride * lfFix->img_height;
+  }
+
+  for(int geometry = 0; geometry < 2; geometry++)
+  {
+    float *coordData = (float *)lfFix->coordBuff;
+    if(geometry)
+    {
+      g_assert_true(lfFix->mod->ApplySubpixelGeometryDistortion(0.0, 0.0, lfFix->img_width, lfFix->img_height, coordData));
+      g_assert_true(lfFix->mod->ApplySubpixelGeometryDistortion(0.0, 0.0, lfFix->img_width, lfFix->img_height,
+                                                                res_x, res_y, stride * sizeof(float)));
+    }
+    else
+    {
+      g_assert_true(lfFix->mod->ApplySubpixelDistortion(0.0, 0.0, lfFix->img_width, lfFix->img_height, coordData));
+      g_assert_true(lfFix->mod->ApplySubpixelDistortion(0.0, 0.0, lfFix->img_width, lfFix->img_height,
+                                                        res_x, res_y, stride * sizeof(float)));
+    }
+
+    for(size_t y = 0; y < lfFix->img_height; y++)
+      for(size_t x = 0; x < lfFix->img_width; x++)
+        for(int c = 0; c < 3; c++)
+        {
+          const float *ref = coordData + 6 * (y * lfFix->img_width + x) + 2 * c;
+          g_assert_cmpfloat(res_x[c][y * stride + x], ==, ref[0]);
+          g_assert_cmpfloat(res_y[c][y * stride + x], ==, ref[1]);
+        }
+  }
+}
+
+// The per-channel maps must give the same coordinates as the interleaved
+// output; the channel callbacks process other chunks than the RGB ones
+void test_mod_subpix_channels(lfFixture *lfFix, gconstpointer data)
+{
+  (void)data;
+  const size_t stride = 2 * (lfFix->img_width + 2);
+  std::vector<float> maps(3 * stride * lfFix->img_height);
+  float *res[3];
+  for(int c = 0; c < 3; c++)
+    res[c] = &maps[c * stride * lfFix->img_height];
+
+  for(int geometry = 0; geometry < 2; geometry++)
+  {
+    float *coordData = (float *)lfFix->coordBuff;
+    if(geometry)
+    {
+      g_assert_true(lfFix->mod->ApplySubpixelGeometryDistortion(0.0, 0.0, lfFix->img_width, lfFix->img_height, coordData));
+      g_assert_true(lfFix->mod->ApplySubpixelGeometryDistortion(0.0, 0.0, lfFix->img_width, lfFix->img_height,
+                                                                res, stride * sizeof(float)));
+    }
+    else
+    {
+      g_assert_true(lfFix->mod->ApplySubpixelDistortion(0.0, 0.0, lfFix->img_width, lfFix->img_height, coordData));
+      g_assert_true(lfFix->mod->ApplySubpixelDistortion(0.0, 0.0, lfFix->img_width, lfFix->img_height,
+                                                        res, stride * sizeof(float)));
+    }
+
+    for(size_t y = 0; y < lfFix->img_height; y++)
+      for(size_t x = 0; x < lfFix->img_width; x++)
+        for(int c = 0; c < 3; c++)
+        {
+          const float *ref = coordData + 6 * (y * lfFix->img_width + x) + 2 * c;
+          g_assert_cmpfloat(fabs(res[c][y * stride + 2 * x] - ref[0]), <=, 1e-3);
+          g_assert_cmpfloat(fabs(res[c][y * stride + 2 * x + 1] - ref[1]), <=, 1e-3);
+        }
+  }
+}
+
+// Whole rows run through the vectorized callbacks, single pixels through
+// their scalar tails
+void test_mod_subpix_vectorized(lfFixture *lfFix, gconstpointer data)
+{
+  (void)data;
+  float *coordData = (float *)lfFix->coordBuff;
+  for(size_t y = 0; y < lfFix->img_height; y += 7)
+  {
+    g_assert_true(lfFix->mod->ApplySubpixelDistortion(0.0, y, lfFix->img_width, 1, coordData));
+
+    for(size_t x = 0; x < lfFix->img_width; x++)
+    {
+      float ref[6];
+      g_assert_true(lfFix->mod->ApplySubpixelDistortion(x, y, 1, 1, ref));
+      for(int i = 0; i < 6; i++)
+        g_assert_cmpfloat(fabs(coordData[6 * x + i] - ref[i]), <=, 1e-3);
+    }
+  }
+}
+
+// The CFA variants must give the coordinates of the colour of every site
+void test_mod_subpix_cfa(lfFixture *lfFix, gconstpointer data)
+{
+  (void)data;
+  static const unsigned char bayer[2 * 2] = {0, 1,
+                                             1, 2};
+  static const unsigned char xtrans[6 * 6] = {1, 1, 0, 1, 1, 2,
+                                              1, 1, 2, 1, 1, 0,
+                                              2, 0, 1, 0, 2, 1,
+                                              1, 1, 2, 1, 1, 0,
+                                              1, 1, 0, 1, 1, 2,
+                                              0, 2, 1, 2, 0, 1};
+  const int x0 = 3, y0 = 5;
+  const int width = lfFix->img_width - x0, height = lfFix->img_height - y0;
+  std::vector<float> cfa_res(2 * width * height);
+  float *coordData = (float *)lfFix->coordBuff;
+
+  for(int geometry = 0; geometry < 2; geometry++)
+  {
+    if(geometry)
+      g_assert_true(lfFix->mod->ApplySubpixelGeometryDistortion(x0, y0, width, height, coordData));
+    else
+      g_assert_true(lfFix->mod->ApplySubpixelDistortion(x0, y0, width, height, coordData));
+
+    for(int pattern = 0; pattern < 2; pattern++)
+    {
+      const unsigned char *cfa = pattern ? xtrans : bayer;
+      const int n = pattern ? 6 : 2;
+      if(geometry)
+        g_assert_true(lfFix->mod->ApplySubpixelGeometryDistortionCFA(x0, y0, width, height, cfa, n, &cfa_res[0]));
+      else
+        g_assert_true(lfFix->mod->ApplySubpixelDistortionCFA(x0, y0, width, height, cfa, n, &cfa_res[0]));
+
+      for(int y = 0; y < height; y++)
+        for(int x = 0; x < width; x++)
+        {
+          const int c = cfa[((y0 + y) % n) * n + (x0 + x) % n];
+          const float *ref = coordData + 6 * (y * width + x) + 2 * c;
+          g_assert_cmpfloat(fabs(cfa_res[2 * (y * width + x)] - ref[0]), <=, 1e-3);
+          g_assert_cmpfloat(fabs(cfa_res[2 * (y * width + x) + 1] - ref[1]), <=, 1e-3);
+        }
+    }
+  }
+}
+
 #ifdef _OPENMP
 void test_mod_subpix_parallel(lfFixture *lfFix, gconstpointer data)
 {
@@ -123,6 +266,29 @@ void add_set_item(lfTestParams *p)
   g_free(desc);
   desc = NULL;
 
+  if(p->alignment == 0)
+  {
+    desc = describe(p, "modifier/subpix/vectorized");
+    g_test_add(desc, lfFixture, p, mod_setup, test_mod_subpix_vectorized, mod_teardown);
+    g_free(desc);
+    desc = NULL;
+
+    desc = describe(p, "modifier/subpix/channels");
+    g_test_add(desc, lfFixture, p, mod_setup, test_mod_subpix_channels, mod_teardown);
+    g_free(desc);
+    desc = NULL;
+
+    desc = describe(p, "modifier/subpix/cfa");
+    g_test_add(desc, lfFixture, p, mod_setup, test_mod_subpix_cfa, mod_teardown);
+    g_free(desc);
+    desc = NULL;
+  }
+
+  desc = describe(p, "modifier/subpix/planar");
+  g_test_add(desc, lfFixture, p, mod_setup, test_mod_subpix_planar, mod_teardown);
+  g_free(desc);
+  desc = NULL;
+
 #ifdef _OPENMP
   desc = describe(p, "modifier/subpix/parallelFor");
   g_test_add(desc, lfFixture, p, mod_setup, test_mod_subpix_parallel, mod_teardown);
@@ -166,6 +332,13 @@ int main(int argc, char **argv)
     {
       LF_TCA_MODEL_POLY3,  24.0f, {1.0002104f, 1.0000529f, 0.0f, 0.0f, -0.0000220f, -0.0000000f}, cs
     };
+    // The ACM model has no reverse correction
+    if(!*it_reverse)
+      tcaCalib["LF_TCA_MODEL_ACM"] = lfLensCalibTCA
+      {
+        LF_TCA_MODEL_ACM,  24.0f, {1.0001f, 0.9998f, 0.0002f, -0.0001f, -0.0001f, 0.00005f,
+                                   0.00002f, -0.00001f, 0.00003f, -0.00002f, 0.00001f, 0.00004f}, cs
+      };
 
     for(std::map<std::string, lfLensCalibTCA>::iterator it_tcaCalib = tcaCalib.begin(); it_tcaCalib != tcaCalib.end(); ++it_tcaCalib)
     {